@@ -0,0 +1,18 @@
+#include "autopilot.h"
+#include "rng.h"
+#include "sim.h"
+
+void autopilot_init(Autopilot *pilot, unsigned int seed) {
+  pilot->rng = rng_seed(seed ^ 0xA5A5A5A5u);
+  pilot->heading = DIR_DOWN;
+}
+
+int autopilot_input(Autopilot *pilot, const Player *player) {
+  if (player->move_slowdown > 0) {
+    return INPUT_NONE; // can't move yet, don't press anything
+  }
+  if (rng_range(&pilot->rng, 8) == 0) {
+    pilot->heading = rng_range(&pilot->rng, 4);
+  }
+  return pilot->heading;
+}
@@ -0,0 +1,18 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "player.h"
+
+// simple deterministic "player" used when no replay is given
+// keeps going in one direction and sometimes turns, so it digs like a human
+typedef struct {
+  unsigned int rng;
+  Direction heading;
+} Autopilot;
+
+void autopilot_init(Autopilot *pilot, unsigned int seed);
+
+// input for the next tick
+int autopilot_input(Autopilot *pilot, const Player *player);
+
+#endif
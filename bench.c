@@ -0,0 +1,1035 @@
+// headless benchmark: runs the game logic with no window and no delay
+// used as the PGO training workload and to compare build variants
+#define _POSIX_C_SOURCE 200809L
+
+#include "autopilot.h"
+#include "bisect.h"
+#include "bot.h"
+#include "colstore.h"
+#include "eventlog.h"
+#include "jobs.h"
+#include "kernels.h"
+#include "metrics.h"
+#include "replay.h"
+#include "rng.h"
+#include "scenario.h"
+#include "sim.h"
+#include "sweep.h"
+#include "timeline.h"
+#include "tuning.h"
+#include "verify.h"
+#include "wide.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_TICKS 5000000
+#define DEFAULT_SEED 1982
+#define VERIFY_TICKS 20000
+#define VERIFY_SEEDS 200
+#define VERIFY_CROWD 300 // enemies in the serial vs parallel check
+#define VERIFY_PARALLEL_SEEDS 20 // crowds are slow, only the first seeds
+#define VERIFY_WIDE_SEEDS 20     // wide backend: lanes from the first seeds
+#define VERIFY_KERNEL_SEEDS 20   // random levels for the grid kernels
+#define SCRUB_SEEKS 200
+#define SWEEP_SEEDS 32
+#define SWEEP_TICKS 36000 // 10 minutes of game time
+#define COOLDOWN_TICKS 500
+#define WIDE_GAMES 4096
+#define WIDE_TICKS 3600 // a minute of game time each
+#define KERNEL_BENCH_TILES (1 << 24) // tiles each kernel goes over, per size
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [--ticks N] [--seed S] [--replay FILE] [--record FILE]\n"
+          "       %s --verify [--seeds N] [--ticks N] [--replay FILE]\n"
+          "       %s --verify-file FILE\n"
+          "       %s --sweep KEY=A..B[:STEP] [--sweep ...] [--seeds N] "
+          "[--ticks N]\n"
+          "       %s --scan FILE [--columns A,B,...]\n"
+          "       %s --cooldown-bench [--threads N]\n"
+          "       %s --wide-bench\n"
+          "       %s --kernel-bench\n"
+          "  --replay FILE       play back a recorded game instead of the "
+          "autopilot\n"
+          "  --scenario NAME     drive the player with a script (built-in "
+          "name or file)\n"
+          "  --list-scenarios    show the built-in scenarios\n"
+          "  --tuning FILE       use this tuning file instead of the "
+          "defaults\n"
+          "  --enemies N         add N enemies at random spots (same on "
+          "replay)\n"
+          "  --flee              every enemy runs for the exit from the "
+          "start;\n"
+          "                      stops once they're all out\n"
+          "  --threads N         update enemies on N extra threads; with\n"
+          "                      --verify also checks serial vs parallel\n"
+          "  --bot N             a tree search bot plays instead of the "
+          "autopilot,\n"
+          "                      N playouts per move\n"
+          "  --record FILE       save the autopilot inputs as a replay\n"
+          "  --timeline FILE     save the run as an indexed replay "
+          "(keyframes)\n"
+          "  --keyframe-ticks N  ticks between its keyframes (default %d)\n"
+          "  --scrub FILE        seek around an indexed replay, check each "
+          "seek\n"
+          "                      against playing it straight through\n"
+          "  --bisect A B        find the first tick two indexed replays of "
+          "the\n"
+          "                      same game differ, diff the worlds there\n"
+          "  --verify            run sim and reference rules in lockstep on\n"
+          "                      random inputs (or a replay), compare every "
+          "tick\n"
+          "  --verify-file FILE  same, using raw file bytes as seed + "
+          "inputs\n"
+          "  --sweep KEY=A..B    play every combination of tuning values "
+          "(repeat\n"
+          "                      for more keys), --seeds games each (default "
+          "%d)\n"
+          "                      of at most --ticks (default %d), on all "
+          "cores\n"
+          "  --sweep-out FILE    the sweep's CSV (default stdout)\n"
+          "  --no-early-stop     play every seed even for clearly losing "
+          "values\n"
+          "  --episodes FILE     also store every game of the sweep in a "
+          "column store\n"
+          "  --scan FILE         sum up the columns of a column store "
+          "(default all,\n"
+          "                      --columns picks some)\n"
+          "  --cooldown-bench    tick cost of big crowds against how many "
+          "are awake\n"
+          "  --wide-bench        world-ticks/s of sim_step against the "
+          "wide backend\n"
+          "  --kernel-bench      grid kernels for fixed sizes against the "
+          "generic ones\n"
+          "  --metrics-port P    serve Prometheus metrics on 127.0.0.1:P\n"
+          "  --metrics-file F    dump metrics to F every --metrics-interval "
+          "s\n"
+          "  --metrics-hold S    keep serving S seconds after the run\n"
+          "  --event-log FILE    write game events (- = stderr)\n"
+          "  --event-format F    text, jsonl (default) or binary\n"
+          "  --event-level L     debug, info (default), warn or error\n",
+          name, name, name, name, name, name, name, name, TIMELINE_BLOCK_TICKS,
+          SWEEP_SEEDS, SWEEP_TICKS);
+}
+
+static void report_mismatch(unsigned int seed, long tick, const char *diff) {
+  if (tick == VERIFY_ERROR) {
+    printf("FAILED seed %u: out of memory setting up the worlds\n", seed);
+    return;
+  }
+  printf("MISMATCH seed %u at tick %ld:\n%s", seed, tick, diff);
+}
+
+// lockstep sim vs reference on many seeds with random (often invalid) input
+// plus serial vs parallel enemy update when worker threads are running
+static int run_verify(unsigned int first_seed, int seeds, unsigned long ticks,
+                      const Tuning *tuning) {
+  unsigned char *inputs = malloc(ticks ? ticks : 1);
+  if (!inputs) {
+    return 1;
+  }
+
+  char diff[2048];
+  for (int s = 0; s < seeds; s++) {
+    unsigned int seed = first_seed + (unsigned int)s;
+    unsigned int rng = rng_seed(seed ^ 0x5EEDu);
+
+    // mix of held keys and random taps, like a fuzzer would
+    int held = INPUT_NONE;
+    for (unsigned long t = 0; t < ticks; t++) {
+      if (rng_range(&rng, 16) == 0) {
+        held = rng_range(&rng, INPUT_NONE + 1);
+      }
+      inputs[t] = (rng_range(&rng, 4) == 0) ? rng_range(&rng, INPUT_NONE + 1)
+                                            : held;
+    }
+
+    long tick =
+        verify_lockstep(seed, tuning, inputs, ticks, diff, sizeof diff);
+    if (tick != -1) {
+      report_mismatch(seed, tick, diff);
+      free(inputs);
+      return 1;
+    }
+
+    if (s < VERIFY_KERNEL_SEEDS && !verify_kernels(seed, diff, sizeof diff)) {
+      printf("sized vs generic kernels: MISMATCH seed %u:\n%s", seed, diff);
+      free(inputs);
+      return 1;
+    }
+
+    if (s < VERIFY_WIDE_SEEDS) {
+      tick = verify_wide(seed, tuning, inputs, ticks, diff, sizeof diff);
+      if (tick != -1) {
+        printf("wide vs sim_step: ");
+        report_mismatch(seed, tick, diff);
+        free(inputs);
+        return 1;
+      }
+    }
+
+    if (jobs_worker_count() > 0 && s < VERIFY_PARALLEL_SEEDS) {
+      tick = verify_parallel(seed, tuning, inputs, ticks, VERIFY_CROWD, diff,
+                             sizeof diff);
+      if (tick != -1) {
+        printf("serial vs parallel: ");
+        report_mismatch(seed, tick, diff);
+        free(inputs);
+        return 1;
+      }
+    }
+  }
+
+  printf("verify: %d seeds x %lu ticks, sim matches reference\n", seeds,
+         ticks);
+  printf("verify: wide backend (%d lanes, blind rules, %d seeds) matches "
+         "sim_step\n",
+         WIDE_LANES, seeds < VERIFY_WIDE_SEEDS ? seeds : VERIFY_WIDE_SEEDS);
+  printf("verify: sized grid kernels (%d tables, %d levels each) match the "
+         "generic ones\n",
+         kernels_sized_count(),
+         seeds < VERIFY_KERNEL_SEEDS ? seeds : VERIFY_KERNEL_SEEDS);
+  if (jobs_worker_count() > 0) {
+    printf("verify: parallel enemy update (%d threads, %d enemies, %d "
+           "seeds) matches serial\n",
+           jobs_worker_count() + 1, VERIFY_CROWD,
+           seeds < VERIFY_PARALLEL_SEEDS ? seeds : VERIFY_PARALLEL_SEEDS);
+  }
+  free(inputs);
+  return 0;
+}
+
+// big crowds with enemy_perception off, so every enemy sleeps through its
+// cooldowns in the timing wheel: the longer the cooldown, the fewer are
+// awake, and a tick should cost about what the awake ones cost. The
+// sighted rows (perception on, enemies look around every tick) are the
+// everybody-gets-visited baseline.
+static int run_cooldown_bench(unsigned int seed, const Tuning *tuning) {
+  static const int crowds[] = {10000, 100000};
+  static const int cooldowns[] = {1, 10, 100};
+  printf("%8s %9s %8s %10s %10s\n", "enemies", "cooldown", "sighted",
+         "visited", "ns/tick");
+  for (int c = 0; c < 2; c++) {
+    for (int k = 0; k < 4; k++) {
+      bool sighted = k == 3;
+      int cooldown = cooldowns[sighted ? 2 : k];
+      Tuning crowd = *tuning;
+      crowd.max_enemies += crowds[c];
+      crowd.enemy_perception = sighted;
+      crowd.enemy_dirt_slowdown = cooldown;
+      crowd.enemy_tunnel_slowdown = cooldown;
+      World world;
+      if (!sim_init(&world, seed, &crowd)) {
+        fprintf(stderr, "Out of memory for %d enemies\n", crowds[c]);
+        return 1;
+      }
+      sim_spawn_crowd(&world, crowds[c], seed);
+      world.parallel = jobs_worker_count() > 0;
+      // let the moves spread out over the cooldown first
+      for (int t = 0; t < 2 * cooldown; t++) {
+        sim_step(&world, INPUT_NONE);
+      }
+      // visited = awake at the end + the movers that just went to sleep
+      // (all of them when blind, none when sighted)
+      double visited = 0;
+      int blocks = (world.enemy_count + ENEMY_BLOCK - 1) / ENEMY_BLOCK;
+      double start = now_seconds();
+      for (int t = 0; t < COOLDOWN_TICKS; t++) {
+        sim_step(&world, INPUT_NONE);
+        visited += world.enemies_alive - world.wheel.count;
+        for (int b = 0; b < blocks && !sighted; b++) {
+          visited += world.blocks[b].move_count;
+        }
+      }
+      double elapsed = now_seconds() - start;
+      printf("%8d %9d %8s %10.0f %10.0f\n", crowds[c], cooldown,
+             sighted ? "yes" : "no", visited / COOLDOWN_TICKS,
+             elapsed * 1e9 / COOLDOWN_TICKS);
+      sim_free(&world);
+    }
+  }
+  return 0;
+}
+
+// the same blind games (no perception, pathing or fleeing) one world at
+// a time through sim_step and WIDE_LANES at a time through the wide
+// backend, autopilot input; what counts is world-ticks per second
+static int run_wide_bench(unsigned int seed, const Tuning *tuning) {
+  Tuning blind = *tuning;
+  blind.enemy_perception = 0;
+  blind.enemy_pathing = 0;
+  blind.enemy_flee = 0;
+
+  unsigned long scalar_hash = 0;
+  double start = now_seconds();
+  for (int g = 0; g < WIDE_GAMES; g++) {
+    World world;
+    Autopilot pilot;
+    if (!sim_init(&world, seed + g, &blind)) {
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+    }
+    autopilot_init(&pilot, seed + g);
+    for (int t = 0; t < WIDE_TICKS; t++) {
+      sim_step(&world, autopilot_input(&pilot, &world.player));
+    }
+    scalar_hash += world.player.dirt_dug;
+    sim_free(&world);
+  }
+  double scalar = now_seconds() - start;
+
+  unsigned long wide_hash = 0;
+  start = now_seconds();
+  for (int g = 0; g < WIDE_GAMES; g += WIDE_LANES) {
+    static WideWorld wide;
+    unsigned int seeds[WIDE_LANES];
+    Autopilot pilots[WIDE_LANES];
+    for (int l = 0; l < WIDE_LANES; l++) {
+      seeds[l] = seed + g + l;
+      autopilot_init(&pilots[l], seeds[l]);
+    }
+    if (!wide_init(&wide, seeds, &blind)) {
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+    }
+    for (int t = 0; t < WIDE_TICKS; t++) {
+      int inputs[WIDE_LANES];
+      for (int l = 0; l < WIDE_LANES; l++) {
+        Player player = {.move_slowdown = wide.player_slowdown[l]};
+        inputs[l] = autopilot_input(&pilots[l], &player);
+      }
+      wide_step(&wide, inputs);
+    }
+    for (int l = 0; l < WIDE_LANES; l++) {
+      wide_hash += wide.dirt_dug[l];
+    }
+    wide_free(&wide);
+  }
+  double wide = now_seconds() - start;
+
+  double ticks = (double)WIDE_GAMES * WIDE_TICKS;
+  printf("%d games x %d ticks, blind rules\n", WIDE_GAMES, WIDE_TICKS);
+  printf("sim_step: %10.0f world-ticks/s\n", ticks / scalar);
+  printf("wide:     %10.0f world-ticks/s (%d lanes, %.1fx)\n", ticks / wide,
+         WIDE_LANES, scalar / wide);
+  if (scalar_hash != wide_hash) {
+    printf("dirt dug differs: %lu vs %lu\n", scalar_hash, wide_hash);
+    return 1;
+  }
+  return 0;
+}
+
+// one kernel table's three passes on a level, repeated until they've
+// gone over KERNEL_BENCH_TILES tiles; seconds for each
+typedef struct {
+  const TileType *tiles;
+  const int *cost;
+  const short *open;
+  int start;
+  int rock; // bfs target that is never reached
+  uint8_t *player;
+  uint8_t *enemy;
+  int *dist;
+  int *queue;
+  bool *queued;
+} KernelLevel;
+
+static void time_kernels(const GridKernels *k, int width, int height,
+                         KernelLevel *level, double seconds[3]) {
+  int count = width * height;
+  int reps = KERNEL_BENCH_TILES / count;
+  double start = now_seconds();
+  for (int r = 0; r < reps; r++) {
+    k->walkmasks(width, height, level->tiles, level->player, level->enemy);
+  }
+  seconds[0] = now_seconds() - start;
+  // a whole distance field each time, like a level load
+  start = now_seconds();
+  for (int r = 0; r < reps; r++) {
+    for (int i = 0; i < count; i++) {
+      level->dist[i] = KERNEL_UNREACHABLE;
+    }
+    level->dist[level->start] = 0;
+    k->relax(width, height, level->cost, level->dist, level->start,
+             level->queue, level->queued);
+  }
+  seconds[1] = now_seconds() - start;
+  // the planner's search, all the way out from the start every time
+  start = now_seconds();
+  for (int r = 0; r < reps; r++) {
+    for (int i = 0; i < count; i++) {
+      level->dist[i] = -1;
+    }
+    level->dist[level->start] = 0;
+    level->queue[0] = level->start;
+    int head = 0, tail = 1;
+    k->bfs(width, height, level->open, level->dist, level->queue, &head,
+           &tail, level->rock);
+  }
+  seconds[2] = now_seconds() - start;
+}
+
+// every size with specialized kernels, against the generic ones on the
+// same random level
+static int run_kernel_bench(unsigned int seed) {
+  static const char *passes[3] = {"walkmasks", "relax", "bfs"};
+  unsigned int rng = rng_seed(seed);
+  printf("%8s %10s %12s %12s %8s\n", "size", "kernel", "sized ns/t",
+         "generic ns/t", "speedup");
+  for (int s = 0; s < kernels_sized_count(); s++) {
+    const GridKernels *k = kernels_sized(s);
+    int count = k->width * k->height;
+    TileType *tiles = malloc(count * sizeof *tiles);
+    int *cost = malloc(count * sizeof *cost);
+    short *open = malloc(count * sizeof *open);
+    uint8_t *player = malloc(count);
+    uint8_t *enemy = malloc(count);
+    int *dist = malloc(count * sizeof *dist);
+    int *queue = malloc(count * sizeof *queue);
+    bool *queued = calloc(count, sizeof *queued);
+    if (!tiles || !cost || !open || !player || !enemy || !dist || !queue ||
+        !queued) {
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+    }
+    // mostly dirt, some tunnels and rocks, like a level part way through
+    for (int i = 0; i < count; i++) {
+      int roll = rng_range(&rng, 10);
+      tiles[i] = roll == 0 ? TILE_ROCK : roll < 7 ? TILE_DIRT : TILE_TUNNEL;
+      cost[i] = tiles[i] == TILE_ROCK   ? KERNEL_UNREACHABLE
+                : tiles[i] == TILE_DIRT ? 9
+                                        : 3;
+      open[i] = tiles[i] == TILE_ROCK ? -1 : 0;
+    }
+    // a rock in the corner, so the search always runs out the whole level
+    tiles[0] = TILE_ROCK;
+    cost[0] = KERNEL_UNREACHABLE;
+    open[0] = -1;
+    KernelLevel level = {tiles,  cost, open,  count / 2, 0,
+                         player, enemy, dist, queue,     queued};
+    cost[level.start] = 3;
+    open[level.start] = 0;
+    double sized[3], generic[3];
+    time_kernels(k, k->width, k->height, &level, sized);
+    time_kernels(kernels_generic(), k->width, k->height, &level, generic);
+    double tiles_done = (double)(KERNEL_BENCH_TILES / count) * count;
+    for (int p = 0; p < 3; p++) {
+      printf("%8s %10s %12.2f %12.2f %7.2fx\n", k->name, passes[p],
+             sized[p] * 1e9 / tiles_done, generic[p] * 1e9 / tiles_done,
+             generic[p] / sized[p]);
+    }
+    free(tiles);
+    free(cost);
+    free(open);
+    free(player);
+    free(enemy);
+    free(dist);
+    free(queue);
+    free(queued);
+  }
+  return 0;
+}
+
+// plays the whole timeline once, noting the hash at random ticks, then
+// seeks to those ticks in random order and checks it lands on the same
+// world; reports how long a seek takes
+static int run_scrub(const char *path, const Tuning *tuning) {
+  Timeline timeline;
+  if (!timeline_open(&timeline, path)) {
+    return 1;
+  }
+  if (!tuning_matches(tuning, timeline.tuning_digest, path)) {
+    timeline_close(&timeline);
+    return 1;
+  }
+  unsigned long first = timeline.first_tick;
+  unsigned long last = first + (unsigned long)timeline.tick_count;
+
+  static unsigned long ticks[SCRUB_SEEKS];
+  static uint64_t hashes[SCRUB_SEEKS];
+  unsigned int rng = rng_seed(timeline.seed ^ 0x5C2Bu);
+  for (int i = 0; i < SCRUB_SEEKS; i++) {
+    ticks[i] = first + rng_range(&rng, (int)(last - first + 1));
+  }
+
+  World world;
+  if (!sim_init(&world, timeline.seed, tuning) ||
+      !timeline_seek(&timeline, &world, first)) {
+    fprintf(stderr, "Cannot start %s\n", path);
+    timeline_close(&timeline);
+    return 1;
+  }
+  double start = now_seconds();
+  for (unsigned long t = first; t <= last; t++) {
+    for (int i = 0; i < SCRUB_SEEKS; i++) {
+      if (ticks[i] == t) {
+        hashes[i] = sim_hash(&world);
+      }
+    }
+    if (t < last) {
+      sim_step(&world, timeline_input(&timeline, t));
+    }
+  }
+  double play = now_seconds() - start;
+
+  int status = 0;
+  double worst = 0;
+  start = now_seconds();
+  for (int n = 0; n < SCRUB_SEEKS; n++) {
+    int i = (n * 7919) % SCRUB_SEEKS; // out of order
+    double seek_start = now_seconds();
+    if (!timeline_seek(&timeline, &world, ticks[i])) {
+      printf("scrub: seek to tick %lu fails, broken keyframe\n", ticks[i]);
+      status = 1;
+      break;
+    }
+    if (sim_hash(&world) != hashes[i]) {
+      printf("scrub: seek to tick %lu lands on a different world\n",
+             ticks[i]);
+      status = 1;
+      break;
+    }
+    double took = now_seconds() - seek_start;
+    worst = took > worst ? took : worst;
+  }
+  double seeking = now_seconds() - start;
+
+  if (status == 0) {
+    printf("scrub: %llu ticks, %u keyframes; straight through %.3f s, "
+           "%d seeks avg %.3f ms max %.3f ms\n",
+           timeline.tick_count, timeline.block_count, play, SCRUB_SEEKS,
+           seeking / SCRUB_SEEKS * 1000, worst * 1000);
+  }
+  sim_free(&world);
+  timeline_close(&timeline);
+  return status;
+}
+
+static int run_sweep(const char **specs, int count, const Tuning *tuning,
+                     int seeds, unsigned long ticks, unsigned int seed,
+                     bool early_stop, const char *path,
+                     const char *episodes) {
+  Sweep sweep = {.base = tuning,
+                 .seeds = seeds,
+                 .first_seed = seed,
+                 .ticks = ticks,
+                 .early_stop = early_stop,
+                 .episodes = episodes};
+  for (int i = 0; i < count; i++) {
+    if (!sweep_add_axis(&sweep, specs[i])) {
+      return 1;
+    }
+  }
+  FILE *out = path ? fopen(path, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "Cannot write %s\n", path);
+    return 1;
+  }
+  int status = sweep_run(&sweep, out);
+  if (path && fclose(out) != 0) {
+    fprintf(stderr, "Failed writing %s\n", path);
+    status = 1;
+  }
+  return status;
+}
+
+typedef struct {
+  const ColumnStore *store;
+  const int *columns;
+  int count;
+  unsigned long long rows;
+  long long sums[MAX_COLUMNS];
+  int min[MAX_COLUMNS];
+  int max[MAX_COLUMNS];
+  unsigned long long codes[MAX_COLUMNS][256]; // rows per enum code
+} ScanTotals;
+
+static void add_scanned(void *arg, int rows, int *const *values) {
+  ScanTotals *totals = arg;
+  for (int i = 0; i < totals->count; i++) {
+    const int *v = values[i];
+    if (totals->store->types[totals->columns[i]] == COLUMN_ENUM) {
+      for (int r = 0; r < rows; r++) {
+        totals->codes[i][v[r] & 0xFF]++;
+      }
+      continue;
+    }
+    for (int r = 0; r < rows; r++) {
+      totals->sums[i] += v[r];
+      totals->min[i] = v[r] < totals->min[i] ? v[r] : totals->min[i];
+      totals->max[i] = v[r] > totals->max[i] ? v[r] : totals->max[i];
+    }
+  }
+  totals->rows += rows;
+}
+
+// list: comma separated column names, NULL = every column
+static int run_scan(const char *path, const char *list) {
+  ColumnStore store;
+  if (!colstore_open(&store, path)) {
+    return 1;
+  }
+  int columns[MAX_COLUMNS];
+  int count = 0;
+  for (const char *name = list; name && *name;) {
+    size_t length = strcspn(name, ",");
+    char key[COLUMN_NAME_SIZE];
+    snprintf(key, sizeof key, "%.*s", (int)length, name);
+    int column = colstore_column(&store, key);
+    if (column < 0 || length >= sizeof key || count == MAX_COLUMNS) {
+      fprintf(stderr, "%s has no column %.*s\n", path, (int)length, name);
+      colstore_close(&store);
+      return 1;
+    }
+    columns[count++] = column;
+    name += length + (name[length] == ',');
+  }
+  if (!list) {
+    for (int c = 0; c < store.column_count; c++) {
+      columns[count++] = c;
+    }
+  }
+
+  static ScanTotals totals;
+  memset(&totals, 0, sizeof totals);
+  totals.store = &store;
+  totals.columns = columns;
+  totals.count = count;
+  for (int i = 0; i < count; i++) {
+    totals.min[i] = INT_MAX;
+    totals.max[i] = INT_MIN;
+  }
+  size_t bytes_read;
+  double start = now_seconds();
+  bool ok = colstore_scan(&store, columns, count, add_scanned, &totals,
+                          &bytes_read);
+  double elapsed = now_seconds() - start;
+  if (ok) {
+    printf("scan: %llu rows, %d of %d columns, %zu of %zu bytes read in "
+           "%.3f s\n",
+           totals.rows, count, store.column_count, bytes_read, store.map_size,
+           elapsed);
+  }
+  for (int i = 0; ok && i < count; i++) {
+    int column = columns[i];
+    printf("  %-24s", store.names[column]);
+    if (store.types[column] == COLUMN_INT) {
+      printf(" min %d  max %d  mean %.2f\n", totals.min[i], totals.max[i],
+             totals.rows ? (double)totals.sums[i] / totals.rows : 0.0);
+      continue;
+    }
+    for (int code = 0; code < 256; code++) {
+      char name[COLUMN_NAME_SIZE];
+      if (totals.codes[i][code] == 0) {
+        continue;
+      }
+      if (!colstore_enum_name(&store, column, code, name, sizeof name)) {
+        snprintf(name, sizeof name, "#%d", code);
+      }
+      printf(" %s %llu (%.1f%%)", name, totals.codes[i][code],
+             100.0 * totals.codes[i][code] / totals.rows);
+    }
+    printf("\n");
+  }
+  colstore_close(&store);
+  return ok ? 0 : 1;
+}
+
+static int run_verify_file(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return 1;
+  }
+
+  size_t size = 0, capacity = 4096;
+  unsigned char *data = malloc(capacity);
+  size_t n;
+  while (data && (n = fread(data + size, 1, capacity - size, file)) > 0) {
+    size += n;
+    if (size == capacity) {
+      capacity *= 2;
+      unsigned char *grown = realloc(data, capacity);
+      if (!grown) {
+        free(data);
+      }
+      data = grown;
+    }
+  }
+  fclose(file);
+  if (!data) {
+    fprintf(stderr, "Out of memory reading %s\n", path);
+    return 1;
+  }
+
+  char diff[2048];
+  long tick = verify_bytes(data, size, diff, sizeof diff);
+  free(data);
+  if (tick != -1) {
+    report_mismatch(0, tick, diff);
+    return 1;
+  }
+  printf("verify: %s matches reference\n", path);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long ticks = DEFAULT_TICKS;
+  unsigned int seed = DEFAULT_SEED;
+  const char *replay_path = NULL;
+  const char *record_path = NULL;
+  const char *timeline_path = NULL;
+  const char *scrub_path = NULL;
+  const char *bisect_paths[2] = {NULL, NULL};
+  int keyframe_ticks = TIMELINE_BLOCK_TICKS;
+  const char *scenario_name = NULL;
+  const char *tuning_path = NULL;
+  const char *verify_path = NULL;
+  bool verify = false;
+  bool ticks_given = false;
+  int seeds = VERIFY_SEEDS;
+  bool seeds_given = false;
+  int threads = 0;
+  bool threads_given = false;
+  const char *sweep_specs[MAX_SWEEP_AXES + 1];
+  int sweep_count = 0;
+  const char *sweep_path = NULL;
+  const char *episodes_path = NULL;
+  const char *scan_path = NULL;
+  const char *scan_columns = NULL;
+  bool early_stop = true;
+  bool cooldown_bench = false;
+  bool wide_bench = false;
+  bool kernel_bench = false;
+  int extra_enemies = 0;
+  bool flee = false;
+  int bot_playouts = 0;
+  int metrics_port = 0;
+  const char *metrics_path = NULL;
+  int metrics_interval = 10;
+  int metrics_hold = 0;
+  const char *event_path = NULL;
+  EventLogFormat event_format = EVENTLOG_JSONL;
+  LogLevel event_level = LOG_INFO;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+      ticks = strtoul(argv[++i], NULL, 10);
+      ticks_given = true;
+    } else if (strcmp(argv[i], "--verify") == 0) {
+      verify = true;
+    } else if (strcmp(argv[i], "--verify-file") == 0 && i + 1 < argc) {
+      verify_path = argv[++i];
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+      threads_given = true;
+    } else if (strcmp(argv[i], "--enemies") == 0 && i + 1 < argc) {
+      extra_enemies = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc) {
+      bot_playouts = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--flee") == 0) {
+      flee = true;
+    } else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+      seeds = atoi(argv[++i]);
+      seeds_given = true;
+    } else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc &&
+               sweep_count <= MAX_SWEEP_AXES) {
+      sweep_specs[sweep_count++] = argv[++i];
+    } else if (strcmp(argv[i], "--sweep-out") == 0 && i + 1 < argc) {
+      sweep_path = argv[++i];
+    } else if (strcmp(argv[i], "--episodes") == 0 && i + 1 < argc) {
+      episodes_path = argv[++i];
+    } else if (strcmp(argv[i], "--scan") == 0 && i + 1 < argc) {
+      scan_path = argv[++i];
+    } else if (strcmp(argv[i], "--columns") == 0 && i + 1 < argc) {
+      scan_columns = argv[++i];
+    } else if (strcmp(argv[i], "--cooldown-bench") == 0) {
+      cooldown_bench = true;
+    } else if (strcmp(argv[i], "--wide-bench") == 0) {
+      wide_bench = true;
+    } else if (strcmp(argv[i], "--kernel-bench") == 0) {
+      kernel_bench = true;
+    } else if (strcmp(argv[i], "--no-early-stop") == 0) {
+      early_stop = false;
+    } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+      metrics_port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--metrics-file") == 0 && i + 1 < argc) {
+      metrics_path = argv[++i];
+    } else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc) {
+      metrics_interval = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--metrics-hold") == 0 && i + 1 < argc) {
+      metrics_hold = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--event-log") == 0 && i + 1 < argc) {
+      event_path = argv[++i];
+    } else if (strcmp(argv[i], "--event-format") == 0 && i + 1 < argc &&
+               eventlog_parse_format(argv[i + 1], &event_format)) {
+      i++;
+    } else if (strcmp(argv[i], "--event-level") == 0 && i + 1 < argc &&
+               eventlog_parse_level(argv[i + 1], &event_level)) {
+      i++;
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+      timeline_path = argv[++i];
+    } else if (strcmp(argv[i], "--keyframe-ticks") == 0 && i + 1 < argc) {
+      keyframe_ticks = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--scrub") == 0 && i + 1 < argc) {
+      scrub_path = argv[++i];
+    } else if (strcmp(argv[i], "--bisect") == 0 && i + 2 < argc) {
+      bisect_paths[0] = argv[++i];
+      bisect_paths[1] = argv[++i];
+    } else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+      scenario_name = argv[++i];
+    } else if (strcmp(argv[i], "--tuning") == 0 && i + 1 < argc) {
+      tuning_path = argv[++i];
+    } else if (strcmp(argv[i], "--list-scenarios") == 0) {
+      for (int s = 0; s < scenario_builtin_count(); s++) {
+        printf("%s\n", scenario_builtin_name(s));
+      }
+      return 0;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  static Tuning tuning;
+  tuning = *tuning_defaults();
+  if (tuning_path && !tuning_load(&tuning, tuning_path)) {
+    return 1;
+  }
+  if (extra_enemies > 0) {
+    tuning.max_enemies += extra_enemies;
+  }
+  if (sweep_count > 0 && !threads_given) {
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1; // all cores
+  }
+  if (threads > 0 && !jobs_start(threads)) {
+    return 1;
+  }
+
+  if (verify_path) {
+    return run_verify_file(verify_path);
+  }
+  if (scrub_path) {
+    return run_scrub(scrub_path, &tuning);
+  }
+  if (scan_path) {
+    return run_scan(scan_path, scan_columns);
+  }
+  if (cooldown_bench) {
+    int status = run_cooldown_bench(seed, &tuning);
+    jobs_stop();
+    return status;
+  }
+  if (wide_bench) {
+    return run_wide_bench(seed, &tuning);
+  }
+  if (kernel_bench) {
+    return run_kernel_bench(seed);
+  }
+  if (sweep_count > 0) {
+    int status = run_sweep(sweep_specs, sweep_count, &tuning,
+                           seeds_given ? seeds : SWEEP_SEEDS,
+                           ticks_given ? ticks : SWEEP_TICKS, seed,
+                           early_stop, sweep_path, episodes_path);
+    jobs_stop();
+    return status;
+  }
+  if (bisect_paths[0]) {
+    int status = bisect_timelines(bisect_paths[0], bisect_paths[1], &tuning);
+    jobs_stop();
+    return status;
+  }
+  if (verify && !replay_path) {
+    int status = run_verify(seed, seeds, ticks_given ? ticks : VERIFY_TICKS,
+                            &tuning);
+    jobs_stop();
+    return status;
+  }
+
+  Replay replay;
+  if (replay_path) {
+    if (!replay_load(&replay, replay_path)) {
+      return 1;
+    }
+    if (!tuning_matches(&tuning, replay.tuning_digest, replay_path)) {
+      replay_free(&replay);
+      return 1;
+    }
+    seed = replay.seed;
+    ticks = replay.tick_count;
+
+    if (verify) {
+      char diff[2048];
+      long tick = verify_lockstep(seed, &tuning, replay.inputs,
+                                  replay.tick_count, diff, sizeof diff);
+      replay_free(&replay);
+      if (tick != -1) {
+        report_mismatch(seed, tick, diff);
+        return 1;
+      }
+      printf("verify: %s matches reference\n", replay_path);
+      return 0;
+    }
+  } else {
+    replay_init(&replay, seed, tuning_digest(&tuning));
+  }
+
+  // per tick timing only when someone is looking at the metrics
+  bool timed = metrics_port > 0 || metrics_path;
+  if (timed && !metrics_start(metrics_port, metrics_path, metrics_interval)) {
+    replay_free(&replay);
+    return 1;
+  }
+
+  // static: a Scenario is a few KB
+  static Scenario scenario;
+  ScenarioRun scenario_run;
+  if (scenario_name && !replay_path) {
+    if (!scenario_load(&scenario, scenario_name)) {
+      replay_free(&replay);
+      return 1;
+    }
+    if ((record_path || timeline_path) && scenario_spawns(&scenario)) {
+      fprintf(stderr, "Scenario %s spawns enemies, its replays wouldn't "
+                      "play back; not recording it\n",
+              scenario_name);
+      replay_free(&replay);
+      return 1;
+    }
+    scenario_start(&scenario_run, &scenario);
+  }
+
+  if (event_path && !eventlog_open(event_path, event_format, event_level)) {
+    replay_free(&replay);
+    return 1;
+  }
+
+  World world;
+  if (!sim_init(&world, seed, &tuning)) {
+    fprintf(stderr, "Out of memory for %d enemies\n", tuning.max_enemies);
+    replay_free(&replay);
+    return 1;
+  }
+  sim_spawn_crowd(&world, extra_enemies, seed);
+  world.parallel = threads > 0;
+  int fleeing = 0;
+  if (flee) {
+    fleeing = world.enemies_alive;
+    sim_flee(&world);
+  }
+
+  TimelineWriter timeline;
+  if (timeline_path &&
+      !timeline_writer_open(&timeline, timeline_path, seed,
+                            tuning_digest(&tuning), keyframe_ticks)) {
+    sim_free(&world);
+    replay_free(&replay);
+    return 1;
+  }
+
+  Autopilot pilot;
+  autopilot_init(&pilot, seed);
+  Bot bot;
+  if (bot_playouts > 0 && !bot_init(&bot, &world, seed, bot_playouts)) {
+    fprintf(stderr, "Out of memory for the bot\n");
+    sim_free(&world);
+    replay_free(&replay);
+    return 1;
+  }
+  unsigned long hits = 0;
+
+  double start = now_seconds();
+  unsigned long t;
+  for (t = 0; t < ticks && !(flee && world.enemies_alive == 0); t++) {
+    int input;
+    if (replay_path) {
+      input = replay.inputs[t];
+    } else {
+      input = scenario_name  ? scenario_next_input(&scenario_run, &world)
+              : bot_playouts ? bot_input(&bot, &world)
+                             : autopilot_input(&pilot, &world.player);
+      if (record_path) {
+        replay_record(&replay, input);
+      }
+    }
+    if (timeline_path) {
+      timeline_writer_record(&timeline, &world, input);
+    }
+
+    long long tick_start = timed ? metrics_now_ns() : 0;
+    if (sim_step(&world, input)) {
+      hits++;
+    }
+    if (timed) {
+      metrics_record(METRIC_TICK_TIME_NS, metrics_now_ns() - tick_start);
+    }
+  }
+  double elapsed = now_seconds() - start;
+  ticks = t;
+
+  printf("ticks: %lu  time: %.3f s  ticks/s: %.0f  hits: %lu  "
+         "dirt dug: %d  hash: %016llx\n",
+         ticks, elapsed, elapsed > 0 ? ticks / elapsed : 0.0, hits,
+         world.player.dirt_dug, (unsigned long long)sim_hash(&world));
+  if (flee) {
+    printf("fled: %d of %d enemies out\n", fleeing - world.enemies_alive,
+           fleeing);
+  }
+
+  if (bot_playouts > 0) {
+    printf("bot: %lu moves, %d playouts each; %lu new positions in the "
+           "trees, %.1f%% already there by another way\n",
+           bot.moves, bot.iterations, bot.expansions,
+           bot.expansions ? 100.0 * bot.transpositions / bot.expansions : 0.0);
+    bot_free(&bot);
+  }
+
+  int status = 0;
+  if (replay_path && replay.checksum != 0) {
+    if (sim_zobrist(&world) == replay.checksum) {
+      printf("replay checksum: ok\n");
+    } else {
+      printf("replay checksum: MISMATCH, the replay ends in a different "
+             "world (other tuning or --enemies, or a determinism bug)\n");
+      status = 1;
+    }
+  } else if (record_path) {
+    replay.checksum = sim_zobrist(&world);
+  }
+
+  if (timed) {
+    // give scrapers a chance to see the final numbers
+    struct timespec hold = {metrics_hold, 0};
+    nanosleep(&hold, NULL);
+    metrics_stop();
+  }
+
+  sim_free(&world);
+  jobs_stop();
+  eventlog_close();
+
+  if (record_path && !replay_save(&replay, record_path)) {
+    status = 1;
+  }
+  if (timeline_path && !timeline_writer_close(&timeline)) {
+    status = 1;
+  }
+  replay_free(&replay);
+  return status;
+}
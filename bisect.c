@@ -0,0 +1,181 @@
+#include "bisect.h"
+#include "jobs.h"
+#include "sim.h"
+#include "timeline.h"
+#include "verify.h"
+#include <stdio.h>
+#include <string.h>
+
+static bool same_keyframe(const Timeline *a, const Timeline *b, unsigned i) {
+  size_t size_a, size_b;
+  const unsigned char *state_a = timeline_keyframe(a, i, &size_a);
+  const unsigned char *state_b = timeline_keyframe(b, i, &size_b);
+  return size_a == size_b && memcmp(state_a, state_b, size_a) == 0;
+}
+
+// both files have to be the same game: same seed, keyframes at the same
+// ticks and the same inputs
+static bool same_game(const Timeline *a, const Timeline *b) {
+  if (a->seed != b->seed || a->block_ticks != b->block_ticks ||
+      a->first_tick != b->first_tick || a->tick_count != b->tick_count ||
+      a->block_count != b->block_count) {
+    return false;
+  }
+  unsigned long last = a->first_tick + (unsigned long)a->tick_count;
+  for (unsigned long t = a->first_tick; t < last; t++) {
+    if (timeline_input(a, t) != timeline_input(b, t)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool load_keyframe(World *world, const Timeline *timeline,
+                          unsigned i) {
+  size_t size;
+  const unsigned char *state = timeline_keyframe(timeline, i, &size);
+  return sim_load_state(world, state, size);
+}
+
+static void print_diff(const World *a, const World *b, const char *name_a,
+                       const char *name_b) {
+  char diff[2048];
+  verify_compare(a, b, diff, sizeof diff);
+  printf("  (%s vs %s)\n%s", name_a, name_b, diff);
+}
+
+// first keyframe that differs, block_count if none do
+// keyframe 0 is checked by the caller
+static unsigned first_split(const Timeline *a, const Timeline *b) {
+  unsigned lo = 1;
+  unsigned hi = a->block_count;
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo) / 2;
+    if (same_keyframe(a, b, mid)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// worlds: four from sim_init with the recordings' seed and tuning
+static int bisect(const Timeline *a, const Timeline *b, const char *path_a,
+                  const char *path_b, World worlds[4]) {
+  World *serial = &worlds[0];
+  World *parallel = &worlds[1];
+  World *keyframe_a = &worlds[2];
+  World *keyframe_b = &worlds[3];
+
+  if (!same_keyframe(a, b, 0)) {
+    // split before the recording even started (level setup, crowds)
+    if (load_keyframe(keyframe_a, a, 0) && load_keyframe(keyframe_b, b, 0)) {
+      printf("bisect: first mismatch at tick %lu, the first keyframe\n",
+             timeline_keyframe_tick(a, 0));
+      print_diff(keyframe_a, keyframe_b, path_a, path_b);
+    }
+    return 1;
+  }
+
+  unsigned split = first_split(a, b);
+  unsigned start = split - 1; // both agree here
+  unsigned long end = split < a->block_count
+                          ? timeline_keyframe_tick(a, split)
+                          : a->first_tick + (unsigned long)a->tick_count;
+  if (!load_keyframe(serial, a, start) || !load_keyframe(parallel, a, start)) {
+    fprintf(stderr, "Keyframe %u doesn't load with this tuning\n", start);
+    return 1;
+  }
+  serial->parallel = false;
+  parallel->parallel = jobs_worker_count() > 0;
+  const char *name_serial = "serial";
+  const char *name_parallel = parallel->parallel ? "parallel" : "serial";
+
+  // play the block on both backends, compare every tick
+  while (serial->tick < end) {
+    int input = timeline_input(a, serial->tick);
+    sim_step(serial, input);
+    sim_step(parallel, input);
+    if (sim_hash(serial) != sim_hash(parallel)) {
+      printf("bisect: first mismatch at tick %lu, this build %s vs %s\n",
+             serial->tick, name_serial, name_parallel);
+      print_diff(serial, parallel, name_serial, name_parallel);
+      return 1;
+    }
+  }
+
+  if (split == a->block_count) {
+    printf("bisect: %s and %s agree on all %u keyframes, and this build "
+           "plays on to tick %lu the same way\n",
+           path_a, path_b, a->block_count, end);
+    return 0;
+  }
+
+  // this build agrees with itself: one of the recording builds went its
+  // own way somewhere in this block
+  if (!load_keyframe(keyframe_a, a, split) ||
+      !load_keyframe(keyframe_b, b, split)) {
+    fprintf(stderr, "Keyframe %u doesn't load with this tuning\n", split);
+    return 1;
+  }
+  unsigned long from = timeline_keyframe_tick(a, start) + 1;
+  if (from == end) {
+    printf("bisect: first mismatch at tick %lu\n", end);
+  } else {
+    printf("bisect: first mismatch between tick %lu and %lu (keyframes "
+           "every %d ticks, record with --keyframe-ticks 1 for the exact "
+           "tick)\n",
+           from, end, a->block_ticks);
+  }
+  uint64_t here = sim_hash(serial);
+  printf("bisect: this build agrees with %s\n",
+         here == sim_hash(keyframe_a)   ? path_a
+         : here == sim_hash(keyframe_b) ? path_b
+                                        : "neither");
+  print_diff(keyframe_a, keyframe_b, path_a, path_b);
+  return 1;
+}
+
+int bisect_timelines(const char *path_a, const char *path_b,
+                     const Tuning *tuning) {
+  Timeline a, b;
+  if (!timeline_open(&a, path_a)) {
+    return 1;
+  }
+  if (!timeline_open(&b, path_b)) {
+    timeline_close(&a);
+    return 1;
+  }
+
+  int status = 1;
+  if (!tuning_matches(tuning, a.tuning_digest, path_a) ||
+      !tuning_matches(tuning, b.tuning_digest, path_b)) {
+    // nothing to compare against
+  } else if (!same_game(&a, &b)) {
+    fprintf(stderr,
+            "%s and %s are not the same game (seed, inputs or keyframe "
+            "spacing differ)\n",
+            path_a, path_b);
+  } else if (a.block_count == 0) {
+    printf("bisect: both recordings are empty\n");
+    status = 0;
+  } else {
+    World worlds[4];
+    int ready = 0;
+    while (ready < 4 && sim_init(&worlds[ready], a.seed, tuning)) {
+      ready++;
+    }
+    if (ready < 4) {
+      fprintf(stderr, "Out of memory for %d enemies\n", tuning->max_enemies);
+    } else {
+      status = bisect(&a, &b, path_a, path_b, worlds);
+    }
+    for (int i = 0; i < ready; i++) {
+      sim_free(&worlds[i]);
+    }
+  }
+  timeline_close(&a);
+  timeline_close(&b);
+  return status;
+}
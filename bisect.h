@@ -0,0 +1,28 @@
+#ifndef BISECT_H
+#define BISECT_H
+
+#include "tuning.h"
+
+// Finds where two runs of the same game stop agreeing. Record the same
+// replay twice as indexed replays (--timeline), from two builds or from
+// the serial and the parallel enemy update, then hand both files over:
+//
+//   1. binary search the keyframes for the first one that differs (the
+//      files are mapped, nothing is simulated for this)
+//   2. load the last keyframe both agree on and play that block here
+//      twice, serial and (with worker threads running) parallel, hashing
+//      both worlds every tick; if they split, that's the tick
+//   3. otherwise the difference is in a build that made one of the files:
+//      it's somewhere in that block, the keyframe at its end tells which
+//      file this build agrees with (keyframes every tick pin it exactly)
+//
+// The first mismatch is printed with a field by field diff of the two
+// worlds (grid cells, player, enemies). Assumes two runs that split stay
+// split, as bisecting always does.
+
+// tuning must be the one both were recorded with
+// returns 0 if the runs agree, 1 if they don't or the files are unusable
+int bisect_timelines(const char *path_a, const char *path_b,
+                     const Tuning *tuning);
+
+#endif
@@ -0,0 +1,192 @@
+#include "bot.h"
+#include "metrics.h"
+#include "rng.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TREE_DEPTH 12   // moves down the tree before the random part
+#define PLAYOUT_MOVES 8 // random moves after leaving the tree
+#define STAND_TICKS 4   // standing still lasts about as long as a move
+#define DIG_GOAL 8      // digging this much in a playout is as good as it gets
+#define EXPLORE 1.0     // UCB1 exploration weight (results are 0..1)
+
+bool bot_init(Bot *bot, const World *world, unsigned int seed,
+              int iterations) {
+  memset(bot, 0, sizeof *bot);
+  if (!sim_init(&bot->scratch, seed, world->tuning)) {
+    return false;
+  }
+  bot->iterations = iterations > 0 ? iterations : 1;
+  bot->node_capacity = bot->iterations + 1; // one new node per playout
+  int table_size = 1;
+  while (table_size < bot->node_capacity * 2) {
+    table_size *= 2;
+  }
+  bot->table_mask = table_size - 1;
+  bot->nodes = malloc(bot->node_capacity * sizeof *bot->nodes);
+  bot->table = malloc(table_size * sizeof *bot->table);
+  metrics_add(METRIC_ALLOCATIONS, 2);
+  bot->rng = rng_seed(seed ^ 0xB07u);
+  if (!bot->nodes || !bot->table) {
+    bot_free(bot);
+    return false;
+  }
+  return true;
+}
+
+void bot_free(Bot *bot) {
+  sim_free(&bot->scratch);
+  free(bot->nodes);
+  free(bot->table);
+  bot->nodes = NULL;
+  bot->table = NULL;
+}
+
+// node for key, or -1; linear probing
+static int table_find(const Bot *bot, uint64_t key) {
+  for (uint64_t i = key;; i++) {
+    int node = bot->table[i & bot->table_mask];
+    if (node < 0 || bot->nodes[node].key == key) {
+      return node;
+    }
+  }
+}
+
+// -1 once the tree is full
+static int add_node(Bot *bot, uint64_t key) {
+  if (bot->node_count == bot->node_capacity) {
+    return -1;
+  }
+  int node = bot->node_count++;
+  BotNode *n = &bot->nodes[node];
+  n->key = key;
+  n->visits = 0;
+  n->value = 0;
+  for (int m = 0; m < BOT_MOVES; m++) {
+    n->child[m] = -1;
+  }
+  uint64_t i = key;
+  while (bot->table[i & bot->table_mask] >= 0) {
+    i++;
+  }
+  bot->table[i & bot->table_mask] = node;
+  return node;
+}
+
+// one input, then the ticks until the player can move again
+static void play_move(World *world, int move) {
+  sim_step(world, move);
+  int wait = move == INPUT_NONE ? STAND_TICKS - 1 : 0;
+  while (world->player.is_alive &&
+         (world->player.move_slowdown > 0 || wait > 0)) {
+    sim_step(world, INPUT_NONE);
+    wait--;
+  }
+}
+
+static int pick_ucb(const Bot *bot, const BotNode *node) {
+  double log_visits = log(node->visits > 0 ? node->visits : 1);
+  int best = 0;
+  double best_score = -1;
+  for (int m = 0; m < BOT_MOVES; m++) {
+    const BotNode *child = &bot->nodes[node->child[m]];
+    double score = child->visits == 0
+                       ? 2.0
+                       : child->value / child->visits +
+                             EXPLORE * sqrt(log_visits / child->visits);
+    if (score > best_score) {
+      best_score = score;
+      best = m;
+    }
+  }
+  return best;
+}
+
+static int untried_move(Bot *bot, const BotNode *node) {
+  int untried[BOT_MOVES];
+  int count = 0;
+  for (int m = 0; m < BOT_MOVES; m++) {
+    if (node->child[m] < 0) {
+      untried[count++] = m;
+    }
+  }
+  return count ? untried[rng_range(&bot->rng, count)] : -1;
+}
+
+// down the tree, one new node, random moves to the end, then every node
+// on the way gets the result
+static void playout(Bot *bot, const World *world, int root) {
+  World *scratch = &bot->scratch;
+  sim_copy(scratch, world);
+  scratch->parallel = false; // playouts are too short to be worth it
+  int dug_before = scratch->player.dirt_dug;
+
+  int path[TREE_DEPTH + 1];
+  int path_length = 0;
+  int node = root;
+  path[path_length++] = node;
+  while (path_length <= TREE_DEPTH && scratch->player.is_alive) {
+    int move = untried_move(bot, &bot->nodes[node]);
+    if (move >= 0) {
+      play_move(scratch, move);
+      uint64_t key = sim_zobrist(scratch);
+      int child = table_find(bot, key);
+      bot->expansions++;
+      if (child >= 0) {
+        bot->transpositions++;
+      } else {
+        child = add_node(bot, key);
+      }
+      if (child >= 0) {
+        bot->nodes[node].child[move] = child;
+        path[path_length++] = child;
+      }
+      break;
+    }
+    move = pick_ucb(bot, &bot->nodes[node]);
+    play_move(scratch, move);
+    node = bot->nodes[node].child[move];
+    path[path_length++] = node;
+  }
+
+  for (int m = 0; m < PLAYOUT_MOVES && scratch->player.is_alive; m++) {
+    play_move(scratch, rng_range(&bot->rng, BOT_MOVES));
+  }
+
+  double result = 0;
+  if (scratch->player.is_alive) {
+    int dug = scratch->player.dirt_dug - dug_before;
+    result = 0.5 + 0.5 * (dug < DIG_GOAL ? dug : DIG_GOAL) / DIG_GOAL;
+  }
+  for (int i = 0; i < path_length; i++) {
+    bot->nodes[path[i]].visits++;
+    bot->nodes[path[i]].value += result;
+  }
+}
+
+int bot_input(Bot *bot, const World *world) {
+  if (!world->player.is_alive || world->player.move_slowdown > 0) {
+    return INPUT_NONE;
+  }
+
+  // a new tree for every move: the world moved on under the old one
+  bot->node_count = 0;
+  memset(bot->table, -1, (bot->table_mask + 1) * sizeof *bot->table);
+  int root = add_node(bot, sim_zobrist(world));
+  for (int i = 0; i < bot->iterations; i++) {
+    playout(bot, world, root);
+  }
+  bot->moves++;
+
+  int best = INPUT_NONE;
+  int best_visits = -1;
+  for (int m = 0; m < BOT_MOVES; m++) {
+    int child = bot->nodes[root].child[m];
+    if (child >= 0 && bot->nodes[child].visits > best_visits) {
+      best_visits = bot->nodes[child].visits;
+      best = m;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,56 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Player bot: Monte Carlo tree search over the player's moves.
+//
+// Whenever the player can move, the bot plays a few hundred short futures
+// on a scratch copy of the world: down the tree by UCB1 while it knows the
+// moves, then random moves to the end of the playout. A future is worth
+// 0 if the player gets caught, otherwise more the more dirt got dug. The
+// move the most futures went through is the one it makes.
+//
+// A move is one input followed by waiting until the player can move again,
+// so the tree is in the player's moves, not in ticks. Positions reached by
+// different moves (down then right, right then down) are one node: the
+// transposition table maps sim_zobrist keys to nodes, so their playouts
+// count for both ways of getting there.
+
+#define BOT_MOVES (INPUT_NONE + 1) // four directions and standing still
+
+typedef struct {
+  uint64_t key;  // sim_zobrist of the position
+  int visits;
+  double value;  // summed playout results
+  int child[BOT_MOVES]; // node after each move, -1 = not tried yet
+} BotNode;
+
+typedef struct {
+  World scratch;   // playouts run on this copy
+  BotNode *nodes;  // the tree, rebuilt for every move
+  int node_count;
+  int node_capacity;
+  int *table;      // transposition table: node index, -1 = empty
+  int table_mask;
+  int iterations;  // playouts per move
+  unsigned int rng;
+  // totals for the whole game
+  unsigned long moves;
+  unsigned long expansions;     // new positions reached in the tree
+  unsigned long transpositions; // of those, ones the table already had
+} Bot;
+
+// scratch world with world's tuning and room for its enemies
+// false if out of memory; free with bot_free
+bool bot_init(Bot *bot, const World *world, unsigned int seed,
+              int iterations);
+
+void bot_free(Bot *bot);
+
+// input for the next tick (INPUT_NONE while the player can't move)
+int bot_input(Bot *bot, const World *world);
+
+#endif
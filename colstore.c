@@ -0,0 +1,439 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "colstore.h"
+#include "lz.h"
+#include "metrics.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define COLSTORE_MAGIC "DDCS"
+#define COLSTORE_VERSION 1
+#define HEADER_SIZE 16
+#define FOOTER_SIZE 12
+
+static size_t value_size(ColumnType type) {
+  return type == COLUMN_ENUM ? 1 : 4;
+}
+
+// ===== writing =====
+
+static bool write_u32(FILE *file, unsigned int value) {
+  unsigned char bytes[4] = {value & 0xFF, (value >> 8) & 0xFF,
+                            (value >> 16) & 0xFF, (value >> 24) & 0xFF};
+  return fwrite(bytes, 1, 4, file) == 4;
+}
+
+static bool write_u64(FILE *file, unsigned long long value) {
+  return write_u32(file, (unsigned int)value) &&
+         write_u32(file, (unsigned int)(value >> 32));
+}
+
+static bool write_name(FILE *file, const char *name) {
+  size_t length = strlen(name);
+  return fputc((int)length, file) != EOF &&
+         fwrite(name, 1, length, file) == length;
+}
+
+static void free_writer(ColumnWriter *writer) {
+  for (int c = 0; c < MAX_COLUMNS; c++) {
+    free(writer->values[c]);
+    free(writer->names[c]);
+    writer->values[c] = NULL;
+    writer->names[c] = NULL;
+  }
+  free(writer->raw);
+  free(writer->packed);
+  free(writer->groups);
+  writer->raw = NULL;
+  writer->packed = NULL;
+  writer->groups = NULL;
+}
+
+bool colstore_writer_open(ColumnWriter *writer, const char *path,
+                          const ColumnSpec *columns, int count) {
+  memset(writer, 0, sizeof *writer);
+  writer->path = path;
+  writer->column_count = count;
+  if (count < 1 || count > MAX_COLUMNS) {
+    fprintf(stderr, "A column store takes 1 to %d columns\n", MAX_COLUMNS);
+    return false;
+  }
+  bool ok = true;
+  for (int c = 0; c < count; c++) {
+    writer->types[c] = columns[c].type;
+    writer->values[c] = malloc(COLSTORE_GROUP_ROWS * sizeof(int));
+    if (columns[c].type == COLUMN_ENUM) {
+      writer->names[c] = malloc(MAX_ENUM_NAMES * sizeof *writer->names[c]);
+      ok = ok && writer->names[c];
+    }
+    ok = ok && writer->values[c] &&
+         strlen(columns[c].name) < COLUMN_NAME_SIZE;
+  }
+  size_t raw_size = COLSTORE_GROUP_ROWS * sizeof(int);
+  writer->raw = malloc(raw_size);
+  writer->packed = malloc(lz_bound(raw_size));
+  metrics_add(METRIC_ALLOCATIONS, 2 + count);
+  writer->file = ok && writer->raw && writer->packed ? fopen(path, "wb")
+                                                     : NULL;
+  if (!writer->file) {
+    fprintf(stderr, "Cannot write column store %s\n", path);
+    free_writer(writer);
+    return false;
+  }
+
+  FILE *file = writer->file;
+  ok = fwrite(COLSTORE_MAGIC, 1, 4, file) == 4 &&
+       write_u32(file, COLSTORE_VERSION) &&
+       write_u32(file, COLSTORE_GROUP_ROWS) && write_u32(file, count);
+  writer->offset = HEADER_SIZE;
+  for (int c = 0; ok && c < count; c++) {
+    ok = fputc(columns[c].type, file) != EOF &&
+         write_name(file, columns[c].name);
+    writer->offset += 2 + strlen(columns[c].name);
+  }
+  writer->failed = !ok;
+  return true;
+}
+
+int colstore_enum(ColumnWriter *writer, int column, const char *name) {
+  int count = writer->name_count[column];
+  for (int i = 0; i < count; i++) {
+    if (strcmp(writer->names[column][i], name) == 0) {
+      return i;
+    }
+  }
+  if (count == MAX_ENUM_NAMES || strlen(name) >= COLUMN_NAME_SIZE) {
+    return -1;
+  }
+  strcpy(writer->names[column][count], name);
+  writer->name_count[column]++;
+  return count;
+}
+
+// one column of the open group into raw: enum codes as bytes, ints as
+// byte planes
+static size_t encode_column(const ColumnWriter *writer, int column) {
+  const int *values = writer->values[column];
+  int rows = writer->rows;
+  if (writer->types[column] == COLUMN_ENUM) {
+    for (int r = 0; r < rows; r++) {
+      writer->raw[r] = (unsigned char)values[r];
+    }
+    return rows;
+  }
+  for (int r = 0; r < rows; r++) {
+    unsigned int v = (unsigned int)values[r];
+    writer->raw[r] = v & 0xFF;
+    writer->raw[rows + r] = (v >> 8) & 0xFF;
+    writer->raw[rows * 2 + r] = (v >> 16) & 0xFF;
+    writer->raw[rows * 3 + r] = v >> 24;
+  }
+  return (size_t)rows * 4;
+}
+
+static void flush_group(ColumnWriter *writer) {
+  size_t entry = writer->column_count + 1;
+  if (writer->group_count == writer->group_capacity) {
+    size_t capacity = writer->group_capacity ? writer->group_capacity * 2 : 64;
+    unsigned long long *grown =
+        realloc(writer->groups, capacity * entry * sizeof *grown);
+    if (!grown) {
+      writer->failed = true;
+      return;
+    }
+    writer->groups = grown;
+    writer->group_capacity = capacity;
+    metrics_add(METRIC_ALLOCATIONS, 1);
+  }
+  unsigned long long *group = &writer->groups[writer->group_count * entry];
+  group[0] = writer->rows;
+  for (int c = 0; c < writer->column_count && !writer->failed; c++) {
+    size_t raw_size = encode_column(writer, c);
+    size_t packed_size = lz_compress(writer->raw, raw_size, writer->packed);
+    group[c + 1] = writer->offset;
+    if (!write_u32(writer->file, (unsigned int)packed_size) ||
+        fwrite(writer->packed, 1, packed_size, writer->file) != packed_size) {
+      writer->failed = true;
+    }
+    writer->offset += 4 + packed_size;
+  }
+  writer->group_count++;
+  writer->rows = 0;
+}
+
+void colstore_writer_add(ColumnWriter *writer, const int *values) {
+  if (writer->failed) {
+    return;
+  }
+  for (int c = 0; c < writer->column_count; c++) {
+    writer->values[c][writer->rows] = values[c];
+  }
+  if (++writer->rows == COLSTORE_GROUP_ROWS) {
+    flush_group(writer);
+  }
+}
+
+bool colstore_writer_close(ColumnWriter *writer) {
+  FILE *file = writer->file;
+  if (!writer->failed && writer->rows > 0) {
+    flush_group(writer);
+  }
+
+  unsigned long long footer_offset = writer->offset;
+  bool ok = !writer->failed;
+  for (int c = 0; ok && c < writer->column_count; c++) {
+    ok = write_u32(file, writer->name_count[c]);
+    for (int i = 0; ok && i < writer->name_count[c]; i++) {
+      ok = write_name(file, writer->names[c][i]);
+    }
+  }
+  ok = ok && write_u32(file, (unsigned int)writer->group_count);
+  size_t entry = writer->column_count + 1;
+  for (size_t g = 0; ok && g < writer->group_count; g++) {
+    ok = write_u32(file, (unsigned int)writer->groups[g * entry]);
+    for (size_t c = 1; ok && c < entry; c++) {
+      ok = write_u64(file, writer->groups[g * entry + c]);
+    }
+  }
+  ok = ok && write_u64(file, footer_offset) &&
+       fwrite(COLSTORE_MAGIC, 1, 4, file) == 4;
+
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "Failed writing column store %s\n", writer->path);
+    ok = false;
+  }
+  free_writer(writer);
+  writer->file = NULL;
+  return ok;
+}
+
+// ===== reading =====
+
+static unsigned int read_u32(const unsigned char *b) {
+  return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+}
+
+static unsigned long long read_u64(const unsigned char *b) {
+  return read_u32(b) | (unsigned long long)read_u32(b + 4) << 32;
+}
+
+static size_t group_entry_size(const ColumnStore *store) {
+  return 4 + (size_t)store->column_count * 8;
+}
+
+static const unsigned char *group_at(const ColumnStore *store, unsigned g) {
+  return store->groups + 4 + g * group_entry_size(store);
+}
+
+// a length-prefixed name at *at (not past end) into out; moves *at on
+static bool read_name(const unsigned char **at, const unsigned char *end,
+                      char *out) {
+  if (*at >= end || **at >= COLUMN_NAME_SIZE || *at + 1 + **at > end) {
+    return false;
+  }
+  size_t length = **at;
+  memcpy(out, *at + 1, length);
+  out[length] = '\0';
+  *at += 1 + length;
+  return true;
+}
+
+// header columns, dictionaries and group index; chunks are checked when
+// they're scanned
+static bool parse(ColumnStore *store) {
+  const unsigned char *m = store->map;
+  size_t size = store->map_size;
+  const unsigned char *footer = m + size - FOOTER_SIZE;
+  unsigned long long data_end = read_u64(footer);
+  if (memcmp(m, COLSTORE_MAGIC, 4) != 0 ||
+      read_u32(m + 4) != COLSTORE_VERSION ||
+      memcmp(footer + 8, COLSTORE_MAGIC, 4) != 0 ||
+      data_end < HEADER_SIZE || data_end > size - FOOTER_SIZE) {
+    return false;
+  }
+  store->data_end = (size_t)data_end;
+  store->group_rows = (int)read_u32(m + 8);
+  store->column_count = (int)read_u32(m + 12);
+  if (store->group_rows < 1 || store->group_rows > COLSTORE_GROUP_ROWS ||
+      store->column_count < 1 || store->column_count > MAX_COLUMNS) {
+    return false;
+  }
+
+  const unsigned char *at = m + HEADER_SIZE;
+  for (int c = 0; c < store->column_count; c++) {
+    if (at >= m + data_end || *at > COLUMN_ENUM) {
+      return false;
+    }
+    store->types[c] = (ColumnType)*at++;
+    if (!read_name(&at, m + data_end, store->names[c])) {
+      return false;
+    }
+  }
+
+  at = m + data_end;
+  char name[COLUMN_NAME_SIZE];
+  for (int c = 0; c < store->column_count; c++) {
+    if (at + 4 > footer) {
+      return false;
+    }
+    unsigned int count = read_u32(at);
+    store->dictionaries[c] = at;
+    at += 4;
+    for (unsigned i = 0; i < count; i++) {
+      if (!read_name(&at, footer, name)) {
+        return false;
+      }
+    }
+  }
+  if (at + 4 > footer) {
+    return false;
+  }
+  store->groups = at;
+  store->group_count = read_u32(at);
+  if ((size_t)(footer - at - 4) !=
+      (size_t)store->group_count * group_entry_size(store)) {
+    return false;
+  }
+  for (unsigned g = 0; g < store->group_count; g++) {
+    unsigned int rows = read_u32(group_at(store, g));
+    if (rows < 1 || rows > (unsigned)store->group_rows) {
+      return false;
+    }
+    store->rows += rows;
+  }
+  return true;
+}
+
+bool colstore_open(ColumnStore *store, const char *path) {
+  memset(store, 0, sizeof *store);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open column store %s\n", path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE + 4 + FOOTER_SIZE) {
+    fprintf(stderr, "%s is not a column store\n", path);
+    close(fd);
+    return false;
+  }
+  size_t size = (size_t)st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping stays valid
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Cannot map column store %s\n", path);
+    return false;
+  }
+  store->map = map;
+  store->map_size = size;
+  if (!parse(store)) {
+    fprintf(stderr, "%s is not a column store (or is truncated)\n", path);
+    colstore_close(store);
+    return false;
+  }
+  return true;
+}
+
+void colstore_close(ColumnStore *store) {
+  if (store->map) {
+    munmap((void *)store->map, store->map_size);
+  }
+  store->map = NULL;
+  store->map_size = 0;
+  store->group_count = 0;
+}
+
+int colstore_column(const ColumnStore *store, const char *name) {
+  for (int c = 0; c < store->column_count; c++) {
+    if (strcmp(store->names[c], name) == 0) {
+      return c;
+    }
+  }
+  return -1;
+}
+
+bool colstore_enum_name(const ColumnStore *store, int column, int code,
+                        char *out, size_t size) {
+  const unsigned char *at = store->dictionaries[column];
+  if (code < 0 || (unsigned)code >= read_u32(at)) {
+    return false;
+  }
+  at += 4;
+  for (int i = 0; i < code; i++) {
+    at += 1 + *at; // checked in colstore_open
+  }
+  snprintf(out, size, "%.*s", (int)*at, (const char *)at + 1);
+  return true;
+}
+
+// a column of a group back to ints; false if the chunk is broken
+static bool decode_chunk(const ColumnStore *store, unsigned group, int column,
+                         unsigned char *raw, int *values, size_t *bytes_read) {
+  const unsigned char *entry = group_at(store, group);
+  int rows = (int)read_u32(entry);
+  unsigned long long offset = read_u64(entry + 4 + column * 8);
+  if (offset < HEADER_SIZE || offset + 4 > store->data_end) {
+    return false;
+  }
+  const unsigned char *chunk = store->map + offset;
+  size_t packed_size = read_u32(chunk);
+  size_t raw_size = rows * value_size(store->types[column]);
+  if (packed_size > store->data_end - offset - 4 ||
+      !lz_decompress(chunk + 4, packed_size, raw, raw_size)) {
+    return false;
+  }
+  *bytes_read += 4 + packed_size;
+  if (store->types[column] == COLUMN_ENUM) {
+    for (int r = 0; r < rows; r++) {
+      values[r] = raw[r];
+    }
+    return true;
+  }
+  for (int r = 0; r < rows; r++) {
+    values[r] = (int)(raw[r] | (raw[rows + r] << 8) |
+                      (raw[rows * 2 + r] << 16) |
+                      ((unsigned int)raw[rows * 3 + r] << 24));
+  }
+  return true;
+}
+
+bool colstore_scan(const ColumnStore *store, const int *columns, int count,
+                   ColumnScanFn fn, void *arg, size_t *bytes_read) {
+  size_t read = 0;
+  int *values[MAX_COLUMNS] = {NULL};
+  unsigned char *raw = malloc((size_t)store->group_rows * 4);
+  bool ok = raw != NULL && count <= MAX_COLUMNS;
+  for (int i = 0; ok && i < count; i++) {
+    values[i] = malloc((size_t)store->group_rows * sizeof(int));
+    ok = values[i] != NULL;
+  }
+  metrics_add(METRIC_ALLOCATIONS, 1 + count);
+  if (!ok) {
+    fprintf(stderr, "Out of memory scanning columns\n");
+  }
+
+  for (unsigned g = 0; ok && g < store->group_count; g++) {
+    for (int i = 0; ok && i < count; i++) {
+      ok = decode_chunk(store, g, columns[i], raw, values[i], &read);
+      if (!ok) {
+        fprintf(stderr, "Column %s of group %u is broken\n",
+                store->names[columns[i]], g);
+      }
+    }
+    if (ok) {
+      fn(arg, (int)read_u32(group_at(store, g)), values);
+    }
+  }
+  free(raw);
+  for (int i = 0; i < count; i++) {
+    free(values[i]);
+  }
+  if (bytes_read) {
+    *bytes_read = read;
+  }
+  return ok;
+}
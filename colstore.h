@@ -0,0 +1,108 @@
+#ifndef COLSTORE_H
+#define COLSTORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Column store for per-game stats out of batch runs (one row per game:
+// seed, round reached, ticks survived, ...). Rows are cut into groups of
+// COLSTORE_GROUP_ROWS and each column of a group is compressed on its own
+// (lz.h), so a reader only decompresses the columns it asks for and never
+// touches the rest of the file.
+//
+// Every value is an int. Integer columns are stored as byte planes (all
+// the low bytes of the group, then all the next ones, ...), which makes
+// the mostly-zero high bytes of small numbers compress to almost nothing.
+// Enum columns (what caught the player, ...) store one byte per row: an
+// index into the column's dictionary of names.
+//
+// file layout (little endian):
+//   "DDCS" | u32 version | u32 group_rows | u32 column_count
+//   per column:        u8 type | u8 name length | name
+//   per group, column: u32 packed size | packed bytes
+//   footer: per column: u32 dictionary size | per name: u8 length | name
+//           u32 group_count | per group: u32 rows | per column: u64 offset
+//           u64 footer offset | "DDCS"
+// The footer goes at the end, so rows are written as the games finish.
+
+#define COLSTORE_GROUP_ROWS 16384
+#define MAX_COLUMNS 16
+#define MAX_ENUM_NAMES 255
+#define COLUMN_NAME_SIZE 32 // names (columns and enum values) are shorter
+
+typedef enum { COLUMN_INT, COLUMN_ENUM } ColumnType;
+
+typedef struct {
+  const char *name;
+  ColumnType type;
+} ColumnSpec;
+
+typedef struct {
+  FILE *file;
+  const char *path;
+  int column_count;
+  ColumnType types[MAX_COLUMNS];
+  int *values[MAX_COLUMNS]; // rows of the open group, per column
+  int rows;
+  char (*names[MAX_COLUMNS])[COLUMN_NAME_SIZE]; // enum dictionaries
+  int name_count[MAX_COLUMNS];
+  unsigned char *raw;    // a column of a group before compressing
+  unsigned char *packed; // and after
+  unsigned long long offset; // bytes written so far
+  unsigned long long *groups; // per group: rows, then an offset per column
+  size_t group_count;
+  size_t group_capacity;
+  bool failed;
+} ColumnWriter;
+
+// prints the reason on failure
+bool colstore_writer_open(ColumnWriter *writer, const char *path,
+                          const ColumnSpec *columns, int count);
+
+// code of name in an enum column's dictionary, added if it's new
+// -1 if the name is too long or the dictionary is full
+int colstore_enum(ColumnWriter *writer, int column, const char *name);
+
+// one row: a value per column (codes from colstore_enum for enums)
+void colstore_writer_add(ColumnWriter *writer, const int *values);
+
+// writes the last group and the footer; false if anything failed
+bool colstore_writer_close(ColumnWriter *writer);
+
+typedef struct {
+  const unsigned char *map; // the whole file, read only
+  size_t map_size;
+  int group_rows;
+  int column_count;
+  char names[MAX_COLUMNS][COLUMN_NAME_SIZE];
+  ColumnType types[MAX_COLUMNS];
+  const unsigned char *dictionaries[MAX_COLUMNS]; // in the footer
+  const unsigned char *groups; // the group index in the footer
+  unsigned int group_count;
+  unsigned long long rows;
+  size_t data_end; // where the footer starts
+} ColumnStore;
+
+// maps the file and checks its structure; prints the reason on failure
+bool colstore_open(ColumnStore *store, const char *path);
+
+void colstore_close(ColumnStore *store);
+
+// index of the column called name, or -1
+int colstore_column(const ColumnStore *store, const char *name);
+
+// name for a code of an enum column (into out), false if there's none
+bool colstore_enum_name(const ColumnStore *store, int column, int code,
+                        char *out, size_t size);
+
+// called once per group with values[i] = the rows of columns[i]
+typedef void (*ColumnScanFn)(void *arg, int rows, int *const *values);
+
+// decompresses only the given columns, group by group; bytes_read (may be
+// NULL) gets the compressed bytes that were read
+// prints the reason and returns false if a chunk is broken
+bool colstore_scan(const ColumnStore *store, const int *columns, int count,
+                   ColumnScanFn fn, void *arg, size_t *bytes_read);
+
+#endif
@@ -1,10 +1,13 @@
 #include "enemy.h"
 #include "grid.h"
 #include "player.h"
+#include "rng.h"
+#include "tuning.h"
 #include "types.h"
 #include <stdlib.h>
 
-void enemy_init(Enemy *enemy, EnemyType type, int col, int row) {
+void enemy_init(Enemy *enemy, EnemyType type, int col, int row,
+                unsigned int rng_state) {
   enemy->col = col;
   enemy->row = row;
   enemy->type = type;
@@ -12,6 +15,20 @@ void enemy_init(Enemy *enemy, EnemyType type, int col, int row) {
   enemy->is_alive = true;
   enemy->move_slowdown = 0;
   enemy->is_ghosting = false;
+  enemy->state = ENEMY_WANDERING;
+  enemy->rng = rng_state;
+  enemy->alert = 0;
+  enemy->target_col = col;
+  enemy->target_row = row;
+}
+
+// the enemy's walk mask; nothing is walkable from off the grid
+static unsigned int walkable_from(const Enemy *enemy,
+                                  const EnemyContext *ctx) {
+  if (enemy->col < 0 || enemy->col >= GRID_WIDTH || enemy->row < 0 ||
+      enemy->row >= GRID_HEIGHT)
+    return 0;
+  return ctx->walk->enemy[enemy->row][enemy->col];
 }
 
 // Helper; check if tile is walkable for enemies
@@ -21,6 +38,32 @@ static bool enemy_can_walk(TileType tile) {
   return (tile == TILE_EMPTY || tile == TILE_TUNNEL || tile == TILE_DIRT);
 }
 
+// Helper; can the enemy walk there without ghosting
+static bool enemy_is_open(TileType grid[GRID_HEIGHT][GRID_WIDTH], int col,
+                          int row) {
+  if (col < 0 || col >= GRID_WIDTH || row < 0 || row >= GRID_HEIGHT)
+    return false;
+  TileType tile = grid[row][col];
+  return tile == TILE_TUNNEL || tile == TILE_EMPTY;
+}
+
+static void step_in_dir(Direction dir, int *col, int *row) {
+  switch (dir) {
+  case DIR_UP:
+    (*row)--;
+    break;
+  case DIR_DOWN:
+    (*row)++;
+    break;
+  case DIR_LEFT:
+    (*col)--;
+    break;
+  case DIR_RIGHT:
+    (*col)++;
+    break;
+  }
+}
+
 // Helper; get dir to move to target
 static Direction get_dir_to(int from_col, int from_row, int to_col,
                             int to_row) {
@@ -38,7 +81,8 @@ static Direction get_dir_to(int from_col, int from_row, int to_col,
 
 // Helper: Try to move enemy in dir
 static Direction enemy_try_move(Enemy *enemy, Direction dir,
-                                TileType grid[GRID_HEIGHT][GRID_WIDTH]) {
+                                TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                                const Tuning *tuning) {
   int new_col = enemy->col;
   int new_row = enemy->row;
 
@@ -82,56 +126,146 @@ static Direction enemy_try_move(Enemy *enemy, Direction dir,
 
   // set slowdown based on terrain
   if (tile == TILE_DIRT) {
-    enemy->move_slowdown = 20; // slow in dirt
+    enemy->move_slowdown = tuning->enemy_dirt_slowdown; // slow in dirt
   } else {
-    enemy->move_slowdown = 10; // medium speed in tunnels
+    enemy->move_slowdown = tuning->enemy_tunnel_slowdown; // medium speed
   }
 
   return true;
 }
 
-void enemy_update(Enemy *enemy, Player *player,
-                  TileType grid[GRID_HEIGHT][GRID_WIDTH]) {
+// Hasn't noticed the player: follow the tunnel it's in, turning now and
+// then or when it runs into dirt. Only ghosts when boxed in by dirt.
+static void enemy_wander(Enemy *enemy, const EnemyContext *ctx,
+                         unsigned int *rng) {
+  TileType(*grid)[GRID_WIDTH] = ctx->grid;
+  const Tuning *tuning = ctx->tuning;
+  int col = enemy->col;
+  int row = enemy->row;
+  step_in_dir(enemy->facing, &col, &row);
+  if (rng_range(rng, 8) != 0 && enemy_is_open(grid, col, row) &&
+      enemy_try_move(enemy, enemy->facing, grid, tuning))
+    return;
+
+  Direction start = rng_range(rng, 4);
+  for (int i = 0; i < 4; i++) {
+    Direction dir = (start + i) % 4;
+    col = enemy->col;
+    row = enemy->row;
+    step_in_dir(dir, &col, &row);
+    if (enemy_is_open(grid, col, row) &&
+        enemy_try_move(enemy, dir, grid, tuning))
+      return;
+  }
+
+  // boxed in by dirt: ghost through the first way that isn't rock
+  unsigned int walkable = walkable_from(enemy, ctx);
+  for (int i = 0; i < 4; i++) {
+    Direction dir = (start + i) % 4;
+    if (walkable & 1u << dir) {
+      enemy_try_move(enemy, dir, grid, tuning);
+      return;
+    }
+  }
+}
+
+// Running for the exit: downhill on the escape map, or straight at the
+// exit if there's no way there (boxed in by rocks, off the grid).
+// Standing on the exit when it's allowed to move again, it's gone.
+static void enemy_flee(Enemy *enemy, const EnemyContext *ctx) {
+  const EscapeMap *escape = ctx->escape;
+  if (escape_distance(escape, enemy->col, enemy->row) == 0) {
+    enemy->is_alive = false;
+    enemy->state = ENEMY_ESCAPED;
+    return;
+  }
+
+  Direction dir;
+  if (!escape_next(escape, enemy->col, enemy->row, &dir))
+    dir = get_dir_to(enemy->col, enemy->row, escape->exit_col,
+                     escape->exit_row);
+  enemy_try_move(enemy, dir, ctx->grid, ctx->tuning);
+}
+
+void enemy_update(Enemy *enemy, const EnemyContext *ctx) {
+  const Player *player = &ctx->player;
+  TileType(*grid)[GRID_WIDTH] = ctx->grid;
+  const Tuning *tuning = ctx->tuning;
+  unsigned int *rng = &enemy->rng;
+
   // dead enemies don't move
   if (!enemy->is_alive)
     return;
 
+  if (enemy->state == ENEMY_FLEEING) {
+    if (enemy->move_slowdown > 0)
+      enemy->move_slowdown--;
+    else
+      enemy_flee(enemy, ctx);
+    return;
+  }
+
+  // notice the player? (every tick, moving or not)
+  bool chasing = true;
+  int target_col = player->col;
+  int target_row = player->row;
+  if (tuning->enemy_perception) {
+    const Perception *perception = ctx->perception;
+    if (perception_sees(perception, enemy->col, enemy->row) ||
+        perception_hears(perception, enemy->col, enemy->row,
+                         tuning->enemy_hearing_radius)) {
+      enemy->alert = tuning->enemy_alert_ticks;
+      enemy->target_col = player->col;
+      enemy->target_row = player->row;
+    } else if (enemy->alert > 0) {
+      enemy->alert--;
+    }
+    chasing = enemy->alert > 0;
+    target_col = enemy->target_col;
+    target_row = enemy->target_row;
+  }
+  enemy->state = chasing ? ENEMY_CHASING : ENEMY_WANDERING;
+
   // update slowdown
   if (enemy->move_slowdown > 0) {
     enemy->move_slowdown--;
     return; // cannot move yet
   }
 
-  // AI: chase player
-  Direction preferred =
-      get_dir_to(enemy->col, enemy->row, player->col, player->row);
+  if (!chasing) {
+    enemy_wander(enemy, ctx, rng);
+    return;
+  }
 
-  // 30% chance that enemy will move randomly
-  if (rand() % 100 < 30) {
-    Direction rand_dir = rand() % 4;
-    if (enemy_try_move(enemy, rand_dir, grid))
+  // AI: chase player (or where it was last noticed)
+  // through the tunnels if that's quicker, the distance field only knows
+  // the way to where the player is now
+  Direction preferred;
+  bool on_route = tuning->enemy_pathing && target_col == player->col &&
+                  target_row == player->row &&
+                  planner_choose(ctx->planner, ctx->tunnels, enemy->col,
+                                 enemy->row, player->col, player->row,
+                                 tuning, &preferred);
+  if (!on_route)
+    preferred = get_dir_to(enemy->col, enemy->row, target_col, target_row);
+
+  // some chance (30% by default) that enemy will move randomly
+  if (rng_range(rng, 100) < tuning->enemy_random_chance) {
+    Direction rand_dir = rng_range(rng, 4);
+    if (enemy_try_move(enemy, rand_dir, grid, tuning))
       return;
   }
 
   // try to move in preferred dir
-  if (enemy_try_move(enemy, preferred, grid))
+  if (enemy_try_move(enemy, preferred, grid, tuning))
     return; // success
 
-  // Blocked! Try other ways
-  Direction alternatives[3];
-  int alt_count = 0;
-
-  // generate alt. dir (perpendicular + opposite)
-  for (Direction d = DIR_UP; d <= DIR_RIGHT; d++) {
-    if (d != preferred) {
-      alternatives[alt_count++] = d;
-    }
-  }
-
-  // try random alternetive
-  if (alt_count > 0) {
-    int choice = rand() % alt_count;
-    enemy_try_move(enemy, alternatives[choice], grid);
+  // Blocked! Take a random one of the other ways that can be walked, so
+  // the tick isn't spent bumping into a rock
+  unsigned int alternatives = walkable_from(enemy, ctx) & ~(1u << preferred);
+  if (alternatives) {
+    int choice = rng_range(rng, walkmask_count(alternatives));
+    enemy_try_move(enemy, walkmask_nth(alternatives, choice), grid, tuning);
   }
 }
 
@@ -1,14 +1,27 @@
 #ifndef ENEMY_H
 #define ENEMY_H
 
+#include "escape.h"
+#include "perception.h"
+#include "planner.h"
 #include "player.h"
+#include "tuning.h"
 #include "types.h"
+#include "walkmask.h"
 #include <stdbool.h>
 
+// default enemy capacity of a world (tuning: max_enemies)
 #define MAX_ENEMIES 10
 
 typedef enum { ENEMY_POOKA, ENEMY_FYGAR } EnemyType;
 
+typedef enum {
+  ENEMY_WANDERING, // hasn't noticed the player (tuning: perception)
+  ENEMY_CHASING,
+  ENEMY_FLEEING,   // running for the exit, ignores the player
+  ENEMY_ESCAPED,   // gone through the exit (not alive any more)
+} EnemyState;
+
 typedef struct {
   int col;
   int row;
@@ -17,13 +30,33 @@ typedef struct {
   bool is_alive;
   int move_slowdown;
   bool is_ghosting;
+  EnemyState state;
+  unsigned int rng; // own random stream, so enemies don't depend on order
+  int alert;        // ticks left hunting the player (tuning: perception)
+  int target_col;   // where the player was last seen or heard
+  int target_row;
 } Enemy;
 
-void enemy_init(Enemy *enemy, EnemyType type, int col, int row);
+// read-only view of the world for the enemy update
+// enemies only ever write to themselves, so any number of them can be
+// updated in parallel from the same context
+typedef struct {
+  TileType (*grid)[GRID_WIDTH]; // not modified during the enemy update
+  Player player;                // snapshot taken before enemies move
+  const Perception *perception; // sight cache + dig noise for this tick
+  const TunnelIndex *tunnels;   // which open tiles connect
+  const Planner *planner;       // tunnel distance to the player
+  const EscapeMap *escape;      // distance to the exit
+  const WalkMasks *walk;        // which neighbours can be moved onto
+  const Tuning *tuning;
+} EnemyContext;
+
+// rng_state seeds the enemy's own random stream
+void enemy_init(Enemy *enemy, EnemyType type, int col, int row,
+                unsigned int rng_state);
 
 // update enemy AI
-void enemy_update(Enemy *enemy, Player *player,
-                  TileType grid[GRID_HEIGHT][GRID_WIDTH]);
+void enemy_update(Enemy *enemy, const EnemyContext *ctx);
 
 // get pixel pos for rendering
 void enemy_get_pixel_pos(Enemy *enemy, int *x, int *y);
@@ -0,0 +1,98 @@
+#include "escape.h"
+
+static bool in_grid(int col, int row) {
+  return col >= 0 && col < GRID_WIDTH && row >= 0 && row < GRID_HEIGHT;
+}
+
+static const int dc[4] = {0, 0, -1, 1};
+static const int dr[4] = {-1, 1, 0, 0};
+
+static int tile_cost(const EscapeMap *escape, TileType tile) {
+  if (tile == TILE_ROCK) {
+    return ESCAPE_UNREACHABLE;
+  }
+  return tile == TILE_DIRT ? escape->dirt_cost : escape->tunnel_cost;
+}
+
+// keep relaxing from tile until no distance improves (label correcting:
+// a tile can come back if it got cheaper after it was last handled)
+static void propagate(EscapeMap *escape, int tile) {
+  escape->kernels->relax(GRID_WIDTH, GRID_HEIGHT, &escape->cost[0][0],
+                         &escape->dist[0][0], tile, escape->queue,
+                         escape->queued);
+}
+
+static void build(EscapeMap *escape, TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                  const Tuning *tuning) {
+  escape->exit_col = tuning->exit_col;
+  escape->exit_row = tuning->exit_row;
+  escape->dirt_cost = tuning->enemy_dirt_slowdown + 1;
+  escape->tunnel_cost = tuning->enemy_tunnel_slowdown + 1;
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      escape->dist[row][col] = ESCAPE_UNREACHABLE;
+      escape->cost[row][col] = tile_cost(escape, grid[row][col]);
+      escape->queued[row * GRID_WIDTH + col] = false;
+    }
+  }
+
+  int ec = escape->exit_col;
+  int er = escape->exit_row;
+  if (in_grid(ec, er) && escape->cost[er][ec] != ESCAPE_UNREACHABLE) {
+    escape->dist[er][ec] = 0;
+    propagate(escape, er * GRID_WIDTH + ec);
+  }
+}
+
+void escape_init(EscapeMap *escape, TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                 const Tuning *tuning, const GridKernels *kernels) {
+  escape->kernels = kernels;
+  build(escape, grid, tuning);
+}
+
+void escape_dig(EscapeMap *escape, int col, int row) {
+  if (!in_grid(col, row) || escape->cost[row][col] == escape->tunnel_cost) {
+    return;
+  }
+  escape->cost[row][col] = escape->tunnel_cost;
+  if (escape->dist[row][col] == ESCAPE_UNREACHABLE) {
+    return; // nobody can get out through here anyway
+  }
+  // only the way in got cheaper, so the neighbors are what may improve
+  propagate(escape, row * GRID_WIDTH + col);
+}
+
+void escape_retune(EscapeMap *escape, TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                   const Tuning *tuning) {
+  if (escape->exit_col != tuning->exit_col ||
+      escape->exit_row != tuning->exit_row ||
+      escape->dirt_cost != tuning->enemy_dirt_slowdown + 1 ||
+      escape->tunnel_cost != tuning->enemy_tunnel_slowdown + 1) {
+    build(escape, grid, tuning);
+  }
+}
+
+int escape_distance(const EscapeMap *escape, int col, int row) {
+  if (!in_grid(col, row)) {
+    return ESCAPE_UNREACHABLE;
+  }
+  return escape->dist[row][col];
+}
+
+// per enemy per tick: a plain function, not through the kernel table
+bool escape_next(const EscapeMap *escape, int col, int row, Direction *dir) {
+  int dist = escape_distance(escape, col, row);
+  if (dist == 0 || dist == ESCAPE_UNREACHABLE) {
+    return false;
+  }
+  for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+    int nc = col + dc[d];
+    int nr = row + dr[d];
+    if (in_grid(nc, nr) && escape->cost[nr][nc] != ESCAPE_UNREACHABLE &&
+        escape->cost[nr][nc] + escape->dist[nr][nc] == dist) {
+      *dir = (Direction)d;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,51 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include "kernels.h"
+#include "player.h"
+#include "tuning.h"
+#include "types.h"
+#include <stdbool.h>
+
+// How far every tile is from the exit, for enemies running away.
+//
+// Distance is in ticks: stepping onto dirt costs enemy_dirt_slowdown + 1,
+// onto tunnel enemy_tunnel_slowdown + 1, rocks can't be crossed. Built once
+// per level. A dig only makes one tile cheaper, so distances only ever
+// shrink and the change is pushed out from the dug tile until nothing
+// improves. A fleeing enemy just steps downhill, no search per tick.
+
+#define ESCAPE_UNREACHABLE KERNEL_UNREACHABLE
+#define ESCAPE_TILES (GRID_WIDTH * GRID_HEIGHT)
+
+typedef struct {
+  int dist[GRID_HEIGHT][GRID_WIDTH]; // ticks to the exit
+  int cost[GRID_HEIGHT][GRID_WIDTH]; // ticks to step onto the tile
+  int queue[ESCAPE_TILES];           // tiles whose distance just shrank
+  bool queued[ESCAPE_TILES];
+  const GridKernels *kernels; // the level's, does the relaxing
+  int exit_col;
+  int exit_row;
+  int dirt_cost; // what the field was built with
+  int tunnel_cost;
+} EscapeMap;
+
+void escape_init(EscapeMap *escape, TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                 const Tuning *tuning, const GridKernels *kernels);
+
+// (col, row) just became tunnel
+void escape_dig(EscapeMap *escape, int col, int row);
+
+// call when the tuning may have changed; rebuilds only if the exit or the
+// enemy slowdowns did
+void escape_retune(EscapeMap *escape, TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                   const Tuning *tuning);
+
+// ticks from (col, row) to the exit, ESCAPE_UNREACHABLE if there's no way
+int escape_distance(const EscapeMap *escape, int col, int row);
+
+// first step of a quickest way out (first match in Direction order)
+// false at the exit itself or when there's no way out
+bool escape_next(const EscapeMap *escape, int col, int row, Direction *dir);
+
+#endif
@@ -0,0 +1,254 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "eventlog.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define RING_SIZE 8192 // must be a power of two
+#define RING_MASK (RING_SIZE - 1)
+
+static const char *event_names[EVENT_TYPE_COUNT] = {
+    "dig", "collision", "death", "spawn", "escape"};
+static const char *level_names[] = {"debug", "info", "warn", "error"};
+
+// how important each event type is
+static const LogLevel event_levels[EVENT_TYPE_COUNT] = {
+    LOG_DEBUG, // dig
+    LOG_INFO,  // collision
+    LOG_WARN,  // death
+    LOG_INFO,  // spawn
+    LOG_INFO,  // escape
+};
+
+typedef struct {
+  int max_events;
+  int window_ticks;
+  unsigned long window_start;
+  int used;
+  int suppressed;
+} RateLimit;
+
+// single producer / single consumer ring
+// head is only written by the game thread, tail only by the writer thread
+static Event ring[RING_SIZE];
+static _Alignas(64) atomic_size_t ring_head;
+static _Alignas(64) atomic_size_t ring_tail;
+
+static bool log_open;
+static LogLevel log_min_level;
+static EventLogFormat log_format;
+static FILE *log_file;
+// a collision can repeat every tick, by default log it once a second
+static RateLimit limits[EVENT_TYPE_COUNT] = {
+    [EVENT_COLLISION] = {.max_events = 1, .window_ticks = 60},
+};
+static unsigned long dropped_full; // ring was full
+
+static pthread_t writer;
+static atomic_bool writer_stop;
+
+static void write_u32(FILE *file, unsigned int value) {
+  unsigned char bytes[4] = {value & 0xFF, (value >> 8) & 0xFF,
+                            (value >> 16) & 0xFF, (value >> 24) & 0xFF};
+  fwrite(bytes, 1, 4, file);
+}
+
+static void write_event(const Event *event) {
+  switch (log_format) {
+  case EVENTLOG_TEXT:
+    fprintf(log_file, "[%s] tick %lu: %s at (%d,%d) value %d",
+            level_names[event->level], event->tick, event_names[event->type],
+            event->col, event->row, event->value);
+    if (event->suppressed) {
+      fprintf(log_file, " (+%d suppressed)", event->suppressed);
+    }
+    fputc('\n', log_file);
+    break;
+
+  case EVENTLOG_JSONL:
+    fprintf(log_file,
+            "{\"tick\":%lu,\"event\":\"%s\",\"level\":\"%s\",\"col\":%d,"
+            "\"row\":%d,\"value\":%d,\"suppressed\":%d}\n",
+            event->tick, event_names[event->type], level_names[event->level],
+            event->col, event->row, event->value, event->suppressed);
+    break;
+
+  case EVENTLOG_BINARY:
+    // u64 tick | u8 type | u8 level | u16 reserved |
+    // i32 col | i32 row | i32 value | i32 suppressed   (28 bytes)
+    write_u32(log_file, (unsigned int)(event->tick & 0xFFFFFFFFu));
+    write_u32(log_file, (unsigned int)((unsigned long long)event->tick >> 32));
+    fputc(event->type, log_file);
+    fputc(event->level, log_file);
+    fputc(0, log_file);
+    fputc(0, log_file);
+    write_u32(log_file, (unsigned int)event->col);
+    write_u32(log_file, (unsigned int)event->row);
+    write_u32(log_file, (unsigned int)event->value);
+    write_u32(log_file, (unsigned int)event->suppressed);
+    break;
+  }
+}
+
+// drain whatever is in the ring; returns how many events were written
+static size_t drain(void) {
+  size_t tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+  size_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+  size_t count = head - tail;
+
+  for (; tail != head; tail++) {
+    write_event(&ring[tail & RING_MASK]);
+  }
+  atomic_store_explicit(&ring_tail, tail, memory_order_release);
+
+  if (count) {
+    fflush(log_file);
+  }
+  return count;
+}
+
+static void *writer_main(void *arg) {
+  (void)arg;
+  while (!atomic_load(&writer_stop)) {
+    if (drain() == 0) {
+      struct timespec nap = {0, 5 * 1000000L}; // 5 ms
+      nanosleep(&nap, NULL);
+    }
+  }
+  drain();
+  return NULL;
+}
+
+bool eventlog_open(const char *path, EventLogFormat format,
+                   LogLevel min_level) {
+  if (log_open) {
+    eventlog_close();
+  }
+
+  if (strcmp(path, "-") == 0) {
+    log_file = stderr;
+  } else {
+    log_file = fopen(path, format == EVENTLOG_BINARY ? "wb" : "w");
+    if (!log_file) {
+      fprintf(stderr, "Cannot open event log %s\n", path);
+      return false;
+    }
+  }
+
+  log_format = format;
+  log_min_level = min_level;
+  dropped_full = 0;
+  atomic_store(&ring_head, 0);
+  atomic_store(&ring_tail, 0);
+  for (int i = 0; i < EVENT_TYPE_COUNT; i++) {
+    limits[i].window_start = 0;
+    limits[i].used = 0;
+    limits[i].suppressed = 0;
+  }
+
+  if (format == EVENTLOG_BINARY) {
+    fwrite("DDEV", 1, 4, log_file);
+    write_u32(log_file, 1); // version
+  }
+
+  atomic_store(&writer_stop, false);
+  if (pthread_create(&writer, NULL, writer_main, NULL) != 0) {
+    fprintf(stderr, "Cannot start event log thread\n");
+    if (log_file != stderr) {
+      fclose(log_file);
+    }
+    return false;
+  }
+
+  log_open = true;
+  return true;
+}
+
+void eventlog_set_rate_limit(EventType type, int max_events,
+                             int window_ticks) {
+  limits[type].max_events = max_events;
+  limits[type].window_ticks = window_ticks;
+}
+
+void eventlog_emit(EventType type, unsigned long tick, int col, int row,
+                   int value) {
+  if (!log_open || event_levels[type] < log_min_level) {
+    return;
+  }
+
+  RateLimit *limit = &limits[type];
+  if (limit->max_events > 0) {
+    if (tick - limit->window_start >= (unsigned long)limit->window_ticks) {
+      limit->window_start = tick;
+      limit->used = 0;
+    }
+    if (limit->used >= limit->max_events) {
+      limit->suppressed++;
+      return;
+    }
+    limit->used++;
+  }
+
+  size_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+  if (head - tail == RING_SIZE) {
+    dropped_full++; // writer can't keep up: drop rather than stall the game
+    return;
+  }
+
+  Event *event = &ring[head & RING_MASK];
+  event->tick = tick;
+  event->type = type;
+  event->level = event_levels[type];
+  event->col = col;
+  event->row = row;
+  event->value = value;
+  event->suppressed = limit->suppressed;
+  limit->suppressed = 0;
+
+  atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+}
+
+void eventlog_close(void) {
+  if (!log_open) {
+    return;
+  }
+  atomic_store(&writer_stop, true);
+  pthread_join(writer, NULL);
+  log_open = false;
+
+  if (dropped_full) {
+    fprintf(stderr, "Event log: %lu events dropped (ring full)\n",
+            dropped_full);
+  }
+  if (log_file != stderr) {
+    fclose(log_file);
+  }
+  log_file = NULL;
+}
+
+bool eventlog_parse_format(const char *name, EventLogFormat *format) {
+  if (strcmp(name, "text") == 0) {
+    *format = EVENTLOG_TEXT;
+  } else if (strcmp(name, "jsonl") == 0) {
+    *format = EVENTLOG_JSONL;
+  } else if (strcmp(name, "binary") == 0) {
+    *format = EVENTLOG_BINARY;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool eventlog_parse_level(const char *name, LogLevel *level) {
+  for (int i = LOG_DEBUG; i <= LOG_ERROR; i++) {
+    if (strcmp(name, level_names[i]) == 0) {
+      *level = (LogLevel)i;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,58 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stdbool.h>
+
+// Structured game event log.
+//
+// The game loop only copies a small Event into a lock-free ring buffer
+// (never blocks; if the buffer is full the event is dropped and counted).
+// A background thread drains the ring and does the slow file writing.
+// Only one thread at a time (whichever is running the sim) may emit events.
+
+typedef enum {
+  EVENT_DIG,       // player dug a dirt tile; value = total dirt dug
+  EVENT_COLLISION, // enemy touched the player; value = enemy index
+  EVENT_DEATH,     // player died; value = enemy index that killed them
+  EVENT_SPAWN,     // enemy spawned; value = EnemyType
+  EVENT_ESCAPE,    // enemy got out through the exit; value = enemy index
+  EVENT_TYPE_COUNT
+} EventType;
+
+typedef enum { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR } LogLevel;
+
+typedef enum {
+  EVENTLOG_TEXT,   // human readable lines (good for stderr)
+  EVENTLOG_JSONL,  // one JSON object per line
+  EVENTLOG_BINARY, // "DDEV" + u32 version, then 28 byte records
+} EventLogFormat;
+
+typedef struct {
+  unsigned long tick;
+  EventType type;
+  LogLevel level;
+  int col;
+  int row;
+  int value;
+  int suppressed; // same-type events dropped by the rate limit before this
+} Event;
+
+// start logging to path ("-" = stderr); events below min_level are ignored
+bool eventlog_open(const char *path, EventLogFormat format,
+                   LogLevel min_level);
+
+// allow at most max_events of this type per window_ticks (0 = no limit)
+void eventlog_set_rate_limit(EventType type, int max_events,
+                             int window_ticks);
+
+void eventlog_emit(EventType type, unsigned long tick, int col, int row,
+                   int value);
+
+// flush everything still in the ring and stop the writer thread
+void eventlog_close(void);
+
+// parse "text"/"jsonl"/"binary" and "debug"/"info"/"warn"/"error"
+bool eventlog_parse_format(const char *name, EventLogFormat *format);
+bool eventlog_parse_level(const char *name, LogLevel *level);
+
+#endif
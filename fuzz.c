@@ -0,0 +1,31 @@
+#include "replay.h"
+#include "verify.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// libFuzzer entry point (make fuzz): the data is a replay file. Whatever
+// replay_parse refuses is dropped, everything else is played by sim_step
+// and the reference rules in lockstep, and a disagreement aborts so the
+// fuzzer keeps the input. The tuning digest is ignored, every input plays
+// with the default tuning
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  Replay replay;
+  if (!replay_parse(&replay, data, size, "fuzz input")) {
+    return -1; // not worth keeping in the corpus
+  }
+
+  char diff[2048];
+  long tick = verify_lockstep(replay.seed, NULL, replay.inputs,
+                              replay.tick_count, diff, sizeof diff);
+  unsigned int seed = replay.seed;
+  replay_free(&replay);
+  if (tick == VERIFY_ERROR) {
+    return -1; // out of memory, says nothing about the sim
+  }
+  if (tick != -1) {
+    fprintf(stderr, "MISMATCH seed %u at tick %ld:\n%s", seed, tick, diff);
+    abort();
+  }
+  return 0;
+}
@@ -0,0 +1,281 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "jobs.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#define JOB_QUEUE_MASK (JOB_QUEUE_SIZE - 1)
+
+// tries to find work before an idle worker goes to sleep
+#define IDLE_SPINS 64
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, thieves take
+// from the top. Fixed size; when it's full the job just runs right away.
+typedef struct {
+  _Alignas(64) atomic_long top;
+  _Alignas(64) atomic_long bottom;
+  Job jobs[JOB_QUEUE_SIZE];
+} JobQueue;
+
+static JobQueue queues[MAX_JOB_THREADS];
+static pthread_t threads[MAX_JOB_THREADS];
+// extra threads; queue 0 belongs to the main thread
+static atomic_int thread_count;
+
+static _Thread_local int self; // queue of the current thread
+
+// idle workers sleep here until somebody pushes a job
+static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static atomic_int sleepers;
+static atomic_bool stopping;
+
+// guards the waiting lists of all counters (rarely used, rarely contended)
+static pthread_mutex_t waiting_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool queue_push(JobQueue *q, Job job) {
+  long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+  long t = atomic_load_explicit(&q->top, memory_order_acquire);
+  if (b - t >= JOB_QUEUE_SIZE) {
+    return false;
+  }
+  q->jobs[b & JOB_QUEUE_MASK] = job;
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+  return true;
+}
+
+static bool queue_pop(JobQueue *q, Job *job) {
+  long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+
+  if (t > b) { // empty
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    return false;
+  }
+  *job = q->jobs[b & JOB_QUEUE_MASK];
+  if (t == b) {
+    // last job: race the thieves for it
+    bool won = atomic_compare_exchange_strong_explicit(
+        &q->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+
+static bool queue_steal(JobQueue *q, Job *job) {
+  long t = atomic_load_explicit(&q->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+  if (t >= b) {
+    return false;
+  }
+  *job = q->jobs[t & JOB_QUEUE_MASK];
+  return atomic_compare_exchange_strong_explicit(
+      &q->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+static bool queue_looks_empty(JobQueue *q) {
+  return atomic_load(&q->top) >= atomic_load(&q->bottom);
+}
+
+// own queue first (newest job, still warm in cache), then steal the
+// oldest job from somebody else
+static bool find_job(Job *job) {
+  if (queue_pop(&queues[self], job)) {
+    return true;
+  }
+  int total = thread_count + 1;
+  for (int i = 1; i < total; i++) {
+    if (queue_steal(&queues[(self + i) % total], job)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void wake_sleepers(void) {
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load(&sleepers) > 0) {
+    pthread_mutex_lock(&sleep_lock);
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&sleep_lock);
+  }
+}
+
+static void run_job(Job job);
+
+static void push_job(Job job) {
+  if (!queue_push(&queues[self], job)) {
+    run_job(job); // queue full, no point in waiting
+    return;
+  }
+  wake_sleepers();
+}
+
+// start everything that was waiting for this counter
+static void release_waiting(JobCounter *counter) {
+  Job ready[JOB_MAX_WAITING];
+  pthread_mutex_lock(&waiting_lock);
+  int count = counter->waiting_count;
+  for (int i = 0; i < count; i++) {
+    ready[i] = counter->waiting[i];
+  }
+  counter->waiting_count = 0;
+  pthread_mutex_unlock(&waiting_lock);
+
+  for (int i = 0; i < count; i++) {
+    push_job(ready[i]);
+  }
+}
+
+static void finish(JobCounter *counter) {
+  // releasing keeps jobs_wait from returning (and the counter from going
+  // out of scope) while we still look at it
+  atomic_fetch_add(&counter->releasing, 1);
+  if (atomic_fetch_sub(&counter->pending, 1) == 1) {
+    release_waiting(counter);
+  }
+  atomic_fetch_sub(&counter->releasing, 1);
+}
+
+static void run_job(Job job) {
+  job.fn(job.ctx, job.index);
+  if (job.done) {
+    finish(job.done);
+  }
+}
+
+static bool any_queued(void) {
+  for (int i = 0; i <= thread_count; i++) {
+    if (!queue_looks_empty(&queues[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void *worker_main(void *arg) {
+  self = (int)(long)arg;
+  int idle = 0;
+
+  while (!atomic_load(&stopping)) {
+    Job job;
+    if (find_job(&job)) {
+      run_job(job);
+      idle = 0;
+    } else if (++idle < IDLE_SPINS) {
+      sched_yield();
+    } else {
+      // pushers check sleepers after queuing, we check the queues after
+      // registering as a sleeper, so no wakeup gets lost
+      pthread_mutex_lock(&sleep_lock);
+      atomic_fetch_add(&sleepers, 1);
+      if (!any_queued() && !atomic_load(&stopping)) {
+        pthread_cond_wait(&wake, &sleep_lock);
+      }
+      atomic_fetch_sub(&sleepers, 1);
+      pthread_mutex_unlock(&sleep_lock);
+      idle = 0;
+    }
+  }
+  return NULL;
+}
+
+bool jobs_start(int count) {
+  if (count > MAX_JOB_THREADS - 1) {
+    count = MAX_JOB_THREADS - 1;
+  }
+  atomic_store(&stopping, false);
+  for (int i = 0; i < count; i++) {
+    if (pthread_create(&threads[i], NULL, worker_main, (void *)(long)(i + 1)) !=
+        0) {
+      fprintf(stderr, "Could only start %d job threads\n", i);
+      return false;
+    }
+    atomic_store(&thread_count, i + 1);
+  }
+  return true;
+}
+
+int jobs_worker_count(void) { return thread_count; }
+
+void jobs_counter_init(JobCounter *counter) {
+  atomic_init(&counter->pending, 0);
+  atomic_init(&counter->releasing, 0);
+  counter->waiting_count = 0;
+}
+
+void jobs_run(JobFn fn, void *ctx, int index, JobCounter *done) {
+  if (done) {
+    atomic_fetch_add(&done->pending, 1);
+  }
+  push_job((Job){fn, ctx, index, done});
+}
+
+void jobs_run_after(JobCounter *after, JobFn fn, void *ctx, int index,
+                    JobCounter *done) {
+  if (done) {
+    atomic_fetch_add(&done->pending, 1);
+  }
+  Job job = {fn, ctx, index, done};
+
+  pthread_mutex_lock(&waiting_lock);
+  if (atomic_load(&after->pending) > 0 &&
+      after->waiting_count < JOB_MAX_WAITING) {
+    after->waiting[after->waiting_count++] = job;
+    pthread_mutex_unlock(&waiting_lock);
+    return;
+  }
+  pthread_mutex_unlock(&waiting_lock);
+
+  // already done (or too many waiters: wait here instead)
+  jobs_wait(after);
+  push_job(job);
+}
+
+void jobs_wait(JobCounter *counter) {
+  while (atomic_load(&counter->pending) > 0 ||
+         atomic_load(&counter->releasing) > 0) {
+    Job job;
+    if (find_job(&job)) {
+      run_job(job);
+    } else {
+      sched_yield();
+    }
+  }
+}
+
+void jobs_parallel_for(int n, JobFn fn, void *ctx) {
+  if (thread_count == 0 || n <= 1) {
+    for (int i = 0; i < n; i++) {
+      fn(ctx, i);
+    }
+    return;
+  }
+
+  JobCounter done;
+  jobs_counter_init(&done);
+  // push all but the first, then start on that one ourselves
+  for (int i = 1; i < n; i++) {
+    jobs_run(fn, ctx, i, &done);
+  }
+  fn(ctx, 0);
+  jobs_wait(&done);
+}
+
+void jobs_stop(void) {
+  pthread_mutex_lock(&sleep_lock);
+  atomic_store(&stopping, true);
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&sleep_lock);
+
+  for (int i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  atomic_store(&thread_count, 0);
+}
@@ -0,0 +1,65 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Job system for the frame graph and the parallel enemy update.
+//
+// Every thread (main + workers) has its own work-stealing deque: it pushes
+// and pops at one end, idle threads steal from the other. Jobs report to a
+// JobCounter when they finish; a job can be made to wait for a counter
+// (jobs_run_after), and a thread waiting for a counter keeps running other
+// jobs meanwhile instead of blocking, so waiting inside a job is fine.
+//
+// Only the main thread and the job threads may submit or wait.
+
+#define MAX_JOB_THREADS 64 // main thread included
+#define JOB_QUEUE_SIZE 1024 // per thread, a power of two
+#define JOB_MAX_WAITING 8  // jobs that can wait on one counter
+
+typedef void (*JobFn)(void *ctx, int index);
+
+typedef struct JobCounter JobCounter;
+
+typedef struct {
+  JobFn fn;
+  void *ctx;
+  int index;
+  JobCounter *done; // may be NULL
+} Job;
+
+// number of unfinished jobs that report to it
+// zero it with jobs_counter_init, reuse it once it is back to zero
+struct JobCounter {
+  atomic_int pending;
+  atomic_int releasing; // a finishing job is still starting the waiters
+  int waiting_count;
+  Job waiting[JOB_MAX_WAITING];
+};
+
+// start count extra threads (0 = everything runs on the main thread,
+// inside jobs_wait)
+bool jobs_start(int count);
+
+// number of extra threads running
+int jobs_worker_count(void);
+
+void jobs_counter_init(JobCounter *counter);
+
+// queue fn(ctx, index); done (if any) counts it until it has run
+void jobs_run(JobFn fn, void *ctx, int index, JobCounter *done);
+
+// same, but only start once after has dropped to zero
+void jobs_run_after(JobCounter *after, JobFn fn, void *ctx, int index,
+                    JobCounter *done);
+
+// run jobs until counter drops to zero
+void jobs_wait(JobCounter *counter);
+
+// run fn(ctx, i) for every i in [0, n) and wait until all are done
+void jobs_parallel_for(int n, JobFn fn, void *ctx);
+
+void jobs_stop(void);
+
+#endif
@@ -0,0 +1,174 @@
+#include "kernels.h"
+#include "walkmask.h"
+#include <stddef.h>
+
+// The bodies take width and height like any function; every instance
+// below forces them inline, so in a sized instance they are constants
+// and the compiler folds them, in the generic one they stay variables.
+#define KERNEL_BODY static inline __attribute__((always_inline))
+
+static const int dc[4] = {0, 0, -1, 1};
+static const int dr[4] = {-1, 1, 0, 0};
+
+// the masks of here[col]; above/below are NULL off the grid
+KERNEL_BODY void walkmasks_tile(int width, const TileType *above,
+                                const TileType *here, const TileType *below,
+                                int col, uint8_t *player, uint8_t *enemy) {
+  walkmask_rules(above ? above[col] : TILE_ROCK,
+                 below ? below[col] : TILE_ROCK,
+                 col > 0 ? here[col - 1] : TILE_ROCK,
+                 col + 1 < width ? here[col + 1] : TILE_ROCK, &player[col],
+                 &enemy[col]);
+}
+
+// the edge columns on their own, so the columns in between have no bounds
+// left to check and the loop over them vectorizes
+KERNEL_BODY void walkmasks_body(int width, int height, const TileType *tiles,
+                                uint8_t *player, uint8_t *enemy) {
+  for (int row = 0; row < height; row++) {
+    const TileType *here = tiles + row * width;
+    const TileType *above = row > 0 ? here - width : NULL;
+    const TileType *below = row + 1 < height ? here + width : NULL;
+    uint8_t *p = player + row * width;
+    uint8_t *e = enemy + row * width;
+    walkmasks_tile(width, above, here, below, 0, p, e);
+    for (int col = 1; col < width - 1; col++) {
+      walkmasks_tile(width, above, here, below, col, p, e);
+    }
+    if (width > 1) {
+      walkmasks_tile(width, above, here, below, width - 1, p, e);
+    }
+  }
+}
+
+// label correcting over a ring of tiles; a tile is in the ring at most
+// once, so width * height slots never fill up
+KERNEL_BODY void relax_body(int width, int height, const int *cost,
+                            int *dist, int start, int *queue, bool *queued) {
+  int tiles = width * height;
+  int head = 0;
+  int count = 0;
+  queue[count++] = start;
+  queued[start] = true;
+  while (count > 0) {
+    int tile = queue[head];
+    head = head + 1 == tiles ? 0 : head + 1;
+    count--;
+    queued[tile] = false;
+
+    int col = tile % width;
+    int row = tile / width;
+    // stepping onto this tile from a neighbor
+    int via = dist[tile] + cost[tile];
+    for (int d = 0; d < 4; d++) {
+      int nc = col + dc[d];
+      int nr = row + dr[d];
+      if (nc < 0 || nc >= width || nr < 0 || nr >= height) {
+        continue;
+      }
+      int next = nr * width + nc;
+      if (cost[next] != KERNEL_UNREACHABLE && via < dist[next]) {
+        dist[next] = via;
+        if (!queued[next]) {
+          queued[next] = true;
+          int tail = head + count++;
+          queue[tail >= tiles ? tail - tiles : tail] = next;
+        }
+      }
+    }
+  }
+}
+
+KERNEL_BODY void bfs_body(int width, int height, const short *open,
+                          int *dist, int *queue, int *head, int *tail,
+                          int target) {
+  int h = *head;
+  int t = *tail;
+  while (dist[target] < 0 && h < t) {
+    int tile = queue[h++];
+    int col = tile % width;
+    int row = tile / width;
+    for (int d = 0; d < 4; d++) {
+      int nc = col + dc[d];
+      int nr = row + dr[d];
+      if (nc < 0 || nc >= width || nr < 0 || nr >= height) {
+        continue;
+      }
+      int next = nr * width + nc;
+      if (open[next] >= 0 && dist[next] < 0) {
+        dist[next] = dist[tile] + 1;
+        queue[t++] = next;
+      }
+    }
+  }
+  *head = h;
+  *tail = t;
+}
+
+// one set of entry points per size; the width/height passed in are
+// ignored in favour of the constants
+#define INSTANTIATE(w, h)                                                      \
+  static void walkmasks_##w##x##h(int width, int height,                       \
+                                  const TileType *tiles, uint8_t *player,      \
+                                  uint8_t *enemy) {                            \
+    (void)width;                                                               \
+    (void)height;                                                              \
+    walkmasks_body(w, h, tiles, player, enemy);                                \
+  }                                                                            \
+  static void relax_##w##x##h(int width, int height, const int *cost,          \
+                              int *dist, int start, int *queue,                \
+                              bool *queued) {                                  \
+    (void)width;                                                               \
+    (void)height;                                                              \
+    relax_body(w, h, cost, dist, start, queue, queued);                        \
+  }                                                                            \
+  static void bfs_##w##x##h(int width, int height, const short *open,          \
+                            int *dist, int *queue, int *head, int *tail,       \
+                            int target) {                                      \
+    (void)width;                                                               \
+    (void)height;                                                              \
+    bfs_body(w, h, open, dist, queue, head, tail, target);                     \
+  }
+
+GRID_KERNEL_SIZES(INSTANTIATE)
+
+static void walkmasks_generic(int width, int height, const TileType *tiles,
+                              uint8_t *player, uint8_t *enemy) {
+  walkmasks_body(width, height, tiles, player, enemy);
+}
+
+static void relax_generic(int width, int height, const int *cost, int *dist,
+                          int start, int *queue, bool *queued) {
+  relax_body(width, height, cost, dist, start, queue, queued);
+}
+
+static void bfs_generic(int width, int height, const short *open, int *dist,
+                        int *queue, int *head, int *tail, int target) {
+  bfs_body(width, height, open, dist, queue, head, tail, target);
+}
+
+#define TABLE_ENTRY(w, h)                                                      \
+  {#w "x" #h, w, h, walkmasks_##w##x##h, relax_##w##x##h, bfs_##w##x##h},
+
+static const GridKernels sized[] = {GRID_KERNEL_SIZES(TABLE_ENTRY)};
+
+static const GridKernels generic = {"generic",         0, 0,
+                                    walkmasks_generic, relax_generic,
+                                    bfs_generic};
+
+#define SIZED_COUNT ((int)(sizeof sized / sizeof sized[0]))
+
+const GridKernels *kernels_for(int width, int height) {
+  for (int i = 0; i < SIZED_COUNT; i++) {
+    if (sized[i].width == width && sized[i].height == height) {
+      return &sized[i];
+    }
+  }
+  return &generic;
+}
+
+const GridKernels *kernels_generic(void) { return &generic; }
+
+int kernels_sized_count(void) { return SIZED_COUNT; }
+
+const GridKernels *kernels_sized(int index) { return &sized[index]; }
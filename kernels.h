@@ -0,0 +1,66 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Whole-grid passes written once for any grid size and instantiated for
+// the sizes listed below, so those get their loop bounds and row strides
+// as constants (unrolled, no multiplies); any other size goes through the
+// generic version. A level picks its table with kernels_for when it's
+// loaded and calls through it from then on. Only whole-grid passes go
+// through the table: per-enemy steps stay plain calls the compiler can
+// inline.
+//
+// The World is still GRID_WIDTH x GRID_HEIGHT at compile time, so a game
+// only ever uses the 20x15 table; the bigger sizes are there for the
+// runtime-sized levels to come, and --verify and make kernel-bench already
+// check and time them against the generic version. Specializing the
+// per-tick step (player and enemy moves) waits for those levels too.
+//
+// Grids are flat, row-major, width * height tiles. Out-of-grid is never
+// walkable.
+
+// the specialized sizes: X(width, height)
+#define GRID_KERNEL_SIZES(X)                                                   \
+  X(20, 15)                                                                    \
+  X(64, 64)                                                                    \
+  X(256, 256)
+
+#define KERNEL_UNREACHABLE 0x3FFFFFFF
+
+typedef struct {
+  const char *name; // "20x15", ... or "generic"
+  int width;        // 0 = any (generic)
+  int height;
+
+  // walkable-neighbour masks of every tile (walkmask.h's rules)
+  void (*walkmasks)(int width, int height, const TileType *tiles,
+                    uint8_t *player, uint8_t *enemy);
+
+  // shortest distances out to where stepping onto a tile costs cost[tile]
+  // (KERNEL_UNREACHABLE = can't), given dist[start] is already right:
+  // relaxes from start until nothing improves. queue has room for every
+  // tile, queued is all false and left that way
+  void (*relax)(int width, int height, const int *cost, int *dist,
+                int start, int *queue, bool *queued);
+
+  // breadth first over the open tiles (open[tile] >= 0), picking up where
+  // it stopped: queue[*head, *tail) are reached tiles still to expand, dist
+  // is -1 where nothing has reached yet. Runs until dist[target] is set or
+  // the queue is empty, and leaves *head and *tail there
+  void (*bfs)(int width, int height, const short *open, int *dist,
+              int *queue, int *head, int *tail, int target);
+} GridKernels;
+
+// the table for a width x height grid: specialized if there is one
+const GridKernels *kernels_for(int width, int height);
+
+const GridKernels *kernels_generic(void);
+
+// the specialized tables, for benchmarks and checks
+int kernels_sized_count(void);
+const GridKernels *kernels_sized(int index);
+
+#endif
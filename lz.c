@@ -0,0 +1,138 @@
+#include "lz.h"
+#include <string.h>
+
+#define MIN_MATCH 4
+#define END_LITERALS 5 // the last bytes of a block always go as literals
+#define MAX_OFFSET 65535
+#define HASH_BITS 12
+
+// a sequence: token (literal length << 4 | match length - MIN_MATCH, 15 =
+// more length bytes follow), the literals, u16 offset, the match; the last
+// sequence of a block has literals only
+
+size_t lz_bound(size_t size) { return size + size / 255 + 16; }
+
+static unsigned int hash4(const unsigned char *p) {
+  unsigned int v = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// what's left of a length after the 15 in the token
+static unsigned char *put_length(unsigned char *out, size_t length) {
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+  *out++ = (unsigned char)length;
+  return out;
+}
+
+// match_length 0 = the last sequence
+static unsigned char *put_sequence(unsigned char *out,
+                                   const unsigned char *literals,
+                                   size_t literal_length, size_t offset,
+                                   size_t match_length) {
+  size_t extra = match_length ? match_length - MIN_MATCH : 0;
+  *out++ = (unsigned char)((literal_length < 15 ? literal_length : 15) << 4 |
+                           (extra < 15 ? extra : 15));
+  if (literal_length >= 15) {
+    out = put_length(out, literal_length - 15);
+  }
+  memcpy(out, literals, literal_length);
+  out += literal_length;
+  if (match_length == 0) {
+    return out;
+  }
+  *out++ = offset & 0xFF;
+  *out++ = offset >> 8;
+  if (extra >= 15) {
+    out = put_length(out, extra - 15);
+  }
+  return out;
+}
+
+size_t lz_compress(const unsigned char *src, size_t size, unsigned char *dst) {
+  unsigned int table[1 << HASH_BITS]; // position + 1 of the last 4 bytes
+  memset(table, 0, sizeof table);     // with this hash, 0 = none yet
+  unsigned char *out = dst;
+  size_t anchor = 0; // first byte not written yet
+  size_t end = size > END_LITERALS ? size - END_LITERALS : 0;
+  size_t i = 0;
+  while (i + MIN_MATCH <= end) {
+    unsigned int h = hash4(src + i);
+    size_t candidate = table[h];
+    table[h] = (unsigned int)(i + 1);
+    if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET ||
+        memcmp(src + candidate - 1, src + i, MIN_MATCH) != 0) {
+      i++;
+      continue;
+    }
+    size_t match = candidate - 1;
+    size_t length = MIN_MATCH;
+    while (i + length < end && src[match + length] == src[i + length]) {
+      length++;
+    }
+    out = put_sequence(out, src + anchor, i - anchor, i - match, length);
+    i += length;
+    anchor = i;
+  }
+  out = put_sequence(out, src + anchor, size - anchor, 0, 0);
+  return (size_t)(out - dst);
+}
+
+static bool get_length(const unsigned char **in, const unsigned char *end,
+                       unsigned int nibble, size_t *length) {
+  *length = nibble;
+  if (nibble < 15) {
+    return true;
+  }
+  unsigned char byte;
+  do {
+    if (*in == end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+bool lz_decompress(const unsigned char *src, size_t packed_size,
+                   unsigned char *dst, size_t size) {
+  const unsigned char *in = src;
+  const unsigned char *in_end = src + packed_size;
+  size_t out = 0;
+  while (in < in_end) {
+    unsigned int token = *in++;
+    size_t literals;
+    if (!get_length(&in, in_end, token >> 4, &literals) ||
+        literals > (size_t)(in_end - in) || literals > size - out) {
+      return false;
+    }
+    memcpy(dst + out, in, literals);
+    in += literals;
+    out += literals;
+    if (in == in_end) {
+      break; // the last sequence
+    }
+    if (in_end - in < 2) {
+      return false;
+    }
+    size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    size_t length;
+    if (!get_length(&in, in_end, token & 15, &length)) {
+      return false;
+    }
+    length += MIN_MATCH;
+    if (offset == 0 || offset > out || length > size - out) {
+      return false;
+    }
+    // byte by byte: the match may overlap what it's writing
+    for (size_t k = 0; k < length; k++) {
+      dst[out + k] = dst[out - offset + k];
+    }
+    out += length;
+  }
+  return out == size;
+}
@@ -0,0 +1,23 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Small LZ77 block compressor in the LZ4 style: a token byte with literal
+// and match lengths, the literals, a 2 byte back offset. Greedy matching
+// with a hash of the next 4 bytes, so it's fast both ways and wins big on
+// repetitive data (column chunks), not on random bytes.
+
+// room compressing size bytes can take in the worst case
+size_t lz_bound(size_t size);
+
+// returns the compressed size (dst needs lz_bound(size) bytes)
+size_t lz_compress(const unsigned char *src, size_t size, unsigned char *dst);
+
+// returns false if src is broken or doesn't decompress to exactly size
+// bytes; never reads or writes out of bounds
+bool lz_decompress(const unsigned char *src, size_t packed_size,
+                   unsigned char *dst, size_t size);
+
+#endif
@@ -1,15 +1,242 @@
 #include "enemy.h"
+#include "eventlog.h"
 #include "grid.h"
+#include "jobs.h"
+#include "metrics.h"
 #include "player.h"
 #include "render.h"
+#include "replay.h"
+#include "scenario.h"
+#include "timeline.h"
+#include "tuning.h"
+#include "sim.h"
 #include "types.h"
 #include <SDL3/SDL.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
-int main(void) {
+// in turbo mode, check the clock only every this many ticks
+#define TURBO_CLOCK_CHECK 256
+
+// one game tick: record the input (if recording) and step the world
+// a running scenario replaces the keyboard input
+static void run_tick(World *world, Replay *replay, bool recording,
+                     TimelineWriter *timeline, ScenarioRun *scenario,
+                     int input) {
+  if (scenario) {
+    input = scenario_next_input(scenario, world);
+  }
+  if (recording) {
+    replay_record(replay, input);
+  }
+  if (timeline) {
+    timeline_writer_record(timeline, world, input);
+  }
+
+  // move player, update enemies, check collisions
+  // (a hit shows up in the event log as collision + death)
+  long long tick_start = metrics_now_ns();
+  sim_step(world, input);
+  metrics_record(METRIC_TICK_TIME_NS, metrics_now_ns() - tick_start);
+}
+
+// ===== frame graph =====
+// main thread:  input -> tuning -> render last snapshot -> present
+// job threads:            \-> sim ticks -> snapshot
+// SDL calls stay on the main thread; the screen shows the state from the
+// end of the previous frame while this frame's ticks run next to it
+typedef struct {
+  World *world;
+  Replay *replay;
+  bool recording;
+  TimelineWriter *timeline; // NULL = not writing one
+  ScenarioRun *scenario;
+  int input; // key pressed this frame
+  int turbo;
+  int present_ms;
+  unsigned long ticks_run;
+  WorldSnapshot *snapshot; // the one not being drawn
+} Frame;
+
+static void frame_sim(void *ctx, int index) {
+  (void)index;
+  Frame *frame = ctx;
+
+  if (frame->turbo < 0) {
+    run_tick(frame->world, frame->replay, frame->recording, frame->timeline,
+             frame->scenario, frame->input);
+    frame->ticks_run++;
+    return;
+  }
+
+  // same sim code, just many ticks per frame
+  // the key pressed this frame goes to the first tick only
+  Uint64 deadline = SDL_GetTicksNS() + frame->present_ms * 1000000ull;
+  for (int t = 0;; t++) {
+    run_tick(frame->world, frame->replay, frame->recording, frame->timeline,
+             frame->scenario, t == 0 ? frame->input : INPUT_NONE);
+    frame->ticks_run++;
+
+    if (frame->turbo > 0) {
+      if (t + 1 >= frame->turbo)
+        break;
+    } else if ((t + 1) % TURBO_CLOCK_CHECK == 0 &&
+               SDL_GetTicksNS() >= deadline) {
+      break;
+    }
+  }
+}
+
+static void frame_snapshot(void *ctx, int index) {
+  (void)index;
+  Frame *frame = ctx;
+  sim_snapshot_take(frame->snapshot, frame->world);
+}
+
+// returns how long the grid took: its draw calls, flushed so they really
+// reach the GPU here and not somewhere in the present
+static Uint64 render_frame(SDL_Renderer *renderer,
+                           GridRenderer *grid_renderer, WorldSnapshot *view) {
+  // clear screen with a color (R,G,B,A)
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+  SDL_RenderClear(renderer);
+  SDL_FlushRenderer(renderer);
+
+  // Display the entire grid
+  Uint64 grid_start = SDL_GetTicksNS();
+  render_grid_draw(grid_renderer, renderer, view->grid, view->tuning);
+  SDL_FlushRenderer(renderer);
+  Uint64 grid_ns = SDL_GetTicksNS() - grid_start;
+
+  // Display enemies
+  render_draw_enemies(renderer, view->enemies, view->enemy_count,
+                      view->tuning);
+
+  // Draw player on top
+  render_draw_player(renderer, &view->player, view->tuning);
+
+  // Draw HUD - dirt bar
+  render_draw_hud(renderer, &view->player, view->tuning);
+
+  // Present
+  SDL_RenderPresent(renderer);
+  return grid_ns;
+}
+
+int main(int argc, char *argv[]) {
+  // optional: --record FILE saves this session as a replay
+  // (replays run headless in digdug_bench, e.g. as the PGO training workload)
+  const char *record_path = NULL;
+  // optional: --timeline FILE saves it as an indexed replay (keyframes
+  // every few seconds), for scrubbing through long sessions
+  const char *timeline_path = NULL;
+  // optional: metrics on http://127.0.0.1:PORT and/or dumped to a file
+  int metrics_port = 0;
+  const char *metrics_path = NULL;
+  int metrics_interval = 10;
+  // game events (digs, hits, deaths...) go to a background log writer
+  // default: warnings and up as text on stderr
+  const char *event_path = "-";
+  EventLogFormat event_format = EVENTLOG_TEXT;
+  LogLevel event_level = LOG_WARN;
+  // --turbo N: N ticks per drawn frame with no delay
+  // --turbo 0: as many ticks as possible, draw every --present-ms
+  int turbo = -1; // -1 = normal speed (one tick per frame, ~60 fps)
+  int present_ms = 16;
+  // --scenario NAME|FILE: scripted input instead of the keyboard
+  const char *scenario_name = NULL;
+  // tuning numbers/colors, reloaded whenever the file is saved
+  const char *tuning_path = "tuning.cfg";
+  // extra job threads for the sim and the enemy update
+  // (0 = everything on the main thread)
+  int threads = 0;
+  // --grid-draw MODE: how the grid gets drawn (render.h), to compare them
+  GridDrawMode grid_mode = GRID_DRAW_RECTS;
+  // --frames N: quit after N frames, e.g. timing a scenario with each mode
+  unsigned long max_frames = 0; // 0 = until closed
+  bool args_ok = true;
+  for (int i = 1; i < argc && args_ok; i++) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+      timeline_path = argv[++i];
+    } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+      metrics_port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--metrics-file") == 0 && i + 1 < argc) {
+      metrics_path = argv[++i];
+    } else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc) {
+      metrics_interval = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--event-log") == 0 && i + 1 < argc) {
+      event_path = argv[++i];
+    } else if (strcmp(argv[i], "--event-format") == 0 && i + 1 < argc) {
+      args_ok = eventlog_parse_format(argv[++i], &event_format);
+    } else if (strcmp(argv[i], "--event-level") == 0 && i + 1 < argc) {
+      args_ok = eventlog_parse_level(argv[++i], &event_level);
+    } else if (strcmp(argv[i], "--turbo") == 0 && i + 1 < argc) {
+      turbo = atoi(argv[++i]);
+      args_ok = turbo >= 0;
+    } else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+      scenario_name = argv[++i];
+    } else if (strcmp(argv[i], "--tuning") == 0 && i + 1 < argc) {
+      tuning_path = argv[++i];
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+      args_ok = threads >= 0;
+    } else if (strcmp(argv[i], "--present-ms") == 0 && i + 1 < argc) {
+      present_ms = atoi(argv[++i]);
+      args_ok = present_ms > 0;
+    } else if (strcmp(argv[i], "--grid-draw") == 0 && i + 1 < argc) {
+      args_ok = render_parse_grid_mode(argv[++i], &grid_mode);
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      max_frames = strtoul(argv[++i], NULL, 10);
+    } else {
+      args_ok = false;
+    }
+  }
+  if (!args_ok) {
+    fprintf(stderr,
+            "usage: %s [--record FILE] [--timeline FILE]\n"
+            "          [--metrics-port PORT]\n"
+            "          [--metrics-file FILE] [--metrics-interval SECONDS]\n"
+            "          [--event-log FILE|-] [--event-format text|jsonl|binary]\n"
+            "          [--event-level debug|info|warn|error]\n"
+            "          [--turbo TICKS_PER_FRAME|0] [--present-ms MS]\n"
+            "          [--scenario NAME|FILE] [--tuning FILE]\n"
+            "          [--threads N]\n"
+            "          [--grid-draw rects|batched|target|texture]\n"
+            "          [--frames N]\n",
+            argv[0]);
+    return 1;
+  }
+
+  // static: a Scenario is a few KB
+  static Scenario scenario;
+  ScenarioRun scenario_run;
+  if (scenario_name) {
+    if (!scenario_load(&scenario, scenario_name)) {
+      return 1;
+    }
+    if ((record_path || timeline_path) && scenario_spawns(&scenario)) {
+      fprintf(stderr, "Scenario %s spawns enemies, its replays wouldn't "
+                      "play back; not recording it\n",
+              scenario_name);
+      return 1;
+    }
+    scenario_start(&scenario_run, &scenario);
+  }
+
+  if (threads > 0 && !jobs_start(threads)) {
+    return 1;
+  }
+
+  if ((metrics_port > 0 || metrics_path) &&
+      !metrics_start(metrics_port, metrics_path, metrics_interval)) {
+    return 1;
+  }
+
   // initialize SDL3
   if (!SDL_Init(SDL_INIT_VIDEO)) {
     fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
@@ -36,97 +263,188 @@ int main(void) {
     return 1;
   }
 
+  // turbo mode must never wait for the display
+  if (turbo >= 0) {
+    SDL_SetRenderVSync(renderer, 0);
+  }
+
+  // static: keeps a copy of the grid and its rect batches
+  static GridRenderer grid_renderer;
+  if (!render_grid_init(&grid_renderer, renderer, grid_mode)) {
+    fprintf(stderr, "Grid texture creation failed: %s\n", SDL_GetError());
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 1;
+  }
+
   printf("SDL3 Initialized successfully!\n");
   printf("Press ESC or close window to quit\n");
 
+  if (!eventlog_open(event_path, event_format, event_level)) {
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 1;
+  }
+
   // seed random num gen
-  srand(time(NULL));
+  unsigned int seed = (unsigned int)time(NULL);
 
-  TileType grid[GRID_HEIGHT][GRID_WIDTH];
-  grid_init(grid);
+  TuningWatch tuning_watch;
+  tuning_watch_start(&tuning_watch, tuning_path);
+
+  // grid, player and enemies all live in the world
+  World world;
+  if (!sim_init(&world, seed, tuning_watch_get(&tuning_watch))) {
+    fprintf(stderr, "Out of memory creating the world\n");
+    return 1;
+  }
+  world.parallel = threads > 0;
 
-  Player player;
-  player_init(&player, 10, 2);
+  // drawn from one while the frame's ticks fill the other
+  WorldSnapshot snapshots[2];
+  if (!sim_snapshot_init(&snapshots[0], &world) ||
+      !sim_snapshot_init(&snapshots[1], &world)) {
+    fprintf(stderr, "Out of memory creating the world\n");
+    return 1;
+  }
+  int shown = 0;
 
-  // create enemies
-  Enemy enemies[MAX_ENEMIES];
-  int enemy_count = 0;
+  // recordings note which tuning they were made with and a reload isn't
+  // an input, so the tuning stays put while recording
+  uint64_t digest = tuning_digest(world.tuning);
+  Replay replay;
+  replay_init(&replay, seed, digest);
+  TimelineWriter timeline;
+  if (timeline_path && !timeline_writer_open(&timeline, timeline_path, seed,
+                                             digest, TIMELINE_BLOCK_TICKS)) {
+    timeline_path = NULL; // play on without it
+  }
+  bool reloads = !record_path && !timeline_path;
+  if (!reloads) {
+    printf("Recording: %s changes won't be picked up until the next run\n",
+           tuning_path);
+  }
 
-  // spawn 2 Pookas  & 1 Fygar
-  enemy_init(&enemies[enemy_count++], ENEMY_POOKA, 20, 5);
-  // enemy_init(&enemies[enemy_count++], ENEMY_POOKA, 5, 10);
-  // enemy_init(&enemies[enemy_count++], ENEMY_FYGAR, 10, 8);
+  Frame frame = {&world, &replay, record_path != NULL,
+                 timeline_path ? &timeline : NULL,
+                 scenario_name ? &scenario_run : NULL, INPUT_NONE, turbo,
+                 present_ms, 0, NULL};
+  JobCounter ticks_done, frame_done;
 
   // Game loop control
   bool running = true;
   SDL_Event event;
+  Uint64 run_start = SDL_GetTicksNS();
+  unsigned long frames = 0;
+  Uint64 grid_ns = 0; // drawing the grid, all frames
 
   // main game loop
   while (running) {
+    // last arrow key pressed this frame
+    int input = INPUT_NONE;
+
     // handle events
     while (SDL_PollEvent(&event)) {
       if (event.type == SDL_EVENT_QUIT) {
         // use clicked x
         running = false;
+      } else if (event.type == SDL_EVENT_RENDER_TARGETS_RESET ||
+                 event.type == SDL_EVENT_RENDER_DEVICE_RESET) {
+        // the grid texture only gets the rows that changed, whatever it
+        // held is gone now
+        bool device_lost = event.type == SDL_EVENT_RENDER_DEVICE_RESET;
+        if (!render_grid_reset(&grid_renderer, renderer, device_lost)) {
+          fprintf(stderr, "Grid texture creation failed: %s\n",
+                  SDL_GetError());
+          running = false;
+        }
       } else if (event.type == SDL_EVENT_KEY_DOWN) {
         // user pressed a key
         if (event.key.key == SDLK_ESCAPE) {
           running = false;
         } else if (event.key.key == SDLK_UP) {
-          player_move(&player, DIR_UP, grid);
+          input = DIR_UP;
         } else if (event.key.key == SDLK_DOWN) {
-          player_move(&player, DIR_DOWN, grid);
+          input = DIR_DOWN;
         } else if (event.key.key == SDLK_LEFT) {
-          player_move(&player, DIR_LEFT, grid);
+          input = DIR_LEFT;
         } else if (event.key.key == SDLK_RIGHT) {
-          player_move(&player, DIR_RIGHT, grid);
+          input = DIR_RIGHT;
         }
       }
     }
 
     // ========= UPDATE (game Logic) ===========
-    player_update(&player);
-
-    // Update all enenmies
-    for (int i = 0; i < enemy_count; i++) {
-      enemy_update(&enemies[i], &player, grid);
-
-      // check collision with player
-      if (enemy_collides_with_player(&enemies[i], &player)) {
-        printf("Hit by enemy!! Game over!\n");
-        player.is_alive = false;
-      }
+    // picked up between frames, while no sim job is running;
+    // the world keeps its state
+    if (reloads && tuning_watch_poll(&tuning_watch)) {
+      world.tuning = tuning_watch_get(&tuning_watch);
     }
-    // ========= RENDER ========================
-
-    // clear screen with a color (R,G,B,A)
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    // Display the entire grid
-    render_draw_grid(renderer, grid);
-
-    // Display enemies
-    render_draw_enemies(renderer, enemies, enemy_count);
 
-    // Draw player on top
-    render_draw_player(renderer, &player);
+    frame.input = input;
+    frame.snapshot = &snapshots[1 - shown];
+    jobs_counter_init(&ticks_done);
+    jobs_counter_init(&frame_done);
+    jobs_run(frame_sim, &frame, 0, &ticks_done);
+    jobs_run_after(&ticks_done, frame_snapshot, &frame, 0, &frame_done);
 
-    // Draw HUD - dirt bar
-    render_draw_hud(renderer, &player);
+    // ========= RENDER ========================
+    // last frame's state, drawn while this frame's ticks run
+    grid_ns += render_frame(renderer, &grid_renderer, &snapshots[shown]);
+    frames++;
+    if (max_frames > 0 && frames >= max_frames) {
+      running = false;
+    }
 
-    // Present
-    SDL_RenderPresent(renderer);
+    // helps out with the jobs if they're not done yet; ticks_done too, its
+    // last job may still be releasing the snapshot job when frame_done
+    // drops, and both get reused next frame
+    jobs_wait(&frame_done);
+    jobs_wait(&ticks_done);
+    shown = 1 - shown;
 
-    // Small delay to not max out CPU
-    SDL_Delay(16); // 60 FPD (1000ms/60 ≈ 16ms);
+    // Small delay to not max out CPU (turbo runs flat out)
+    if (turbo < 0) {
+      SDL_Delay(16); // 60 FPD (1000ms/60 ≈ 16ms);
+    }
   }
 
+  double run_seconds = (SDL_GetTicksNS() - run_start) / 1e9;
+  printf("Ran %lu ticks in %.1f s (%.0f ticks/s)\n", frame.ticks_run,
+         run_seconds, run_seconds > 0 ? frame.ticks_run / run_seconds : 0.0);
+  printf("Drew %lu frames, %.1f us each for the grid (%s)\n", frames,
+         frames > 0 ? grid_ns / 1e3 / frames : 0.0,
+         render_grid_mode_name(grid_mode));
+
   // cleanup - Always in reverse order
+  render_grid_free(&grid_renderer);
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
 
+  sim_snapshot_free(&snapshots[0]);
+  sim_snapshot_free(&snapshots[1]);
+  replay.checksum = sim_zobrist(&world);
+  sim_free(&world);
+  jobs_stop();
+  metrics_stop();
+  eventlog_close();
+  tuning_watch_stop(&tuning_watch);
+
+  if (record_path) {
+    if (replay_save(&replay, record_path)) {
+      printf("Replay saved to %s (%zu ticks)\n", record_path,
+             replay.tick_count);
+    }
+  }
+  replay_free(&replay);
+  if (timeline_path && timeline_writer_close(&timeline)) {
+    printf("Timeline saved to %s (%llu ticks)\n", timeline_path,
+           timeline.tick_count);
+  }
+
   printf("Goodbye!\n");
   return 0;
 }
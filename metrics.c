@@ -0,0 +1,385 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SHARDS 64
+
+// histogram buckets: values below 16 get their own bucket, above that
+// every power of two is split into 16 linear sub-buckets
+#define SUB_BITS 4
+#define SUB_COUNT (1 << SUB_BITS)
+#define BUCKET_COUNT ((64 - SUB_BITS) * SUB_COUNT)
+
+typedef struct {
+  // one cache line apart so threads never share a line
+  _Alignas(64) atomic_llong counters[METRIC_COUNTER_COUNT];
+  atomic_llong hist_sum[METRIC_HISTOGRAM_COUNT];
+  atomic_llong hist_buckets[METRIC_HISTOGRAM_COUNT][BUCKET_COUNT];
+} Shard;
+
+static Shard shards[MAX_SHARDS];
+static atomic_int shard_count;
+
+static atomic_llong gauges[METRIC_GAUGE_COUNT];
+
+static _Thread_local Shard *local_shard;
+static _Thread_local bool local_shared; // ran out of shards, must use RMW
+
+static const struct {
+  const char *name;
+  const char *help;
+} counter_info[METRIC_COUNTER_COUNT] = {
+    {"digdug_ticks_total", "Simulation ticks run."},
+    {"digdug_tiles_dug_total", "Dirt tiles dug into tunnel."},
+    {"digdug_draw_calls_total", "Renderer draw calls issued."},
+    {"digdug_allocations_total", "Heap allocations made by the game."},
+    {"digdug_spawns_dropped_total",
+     "Enemies due from a wave with no free slot (max_enemies)."},
+};
+
+static const struct {
+  const char *name;
+  const char *help;
+} gauge_info[METRIC_GAUGE_COUNT] = {
+    {"digdug_enemies_alive", "Enemies currently alive."},
+};
+
+static const struct {
+  const char *name;
+  const char *help;
+} histogram_info[METRIC_HISTOGRAM_COUNT] = {
+    {"digdug_tick_time_ns", "Wall time of one simulation tick."},
+};
+
+static Shard *get_shard(void) {
+  if (!local_shard) {
+    int index = atomic_fetch_add(&shard_count, 1);
+    if (index >= MAX_SHARDS) {
+      index = MAX_SHARDS - 1; // too many threads: share the last one
+      local_shared = true;
+    }
+    local_shard = &shards[index];
+  }
+  return local_shard;
+}
+
+// the owning thread is the only writer, so a plain load + store is enough
+static void bump(atomic_llong *slot, long long amount) {
+  if (local_shared) {
+    atomic_fetch_add_explicit(slot, amount, memory_order_relaxed);
+  } else {
+    long long old = atomic_load_explicit(slot, memory_order_relaxed);
+    atomic_store_explicit(slot, old + amount, memory_order_relaxed);
+  }
+}
+
+static int bucket_index(long long value) {
+  if (value < SUB_COUNT) {
+    return value < 0 ? 0 : (int)value;
+  }
+  int msb = 63 - __builtin_clzll((unsigned long long)value);
+  int shift = msb - SUB_BITS;
+  return (shift + 1) * SUB_COUNT + (int)((value >> shift) & (SUB_COUNT - 1));
+}
+
+// first value that no longer fits in this bucket
+static long long bucket_upper(int index) {
+  if (index < SUB_COUNT) {
+    return index + 1;
+  }
+  int shift = index / SUB_COUNT - 1;
+  unsigned long long sub = index % SUB_COUNT;
+  // the top bucket ends at 2^63, which only fits unsigned
+  unsigned long long upper = (SUB_COUNT + sub + 1) << shift;
+  return upper > LLONG_MAX ? LLONG_MAX : (long long)upper;
+}
+
+void metrics_add(MetricCounter counter, long long amount) {
+  bump(&get_shard()->counters[counter], amount);
+}
+
+void metrics_set(MetricGauge gauge, long long value) {
+  atomic_store_explicit(&gauges[gauge], value,
+                        memory_order_relaxed);
+}
+
+void metrics_record(MetricHistogram histogram, long long value) {
+  Shard *shard = get_shard();
+  bump(&shard->hist_buckets[histogram][bucket_index(value)], 1);
+  bump(&shard->hist_sum[histogram], value);
+}
+
+long long metrics_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// ===== aggregation / formatting =====
+
+typedef struct {
+  char *buf;
+  size_t size;
+  size_t used;
+} Out;
+
+static void out_printf(Out *out, const char *fmt, ...) {
+  char dummy[1];
+  char *dst = out->used < out->size ? out->buf + out->used : dummy;
+  size_t room = out->used < out->size ? out->size - out->used : 1;
+
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(dst, room, fmt, args);
+  va_end(args);
+  if (n > 0) {
+    out->used += (size_t)n;
+  }
+}
+
+// sum one slot over all shards; slot points at the field in shard 0
+static long long sum_slot(atomic_llong *slot) {
+  size_t offset = (size_t)((char *)slot - (char *)&shards[0]);
+  int count = atomic_load(&shard_count);
+  if (count > MAX_SHARDS) {
+    count = MAX_SHARDS;
+  }
+  long long total = 0;
+  for (int i = 0; i < count; i++) {
+    atomic_llong *shard_slot = (atomic_llong *)((char *)&shards[i] + offset);
+    total += atomic_load_explicit(shard_slot, memory_order_relaxed);
+  }
+  return total;
+}
+
+static void format_histogram(Out *out, int h) {
+  long long buckets[BUCKET_COUNT];
+  long long count = 0;
+  int last = -1;
+  for (int b = 0; b < BUCKET_COUNT; b++) {
+    buckets[b] = sum_slot(&shards[0].hist_buckets[h][b]);
+    count += buckets[b];
+    if (buckets[b]) {
+      last = b;
+    }
+  }
+
+  const char *name = histogram_info[h].name;
+  out_printf(out, "# HELP %s %s\n# TYPE %s histogram\n", name,
+             histogram_info[h].help, name);
+
+  // Prometheus gets one bucket per power of two, the fine HDR buckets are
+  // used for the quantiles below. 2^62 is the last power a long long can
+  // hold, anything past it only shows up in +Inf
+  long long cumulative = 0;
+  int b = 0;
+  for (int power = 0; power < 63 && last >= 0 && b <= last; power++) {
+    long long le = 1LL << power;
+    while (b < BUCKET_COUNT && bucket_upper(b) <= le) {
+      cumulative += buckets[b++];
+    }
+    out_printf(out, "%s_bucket{le=\"%lld\"} %lld\n", name, le - 1,
+               cumulative);
+  }
+  out_printf(out, "%s_bucket{le=\"+Inf\"} %lld\n", name, count);
+  out_printf(out, "%s_sum %lld\n%s_count %lld\n", name,
+             sum_slot(&shards[0].hist_sum[h]), name, count);
+
+  static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+  out_printf(out, "# TYPE %s_quantile gauge\n", name);
+  for (size_t q = 0; q < sizeof quantiles / sizeof quantiles[0]; q++) {
+    long long rank = (long long)(quantiles[q] * count);
+    long long seen = 0;
+    long long value = 0;
+    for (int i = 0; i <= last; i++) {
+      seen += buckets[i];
+      if (seen > rank) {
+        value = bucket_upper(i) - 1;
+        break;
+      }
+    }
+    out_printf(out, "%s_quantile{quantile=\"%g\"} %lld\n", name,
+               quantiles[q], value);
+  }
+}
+
+size_t metrics_format(char *buf, size_t size) {
+  Out out = {buf, size, 0};
+
+  for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+    out_printf(&out, "# HELP %s %s\n# TYPE %s counter\n%s %lld\n",
+               counter_info[c].name, counter_info[c].help,
+               counter_info[c].name, counter_info[c].name,
+               sum_slot(&shards[0].counters[c]));
+  }
+  for (int g = 0; g < METRIC_GAUGE_COUNT; g++) {
+    out_printf(&out, "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n",
+               gauge_info[g].name, gauge_info[g].help, gauge_info[g].name,
+               gauge_info[g].name,
+               atomic_load_explicit(&gauges[g], memory_order_relaxed));
+  }
+  for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+    format_histogram(&out, h);
+  }
+
+  return out.used;
+}
+
+// ===== exporter thread =====
+
+#define EXPORT_BUF_SIZE 65536
+
+static pthread_t exporter;
+static bool exporter_running;
+static atomic_bool exporter_stop;
+static int listen_fd = -1;
+static const char *dump_path;
+static int dump_interval_s;
+static char export_buf[EXPORT_BUF_SIZE];
+
+static size_t format_export(void) {
+  size_t len = metrics_format(export_buf, sizeof export_buf);
+  return len < sizeof export_buf ? len : sizeof export_buf - 1;
+}
+
+static void dump_file(void) {
+  size_t len = format_export();
+
+  // write a temp file and rename, so readers never see half a file
+  char tmp[1024];
+  snprintf(tmp, sizeof tmp, "%s.tmp", dump_path);
+  FILE *file = fopen(tmp, "w");
+  if (!file) {
+    return;
+  }
+  fwrite(export_buf, 1, len, file);
+  if (fclose(file) == 0) {
+    rename(tmp, dump_path);
+  }
+}
+
+static void serve_client(int fd) {
+  // we don't care what was asked, everything gets the metrics page
+  char request[1024];
+  struct pollfd pfd = {fd, POLLIN, 0};
+  if (poll(&pfd, 1, 1000) > 0) {
+    (void)!read(fd, request, sizeof request);
+  }
+
+  size_t len = format_export();
+  char header[128];
+  int header_len = snprintf(header, sizeof header,
+                            "HTTP/1.0 200 OK\r\n"
+                            "Content-Type: text/plain; version=0.0.4\r\n"
+                            "Content-Length: %zu\r\n\r\n",
+                            len);
+  (void)!write(fd, header, (size_t)header_len);
+  (void)!write(fd, export_buf, len);
+  close(fd);
+}
+
+static void *exporter_main(void *arg) {
+  (void)arg;
+  long long next_dump = metrics_now_ns();
+
+  while (!atomic_load(&exporter_stop)) {
+    if (listen_fd >= 0) {
+      struct pollfd pfd = {listen_fd, POLLIN, 0};
+      if (poll(&pfd, 1, 200) > 0) {
+        int client = accept(listen_fd, NULL, NULL);
+        if (client >= 0) {
+          serve_client(client);
+        }
+      }
+    } else {
+      struct timespec nap = {0, 200 * 1000000L};
+      nanosleep(&nap, NULL);
+    }
+
+    if (dump_path && metrics_now_ns() >= next_dump) {
+      dump_file();
+      next_dump += dump_interval_s * 1000000000LL;
+    }
+  }
+  return NULL;
+}
+
+static int open_listener(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int yes = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+
+  // local only, put a real proxy in front if it must be reachable
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((unsigned short)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof addr) != 0 ||
+      listen(fd, 8) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool metrics_start(int port, const char *path, int interval_s) {
+  if (exporter_running) {
+    return true;
+  }
+
+  if (port > 0) {
+    listen_fd = open_listener(port);
+    if (listen_fd < 0) {
+      fprintf(stderr, "Metrics: cannot listen on 127.0.0.1:%d\n", port);
+      return false;
+    }
+  }
+  dump_path = path;
+  dump_interval_s = interval_s > 0 ? interval_s : 10;
+
+  atomic_store(&exporter_stop, false);
+  if (pthread_create(&exporter, NULL, exporter_main, NULL) != 0) {
+    fprintf(stderr, "Metrics: cannot start exporter thread\n");
+    if (listen_fd >= 0) {
+      close(listen_fd);
+      listen_fd = -1;
+    }
+    return false;
+  }
+  exporter_running = true;
+  return true;
+}
+
+void metrics_stop(void) {
+  if (!exporter_running) {
+    return;
+  }
+  atomic_store(&exporter_stop, true);
+  pthread_join(exporter, NULL);
+  exporter_running = false;
+
+  if (dump_path) {
+    dump_file(); // final numbers
+  }
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    listen_fd = -1;
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Live telemetry for long running (headless) games.
+//
+// Every thread writes into its own shard with plain relaxed stores, so
+// recording a metric costs about as much as incrementing a local int.
+// Shards are only summed up when somebody reads them (HTTP scrape or
+// file dump), never in the game loop.
+
+typedef enum {
+  METRIC_TICKS,       // sim ticks run
+  METRIC_TILES_DUG,   // dirt tiles turned into tunnel (Player.dirt_dug)
+  METRIC_DRAW_CALLS,  // SDL fill/draw calls issued
+  METRIC_ALLOCATIONS, // heap allocations made by the game
+  METRIC_SPAWNS_DROPPED, // enemies a wave had due with no free slot
+  METRIC_COUNTER_COUNT
+} MetricCounter;
+
+// gauges keep the last value set, from whichever thread set it
+// (the sim can run on a different job thread every frame)
+typedef enum {
+  METRIC_ENEMIES_ALIVE,
+  METRIC_GAUGE_COUNT
+} MetricGauge;
+
+// HDR style histograms: ~6% relative precision from 1 to 2^63
+typedef enum {
+  METRIC_TICK_TIME_NS,
+  METRIC_HISTOGRAM_COUNT
+} MetricHistogram;
+
+void metrics_add(MetricCounter counter, long long amount);
+void metrics_set(MetricGauge gauge, long long value);
+void metrics_record(MetricHistogram histogram, long long value);
+
+// monotonic clock in nanoseconds, for timing ticks
+long long metrics_now_ns(void);
+
+// write all metrics in Prometheus text format
+// returns the length written (truncated to size like snprintf)
+size_t metrics_format(char *buf, size_t size);
+
+// start the background exporter thread
+// port > 0: serve http://127.0.0.1:port/metrics
+// path != NULL: rewrite the file every interval_s seconds
+bool metrics_start(int port, const char *path, int interval_s);
+
+// stop the exporter (writes the file one last time)
+void metrics_stop(void);
+
+#endif
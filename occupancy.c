@@ -0,0 +1,90 @@
+#include "occupancy.h"
+#include <string.h>
+
+static bool in_grid(int col, int row) {
+  return col >= 0 && col < GRID_WIDTH && row >= 0 && row < GRID_HEIGHT;
+}
+
+void occupancy_clear(Occupancy *occ) {
+  memset(occ, 0, sizeof *occ);
+  occ->player_col = -1;
+  occ->player_row = -1;
+}
+
+void occupancy_add_enemy(Occupancy *occ, int col, int row) {
+  if (!in_grid(col, row)) {
+    return;
+  }
+  if (occ->enemy_counts[row][col]++ == 0) {
+    occ->enemy_rows[row] |= 1u << col;
+    occ->enemy_cols[col] |= 1u << row;
+  }
+}
+
+void occupancy_remove_enemy(Occupancy *occ, int col, int row) {
+  if (!in_grid(col, row) || occ->enemy_counts[row][col] == 0) {
+    return;
+  }
+  if (--occ->enemy_counts[row][col] == 0) {
+    occ->enemy_rows[row] &= ~(1u << col);
+    occ->enemy_cols[col] &= ~(1u << row);
+  }
+}
+
+void occupancy_move_enemy(Occupancy *occ, int from_col, int from_row,
+                          int col, int row) {
+  occupancy_remove_enemy(occ, from_col, from_row);
+  occupancy_add_enemy(occ, col, row);
+}
+
+void occupancy_set_player(Occupancy *occ, int col, int row) {
+  if (in_grid(occ->player_col, occ->player_row)) {
+    occ->player_rows[occ->player_row] = 0;
+  }
+  occ->player_col = col;
+  occ->player_row = row;
+  if (in_grid(col, row)) {
+    occ->player_rows[row] = 1u << col;
+  }
+}
+
+uint32_t occupancy_span(int first, int last) {
+  if (first < 0) {
+    first = 0;
+  }
+  if (last > 31) {
+    last = 31;
+  }
+  if (first > last) {
+    return 0;
+  }
+  // 2u << 31 wraps to 0, so last = 31 gives all ones
+  uint32_t upto_last = (2u << last) - 1;
+  return upto_last & ~((1u << first) - 1);
+}
+
+bool occupancy_enemy_at(const Occupancy *occ, int col, int row) {
+  return in_grid(col, row) && (occ->enemy_rows[row] >> col & 1u);
+}
+
+bool occupancy_enemy_in_row(const Occupancy *occ, int row, int c0, int c1) {
+  if (row < 0 || row >= GRID_HEIGHT) {
+    return false;
+  }
+  return (occ->enemy_rows[row] & occupancy_span(c0, c1)) != 0;
+}
+
+bool occupancy_enemy_in_col(const Occupancy *occ, int col, int r0, int r1) {
+  if (col < 0 || col >= GRID_WIDTH) {
+    return false;
+  }
+  return (occ->enemy_cols[col] & occupancy_span(r0, r1)) != 0;
+}
+
+bool occupancy_enemy_on_player(const Occupancy *occ) {
+  int row = occ->player_row;
+  if (row < 0 || row >= GRID_HEIGHT) {
+    return false;
+  }
+  return (occ->enemy_rows[row] & occ->player_rows[row]) != 0;
+}
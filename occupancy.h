@@ -0,0 +1,50 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Who stands where, as bitplanes next to the tile grid: one bit per tile,
+// one word per row (and per column), so "is there an enemy here / in this
+// stretch" is a mask AND instead of a loop over all enemies.
+// Kept up to date by the sim as things move; only live enemies count.
+// Positions outside the grid are ignored.
+
+_Static_assert(GRID_WIDTH <= 32 && GRID_HEIGHT <= 32,
+               "occupancy rows and columns are 32 bit masks");
+
+typedef struct {
+  uint32_t enemy_rows[GRID_HEIGHT]; // bit col set: an enemy at (col, row)
+  uint32_t enemy_cols[GRID_WIDTH];  // bit row set: same thing by column
+  uint32_t player_rows[GRID_HEIGHT];
+  int player_col;
+  int player_row;
+  // enemies can share a tile, the bit goes away when the last one leaves
+  uint32_t enemy_counts[GRID_HEIGHT][GRID_WIDTH];
+} Occupancy;
+
+void occupancy_clear(Occupancy *occ);
+
+void occupancy_add_enemy(Occupancy *occ, int col, int row);
+void occupancy_remove_enemy(Occupancy *occ, int col, int row);
+void occupancy_move_enemy(Occupancy *occ, int from_col, int from_row,
+                          int col, int row);
+
+void occupancy_set_player(Occupancy *occ, int col, int row);
+
+// mask with bits first..last set (clamped to the grid)
+uint32_t occupancy_span(int first, int last);
+
+bool occupancy_enemy_at(const Occupancy *occ, int col, int row);
+
+// any enemy in row between columns c0..c1 (inclusive)
+bool occupancy_enemy_in_row(const Occupancy *occ, int row, int c0, int c1);
+
+// any enemy in column between rows r0..r1 (inclusive)
+bool occupancy_enemy_in_col(const Occupancy *occ, int col, int r0, int r1);
+
+// an enemy on the player's tile
+bool occupancy_enemy_on_player(const Occupancy *occ);
+
+#endif
@@ -0,0 +1,101 @@
+#include "perception.h"
+#include <stdlib.h>
+#include <string.h>
+
+static bool in_grid(int col, int row) {
+  return col >= 0 && col < GRID_WIDTH && row >= 0 && row < GRID_HEIGHT;
+}
+
+static bool is_open(const Perception *perception, int col, int row) {
+  return perception->open_rows[row] >> col & 1u;
+}
+
+void perception_init(Perception *perception,
+                     TileType grid[GRID_HEIGHT][GRID_WIDTH]) {
+  memset(perception, 0, sizeof *perception);
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      TileType tile = grid[row][col];
+      if (tile == TILE_TUNNEL || tile == TILE_EMPTY) {
+        perception->open_rows[row] |= 1u << col;
+      }
+    }
+  }
+  perception->player_col = -1;
+  perception->player_row = -1;
+  perception->dirty = true;
+}
+
+void perception_dig(Perception *perception, int col, int row) {
+  if (!in_grid(col, row)) {
+    return;
+  }
+  perception->open_rows[row] |= 1u << col;
+  perception->dirty = true;
+  perception->noise = true;
+  perception->noise_col = col;
+  perception->noise_row = row;
+}
+
+// the open stretch through the player along its row and column, plus the
+// tile that ends each stretch (an enemy ghosting in the dirt right next
+// to a tunnel can look down it)
+static void rebuild(Perception *perception) {
+  int pc = perception->player_col;
+  int pr = perception->player_row;
+  memset(perception->seen_rows, 0, sizeof perception->seen_rows);
+  perception->dirty = false;
+  if (!in_grid(pc, pr)) {
+    return;
+  }
+
+  perception->seen_rows[pr] |= 1u << pc;
+  for (int col = pc - 1; col >= 0; col--) {
+    perception->seen_rows[pr] |= 1u << col;
+    if (!is_open(perception, col, pr))
+      break;
+  }
+  for (int col = pc + 1; col < GRID_WIDTH; col++) {
+    perception->seen_rows[pr] |= 1u << col;
+    if (!is_open(perception, col, pr))
+      break;
+  }
+  for (int row = pr - 1; row >= 0; row--) {
+    perception->seen_rows[row] |= 1u << pc;
+    if (!is_open(perception, pc, row))
+      break;
+  }
+  for (int row = pr + 1; row < GRID_HEIGHT; row++) {
+    perception->seen_rows[row] |= 1u << pc;
+    if (!is_open(perception, pc, row))
+      break;
+  }
+}
+
+void perception_update(Perception *perception, int player_col,
+                       int player_row) {
+  if (perception->dirty || player_col != perception->player_col ||
+      player_row != perception->player_row) {
+    perception->player_col = player_col;
+    perception->player_row = player_row;
+    rebuild(perception);
+  }
+}
+
+void perception_end_tick(Perception *perception) {
+  perception->noise = false;
+}
+
+bool perception_sees(const Perception *perception, int col, int row) {
+  return in_grid(col, row) && (perception->seen_rows[row] >> col & 1u);
+}
+
+bool perception_hears(const Perception *perception, int col, int row,
+                      int radius) {
+  if (!perception->noise) {
+    return false;
+  }
+  int distance = abs(col - perception->noise_col) +
+                 abs(row - perception->noise_row);
+  return distance <= radius;
+}
@@ -0,0 +1,49 @@
+#ifndef PERCEPTION_H
+#define PERCEPTION_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// What enemies can notice about the player.
+//
+// Sight: straight along a row or column, as long as every tile in between
+// is open (tunnel or empty). Open tiles are kept as one bitmask per row,
+// patched on every dig. Which tiles can see the player is cached as
+// bitplanes and only rebuilt when the player moves or something is dug,
+// so every enemy's check is a single bit test however many there are.
+//
+// Hearing: digging makes noise; enemies within a radius of it hear it.
+
+typedef struct {
+  uint32_t open_rows[GRID_HEIGHT]; // bit col set: tunnel or empty
+  uint32_t seen_rows[GRID_HEIGHT]; // bit col set: can see the player
+  int player_col; // player tile the cache was built for
+  int player_row;
+  bool dirty;     // a dig since the cache was built
+  bool noise;     // the player dug this tick
+  int noise_col;
+  int noise_row;
+} Perception;
+
+void perception_init(Perception *perception,
+                     TileType grid[GRID_HEIGHT][GRID_WIDTH]);
+
+// a tile was dug (dirt -> tunnel) this tick
+void perception_dig(Perception *perception, int col, int row);
+
+// call once per tick, after the player moved and before enemies look
+void perception_update(Perception *perception, int player_col,
+                       int player_row);
+
+// call at the end of a tick (noise only lasts one tick)
+void perception_end_tick(Perception *perception);
+
+// can something at (col, row) see the player
+bool perception_sees(const Perception *perception, int col, int row);
+
+// did something at (col, row) hear digging this tick
+bool perception_hears(const Perception *perception, int col, int row,
+                      int radius);
+
+#endif
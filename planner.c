@@ -0,0 +1,92 @@
+#include "planner.h"
+#include <stdlib.h>
+
+static bool in_grid(int col, int row) {
+  return col >= 0 && col < GRID_WIDTH && row >= 0 && row < GRID_HEIGHT;
+}
+
+void planner_init(Planner *planner, const GridKernels *kernels) {
+  planner->kernels = kernels;
+  planner->player_col = -1;
+  planner->player_row = -1;
+  planner->head = 0;
+  planner->tail = 0;
+  planner->dirty = true;
+}
+
+void planner_dig(Planner *planner) { planner->dirty = true; }
+
+// start over from the player's tile
+static void restart(Planner *planner, const TunnelIndex *tunnels,
+                    int player_col, int player_row) {
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      planner->dist[row][col] = -1;
+    }
+  }
+  planner->player_col = player_col;
+  planner->player_row = player_row;
+  planner->dirty = false;
+  planner->head = 0;
+  planner->tail = 0;
+  if (tunnel_is_open(tunnels, player_col, player_row)) {
+    planner->dist[player_row][player_col] = 0;
+    planner->queue[planner->tail++] = player_row * GRID_WIDTH + player_col;
+  }
+}
+
+void planner_extend(Planner *planner, const TunnelIndex *tunnels,
+                    int player_col, int player_row, int col, int row) {
+  if (planner->dirty || player_col != planner->player_col ||
+      player_row != planner->player_row) {
+    restart(planner, tunnels, player_col, player_row);
+  }
+  if (!in_grid(col, row)) {
+    return;
+  }
+
+  // a whole layer is finished before the next one starts, so once (col,
+  // row) has a distance, all its neighbors one step closer have one too.
+  // Most enemies find their tile already reached and skip the call
+  int target = row * GRID_WIDTH + col;
+  if (planner->dist[row][col] < 0 && planner->head < planner->tail) {
+    planner->kernels->bfs(GRID_WIDTH, GRID_HEIGHT, tunnels->parent,
+                          &planner->dist[0][0], planner->queue,
+                          &planner->head, &planner->tail, target);
+  }
+}
+
+bool planner_choose(const Planner *planner, const TunnelIndex *tunnels,
+                    int col, int row, int player_col, int player_row,
+                    const Tuning *tuning, Direction *dir) {
+  int pc = player_col;
+  int pr = player_row;
+  if (!tunnel_connected(tunnels, col, row, pc, pr)) {
+    return false; // no tunnel route at all
+  }
+  int steps = planner->dist[row][col];
+  if (steps <= 0) {
+    return false;
+  }
+
+  // a tile takes slowdown + 1 ticks
+  long tunnel_cost = (long)steps * (tuning->enemy_tunnel_slowdown + 1);
+  long ghost_cost = (long)(abs(pc - col) + abs(pr - row)) *
+                    (tuning->enemy_dirt_slowdown + 1);
+  if (ghost_cost < tunnel_cost) {
+    return false;
+  }
+
+  // downhill on the distance field, first match in Direction order
+  static const int dc[4] = {0, 0, -1, 1};
+  static const int dr[4] = {-1, 1, 0, 0};
+  for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+    int nc = col + dc[d];
+    int nr = row + dr[d];
+    if (in_grid(nc, nr) && planner->dist[nr][nc] == steps - 1) {
+      *dir = (Direction)d;
+      return true;
+    }
+  }
+  return false;
+}
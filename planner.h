@@ -0,0 +1,50 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "kernels.h"
+#include "player.h"
+#include "tunnel.h"
+#include "tuning.h"
+#include "types.h"
+#include <stdbool.h>
+
+// Route choice for chasing enemies: follow the tunnels, or ghost straight
+// through the dirt?
+//
+// "Is there a tunnel route at all" comes from the tunnel index. A
+// distance field over the tunnels, out from the player's tile, is grown
+// only as far as the enemies that need it this tick (breadth first, so it
+// can pick up where it stopped) and restarted when the player moves or
+// something is dug. Walking it costs tunnel_slowdown per tile, ghosting
+// costs dirt_slowdown per tile. The growing is the level's bfs kernel.
+
+typedef struct {
+  int dist[GRID_HEIGHT][GRID_WIDTH]; // tunnel tiles to the player, -1 = none
+  int queue[TUNNEL_TILES];           // breadth first search, resumable
+  int head;
+  int tail;
+  int player_col; // tile the distance field grows from
+  int player_row;
+  bool dirty;
+  const GridKernels *kernels; // the level's, for the breadth first search
+} Planner;
+
+void planner_init(Planner *planner, const GridKernels *kernels);
+
+// something was dug, the distance field has to start over
+void planner_dig(Planner *planner);
+
+// grow the distance field from the player until it covers (col, row)
+// call for every enemy that may plan this tick, before the enemy update
+void planner_extend(Planner *planner, const TunnelIndex *tunnels,
+                    int player_col, int player_row, int col, int row);
+
+// next step toward the player through the tunnels, if there is a tunnel
+// route and it's no slower than ghosting straight there
+// (col, row) must have been passed to planner_extend this tick if it's in
+// the player's tunnel system
+bool planner_choose(const Planner *planner, const TunnelIndex *tunnels,
+                    int col, int row, int player_col, int player_row,
+                    const Tuning *tuning, Direction *dir);
+
+#endif
@@ -1,5 +1,6 @@
 #include "grid.h"
 #include "player.h"
+#include "tuning.h"
 #include "types.h"
 
 void player_init(Player *player, int start_col, int start_row) {
@@ -18,7 +19,8 @@ static bool can_move_to(TileType tile) {
 }
 
 bool player_move(Player *player, Direction dir,
-                 TileType grid[GRID_HEIGHT][GRID_WIDTH]) {
+                 TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                 const Tuning *tuning) {
   // check slowdown - cannot move yet
   if (player->move_slowdown > 0)
     return false;
@@ -72,9 +74,9 @@ bool player_move(Player *player, Direction dir,
 
   // set movement slowdown based on what happened
   if (just_dug) {
-    player->move_slowdown = 8; // slower when digging (8 frames)
+    player->move_slowdown = tuning->player_dig_slowdown; // slower digging
   } else {
-    player->move_slowdown = 3; // faster in tunnels
+    player->move_slowdown = tuning->player_tunnel_slowdown; // faster
   }
 
   return true;
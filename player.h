@@ -1,6 +1,7 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
+#include "tuning.h"
 #include "types.h"
 #include <stdbool.h>
 
@@ -18,7 +19,8 @@ typedef struct {
 void player_init(Player *player, int start_col, int start_row);
 
 bool player_move(Player *player, Direction dir,
-                 TileType grid[GRID_HEIGHT][GRID_WIDTH]);
+                 TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                 const Tuning *tuning);
 
 void player_get_pixel_pos(Player *player, int *x, int *y);
 
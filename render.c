@@ -1,41 +1,33 @@
 #include "enemy.h"
+#include "metrics.h"
 #include "player.h"
 #include "render.h"
 #include "types.h"
 #include <SDL3/SDL_render.h>
+#include <string.h>
 
-void render_get_tile_color(TileType type, int *r, int *g, int *b) {
-  switch (type) {
-  case TILE_EMPTY:
-    *r = 0;
-    *g = 0;
-    *b = 0; // black
-    break;
-  case TILE_DIRT:
-    *r = 139;
-    *g = 69;
-    *b = 19; // light brown
-    break;
-  case TILE_TUNNEL:
-    *r = 50;
-    *g = 25;
-    *b = 10; // dark brown
-    break;
-  case TILE_ROCK:
-    *r = 128;
-    *g = 128;
-    *b = 128; // gray
-    break;
-
-  default:
+void render_get_tile_color(const Tuning *tuning, TileType type, int *r,
+                           int *g, int *b) {
+  if (type < TILE_EMPTY || type > TILE_ROCK) {
     *r = 255;
     *g = 0;
-    *b = 255; // gray
+    *b = 255; // magenta: unknown tile
+    return;
   }
+  const Color *color = &tuning->tile_colors[type];
+  *r = color->r;
+  *g = color->g;
+  *b = color->b;
+}
+
+// small helper so colors from the tuning can be used directly
+static void set_color(SDL_Renderer *renderer, const Color *color) {
+  SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
 }
 
 void render_draw_grid(SDL_Renderer *renderer,
-                      TileType grid[GRID_HEIGHT][GRID_WIDTH]) {
+                      TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                      const Tuning *tuning) {
   SDL_FRect tile;
   tile.w = TILE_SIZE;
   tile.h = TILE_SIZE;
@@ -50,16 +42,225 @@ void render_draw_grid(SDL_Renderer *renderer,
       TileType type = grid[row][col];
 
       int r, g, b;
-      render_get_tile_color(type, &r, &g, &b);
+      render_get_tile_color(tuning, type, &r, &g, &b);
 
       // draw them
       SDL_SetRenderDrawColor(renderer, r, g, b, 255);
       SDL_RenderFillRect(renderer, &tile);
     }
   }
+  metrics_add(METRIC_DRAW_CALLS, GRID_HEIGHT * GRID_WIDTH);
+}
+
+static const char *grid_mode_names[GRID_DRAW_COUNT] = {"rects", "batched",
+                                                       "target", "texture"};
+
+bool render_parse_grid_mode(const char *name, GridDrawMode *mode) {
+  for (int i = 0; i < GRID_DRAW_COUNT; i++) {
+    if (strcmp(name, grid_mode_names[i]) == 0) {
+      *mode = (GridDrawMode)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *render_grid_mode_name(GridDrawMode mode) {
+  return grid_mode_names[mode];
+}
+
+bool render_grid_init(GridRenderer *grid_renderer, SDL_Renderer *renderer,
+                      GridDrawMode mode) {
+  grid_renderer->mode = mode;
+  grid_renderer->texture = NULL;
+  grid_renderer->drawn = false;
+  memset(grid_renderer->palette, 0, sizeof grid_renderer->palette);
+  if (mode == GRID_DRAW_TARGET) {
+    grid_renderer->texture = SDL_CreateTexture(
+        renderer, SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_TARGET,
+        GRID_WIDTH * TILE_SIZE, GRID_HEIGHT * TILE_SIZE);
+  } else if (mode == GRID_DRAW_TEXTURE) {
+    grid_renderer->texture =
+        SDL_CreateTexture(renderer, SDL_PIXELFORMAT_XRGB8888,
+                          SDL_TEXTUREACCESS_STREAMING, GRID_WIDTH, GRID_HEIGHT);
+  } else {
+    return true;
+  }
+  if (!grid_renderer->texture) {
+    return false;
+  }
+  // texels stay sharp squares when scaled up
+  SDL_SetTextureScaleMode(grid_renderer->texture, SDL_SCALEMODE_NEAREST);
+  return true;
+}
+
+void render_grid_free(GridRenderer *grid_renderer) {
+  if (grid_renderer->texture) {
+    SDL_DestroyTexture(grid_renderer->texture);
+    grid_renderer->texture = NULL;
+  }
+}
+
+bool render_grid_reset(GridRenderer *grid_renderer, SDL_Renderer *renderer,
+                       bool device_lost) {
+  if (!device_lost) {
+    grid_renderer->drawn = false;
+    return true;
+  }
+  render_grid_free(grid_renderer);
+  return render_grid_init(grid_renderer, renderer, grid_renderer->mode);
+}
+
+static int color_index(TileType type) {
+  return type >= TILE_EMPTY && type <= TILE_ROCK ? (int)type : TILE_ROCK + 1;
+}
+
+// the tuning's tile colors packed as XRGB8888; a tuning reload that
+// changes any of them means drawing every row again
+static void update_palette(GridRenderer *grid_renderer,
+                           const Tuning *tuning) {
+  for (int i = 0; i < GRID_COLORS; i++) {
+    int r, g, b;
+    render_get_tile_color(tuning, (TileType)i, &r, &g, &b);
+    Uint32 packed = 0xFF000000u | (Uint32)r << 16 | (Uint32)g << 8 | (Uint32)b;
+    if (grid_renderer->palette[i] != packed) {
+      grid_renderer->palette[i] = packed;
+      grid_renderer->drawn = false;
+    }
+  }
+}
+
+// first and last row that differ from what the texture holds; false if
+// none do
+static bool dirty_rows(const GridRenderer *grid_renderer,
+                       TileType grid[GRID_HEIGHT][GRID_WIDTH], int *first,
+                       int *last) {
+  if (!grid_renderer->drawn) {
+    *first = 0;
+    *last = GRID_HEIGHT - 1;
+    return true;
+  }
+  *first = -1;
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    if (memcmp(grid[row], grid_renderer->last_grid[row], sizeof grid[row])) {
+      if (*first < 0) {
+        *first = row;
+      }
+      *last = row;
+    }
+  }
+  return *first >= 0;
+}
+
+static void draw_batched(GridRenderer *grid_renderer, SDL_Renderer *renderer,
+                         TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                         const Tuning *tuning) {
+  int counts[GRID_COLORS] = {0};
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      int color = color_index(grid[row][col]);
+      SDL_FRect *tile = &grid_renderer->batch[color][counts[color]++];
+      tile->x = col * TILE_SIZE;
+      tile->y = row * TILE_SIZE;
+      tile->w = TILE_SIZE;
+      tile->h = TILE_SIZE;
+    }
+  }
+
+  int calls = 0;
+  for (int color = 0; color < GRID_COLORS; color++) {
+    if (counts[color] == 0) {
+      continue;
+    }
+    int r, g, b;
+    render_get_tile_color(tuning, (TileType)color, &r, &g, &b);
+    SDL_SetRenderDrawColor(renderer, r, g, b, 255);
+    SDL_RenderFillRects(renderer, grid_renderer->batch[color], counts[color]);
+    calls++;
+  }
+  metrics_add(METRIC_DRAW_CALLS, calls);
+}
+
+// the changed rows as rects into the target, which keeps the rest
+static void draw_target(GridRenderer *grid_renderer, SDL_Renderer *renderer,
+                        TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                        const Tuning *tuning) {
+  int first, last;
+  if (dirty_rows(grid_renderer, grid, &first, &last)) {
+    SDL_SetRenderTarget(renderer, grid_renderer->texture);
+    SDL_FRect tile = {0, 0, TILE_SIZE, TILE_SIZE};
+    for (int row = first; row <= last; row++) {
+      for (int col = 0; col < GRID_WIDTH; col++) {
+        tile.x = col * TILE_SIZE;
+        tile.y = row * TILE_SIZE;
+        int r, g, b;
+        render_get_tile_color(tuning, grid[row][col], &r, &g, &b);
+        SDL_SetRenderDrawColor(renderer, r, g, b, 255);
+        SDL_RenderFillRect(renderer, &tile);
+      }
+      memcpy(grid_renderer->last_grid[row], grid[row], sizeof grid[row]);
+    }
+    SDL_SetRenderTarget(renderer, NULL);
+    grid_renderer->drawn = true;
+    metrics_add(METRIC_DRAW_CALLS, (last - first + 1) * GRID_WIDTH);
+  }
+}
+
+// the changed rows (and any between them: a locked rect's old contents
+// are gone) through the palette, in one lock
+static void draw_texture(GridRenderer *grid_renderer,
+                         TileType grid[GRID_HEIGHT][GRID_WIDTH]) {
+  int first, last;
+  if (!dirty_rows(grid_renderer, grid, &first, &last)) {
+    return;
+  }
+  SDL_Rect rows = {0, first, GRID_WIDTH, last - first + 1};
+  void *pixels;
+  int pitch;
+  if (!SDL_LockTexture(grid_renderer->texture, &rows, &pixels, &pitch)) {
+    return; // try again next frame
+  }
+  for (int row = first; row <= last; row++) {
+    Uint32 *texels = (Uint32 *)((Uint8 *)pixels + (row - first) * pitch);
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      texels[col] = grid_renderer->palette[color_index(grid[row][col])];
+    }
+    memcpy(grid_renderer->last_grid[row], grid[row], sizeof grid[row]);
+  }
+  SDL_UnlockTexture(grid_renderer->texture);
+  grid_renderer->drawn = true;
+}
+
+void render_grid_draw(GridRenderer *grid_renderer, SDL_Renderer *renderer,
+                      TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                      const Tuning *tuning) {
+  switch (grid_renderer->mode) {
+  case GRID_DRAW_RECTS:
+    render_draw_grid(renderer, grid, tuning);
+    return;
+  case GRID_DRAW_BATCHED:
+    draw_batched(grid_renderer, renderer, grid, tuning);
+    return;
+  case GRID_DRAW_TARGET:
+    update_palette(grid_renderer, tuning);
+    draw_target(grid_renderer, renderer, grid, tuning);
+    break;
+  case GRID_DRAW_TEXTURE:
+    update_palette(grid_renderer, tuning);
+    draw_texture(grid_renderer, grid);
+    break;
+  default:
+    return;
+  }
+
+  // either way one copy, scaled up for TEXTURE
+  SDL_FRect screen = {0, 0, GRID_WIDTH * TILE_SIZE, GRID_HEIGHT * TILE_SIZE};
+  SDL_RenderTexture(renderer, grid_renderer->texture, NULL, &screen);
+  metrics_add(METRIC_DRAW_CALLS, 1);
 }
 
-void render_draw_player(SDL_Renderer *renderer, Player *player) {
+void render_draw_player(SDL_Renderer *renderer, Player *player,
+                        const Tuning *tuning) {
   SDL_FRect player_rect;
 
   // get pixel pos
@@ -72,7 +273,7 @@ void render_draw_player(SDL_Renderer *renderer, Player *player) {
   player_rect.h = TILE_SIZE;
 
   // draw player as white square
-  SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+  set_color(renderer, &tuning->player);
   SDL_RenderFillRect(renderer, &player_rect);
 
   // draw a small colored square inside to show dir
@@ -106,11 +307,13 @@ void render_draw_player(SDL_Renderer *renderer, Player *player) {
   }
 
   // draw dir indicator in cyan
-  SDL_SetRenderDrawColor(renderer, 0, 255, 255, 255);
+  set_color(renderer, &tuning->player_indicator);
   SDL_RenderFillRect(renderer, &dir_indicator);
+  metrics_add(METRIC_DRAW_CALLS, 2);
 }
 
-void render_draw_hud(SDL_Renderer *renderer, Player *player) {
+void render_draw_hud(SDL_Renderer *renderer, Player *player,
+                     const Tuning *tuning) {
   // draw a simple dir counter as colored bars
   // Each 10 pieces of dirt = 1 bar
   int bars = player->dirt_dug / 10;
@@ -120,15 +323,19 @@ void render_draw_hud(SDL_Renderer *renderer, Player *player) {
   bar.h = 10;
   bar.y = 5;
 
+  int drawn = 0;
   for (int i = 0; i < bars && i < 30; i++) {
     bar.x = 5 + (i * 22);
-    SDL_SetRenderDrawColor(renderer, 139, 69, 139, 255); // dirt brown
+    set_color(renderer, &tuning->hud_bar); // dirt brown
     SDL_RenderFillRect(renderer, &bar);
+    drawn++;
   }
+  metrics_add(METRIC_DRAW_CALLS, drawn);
 }
 
 void render_draw_enemies(SDL_Renderer *renderer, Enemy enemies[],
-                         int enemy_count) {
+                         int enemy_count, const Tuning *tuning) {
+  int drawn = 0;
   for (int i = 0; i < enemy_count; i++) {
     Enemy *enemy = &enemies[i];
 
@@ -148,19 +355,17 @@ void render_draw_enemies(SDL_Renderer *renderer, Enemy enemies[],
     if (enemy->type == ENEMY_POOKA) {
       // Enemy Pookas: red
       if (enemy->is_ghosting) {
-        SDL_SetRenderDrawColor(renderer, 100, 0, 0,
-                               180); // semi-transparent red
+        set_color(renderer, &tuning->pooka_ghost); // semi-transparent red
       } else {
-        SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); // bright red
+        set_color(renderer, &tuning->pooka); // bright red
       }
     } else {
       // Enemy Fygar: green
 
       if (enemy->is_ghosting) {
-        SDL_SetRenderDrawColor(renderer, 0, 100, 0,
-                               180); // semi-transparent green
+        set_color(renderer, &tuning->fygar_ghost); // semi-transparent green
       } else {
-        SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255); // bright green
+        set_color(renderer, &tuning->fygar); // bright green
       }
     }
     SDL_RenderFillRect(renderer, &enemy_rect);
@@ -192,7 +397,9 @@ void render_draw_enemies(SDL_Renderer *renderer, Enemy enemies[],
     }
 
     // yellow indicator
-    SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+    set_color(renderer, &tuning->enemy_indicator);
     SDL_RenderFillRect(renderer, &indicator);
+    drawn += 2;
   }
+  metrics_add(METRIC_DRAW_CALLS, drawn);
 }
@@ -1,26 +1,83 @@
 #ifndef RENDER_H
 #define RENDER_H
 
+#include "tuning.h"
 #include "types.h"
 #include <SDL3/SDL.h>
+#include <stdbool.h>
 
 // forward declare player struct (defined in player.h)
 typedef struct Player player;
 typedef struct Enemy enemy;
 
+// colors come from the (hot-reloadable) tuning
+
 // get RGB color for a tile type
-void render_get_tile_color(TileType type, int *r, int *g, int *b);
+void render_get_tile_color(const Tuning *tuning, TileType type, int *r,
+                           int *g, int *b);
 
-// draw whole grid
+// draw whole grid, one rect per tile
 void render_draw_grid(SDL_Renderer *renderer,
-                      TileType grid[GRID_HEIGHT][GRID_WIDTH]);
+                      TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                      const Tuning *tuning);
+
+// other ways of drawing the grid, to compare (--grid-draw):
+// RECTS    render_draw_grid, a fill call per tile
+// BATCHED  the tiles gathered by color, one SDL_RenderFillRects per color
+// TARGET   the rects drawn into a screen-sized target texture, only the
+//          rows that changed, then that texture copied to the screen
+// TEXTURE  one texel per tile in a streaming texture, the changed rows
+//          written through the palette in one lock (one upload), drawn
+//          scaled up by TILE_SIZE with nearest filtering
+typedef enum {
+  GRID_DRAW_RECTS,
+  GRID_DRAW_BATCHED,
+  GRID_DRAW_TARGET,
+  GRID_DRAW_TEXTURE,
+  GRID_DRAW_COUNT
+} GridDrawMode;
+
+// a color per tile type, and magenta for anything else
+#define GRID_COLORS (TILE_ROCK + 2)
+
+typedef struct {
+  GridDrawMode mode;
+  SDL_Texture *texture; // TARGET and TEXTURE
+  bool drawn;           // texture holds last_grid in palette's colors
+  Uint32 palette[GRID_COLORS]; // packed colors texture was drawn with
+  TileType last_grid[GRID_HEIGHT][GRID_WIDTH];
+  SDL_FRect batch[GRID_COLORS][GRID_HEIGHT * GRID_WIDTH]; // BATCHED
+} GridRenderer;
+
+// "rects", "batched", "target" or "texture"; false if unknown
+bool render_parse_grid_mode(const char *name, GridDrawMode *mode);
+const char *render_grid_mode_name(GridDrawMode mode);
+
+// creates the texture the mode needs; false (SDL_GetError) if it can't
+bool render_grid_init(GridRenderer *grid_renderer, SDL_Renderer *renderer,
+                      GridDrawMode mode);
+void render_grid_free(GridRenderer *grid_renderer);
+
+// after SDL_EVENT_RENDER_TARGETS_RESET (target textures lost what was drawn
+// into them) or SDL_EVENT_RENDER_DEVICE_RESET (textures gone altogether,
+// device_lost): every row gets drawn again next frame, into a new texture
+// if the device was lost; false (SDL_GetError) if that can't be made
+bool render_grid_reset(GridRenderer *grid_renderer, SDL_Renderer *renderer,
+                       bool device_lost);
+
+// draw whole grid the grid renderer's way
+void render_grid_draw(GridRenderer *grid_renderer, SDL_Renderer *renderer,
+                      TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                      const Tuning *tuning);
 
 // draw player
-void render_draw_player(SDL_Renderer *renderer, Player *player);
+void render_draw_player(SDL_Renderer *renderer, Player *player,
+                        const Tuning *tuning);
 
-void render_draw_hud(SDL_Renderer *renderer, Player *player);
+void render_draw_hud(SDL_Renderer *renderer, Player *player,
+                     const Tuning *tuning);
 
 void render_draw_enemies(SDL_Renderer *renderer, Enemy enemies[],
-                         int enemy_count);
+                         int enemy_count, const Tuning *tuning);
 
 #endif
@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+#include "replay.h"
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MAGIC "DDRP"
+// bump on any change to the file layout or to what sim_step does with the
+// inputs (rng draws, enemy rules...): an older file would load fine and
+// quietly play a different game. Only the current version loads
+#define REPLAY_VERSION 4
+
+void replay_init(Replay *replay, unsigned int seed, uint64_t tuning_digest) {
+  replay->seed = seed;
+  replay->tuning_digest = tuning_digest;
+  replay->inputs = NULL;
+  replay->tick_count = 0;
+  replay->capacity = 0;
+  replay->checksum = 0;
+}
+
+void replay_record(Replay *replay, int input) {
+  if (replay->tick_count == replay->capacity) {
+    size_t new_capacity = replay->capacity ? replay->capacity * 2 : 4096;
+    unsigned char *grown = realloc(replay->inputs, new_capacity);
+    if (!grown) {
+      return; // out of memory: stop recording, keep what we have
+    }
+    replay->inputs = grown;
+    replay->capacity = new_capacity;
+    metrics_add(METRIC_ALLOCATIONS, 1);
+  }
+  replay->inputs[replay->tick_count++] = (unsigned char)input;
+}
+
+static bool write_u32(FILE *file, unsigned int value) {
+  unsigned char bytes[4] = {value & 0xFF, (value >> 8) & 0xFF,
+                            (value >> 16) & 0xFF, (value >> 24) & 0xFF};
+  return fwrite(bytes, 1, 4, file) == 4;
+}
+
+static bool write_u64(FILE *file, uint64_t value) {
+  return write_u32(file, (unsigned int)value) &&
+         write_u32(file, (unsigned int)(value >> 32));
+}
+
+static bool read_u32(FILE *file, unsigned int *value) {
+  unsigned char bytes[4];
+  if (fread(bytes, 1, 4, file) != 4) {
+    return false;
+  }
+  *value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+           ((unsigned int)bytes[3] << 24);
+  return true;
+}
+
+bool replay_save(const Replay *replay, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    fprintf(stderr, "Cannot write replay %s\n", path);
+    return false;
+  }
+
+  bool ok = fwrite(REPLAY_MAGIC, 1, 4, file) == 4 &&
+            write_u32(file, REPLAY_VERSION) && write_u32(file, replay->seed) &&
+            write_u64(file, replay->tuning_digest) &&
+            write_u32(file, (unsigned int)replay->tick_count) &&
+            fwrite(replay->inputs, 1, replay->tick_count, file) ==
+                replay->tick_count &&
+            write_u64(file, replay->checksum);
+
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "Failed writing replay %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+// everything after opening: reads one replay from file, path is only what
+// the messages call it
+static bool read_replay(Replay *replay, FILE *file, const char *path) {
+  replay_init(replay, 0, 0);
+
+  char magic[4];
+  unsigned int version, seed, tick_count;
+  if (fread(magic, 1, 4, file) != 4 || memcmp(magic, REPLAY_MAGIC, 4) != 0 ||
+      !read_u32(file, &version)) {
+    fprintf(stderr, "%s is not a replay file\n", path);
+    return false;
+  }
+  if (version != REPLAY_VERSION) {
+    fprintf(stderr, "%s is a version %u replay, this build plays version %d "
+                    "(record it again)\n",
+            path, version, REPLAY_VERSION);
+    return false;
+  }
+  unsigned int digest_low, digest_high;
+  if (!read_u32(file, &seed) || !read_u32(file, &digest_low) ||
+      !read_u32(file, &digest_high) || !read_u32(file, &tick_count)) {
+    fprintf(stderr, "%s is not a replay file\n", path);
+    return false;
+  }
+
+  // a tick_count past the end of the file would only get a huge allocation
+  long here = ftell(file);
+  if (here >= 0 && fseek(file, 0, SEEK_END) == 0) {
+    long end = ftell(file);
+    if (fseek(file, here, SEEK_SET) != 0 || end - here < (long)tick_count + 8) {
+      fprintf(stderr, "Replay %s is truncated\n", path);
+      return false;
+    }
+  }
+
+  replay->seed = seed;
+  replay->tuning_digest = digest_low | (uint64_t)digest_high << 32;
+  replay->inputs = malloc(tick_count ? tick_count : 1);
+  metrics_add(METRIC_ALLOCATIONS, 1);
+  if (!replay->inputs ||
+      fread(replay->inputs, 1, tick_count, file) != tick_count) {
+    fprintf(stderr, "Replay %s is truncated\n", path);
+    replay_free(replay);
+    return false;
+  }
+  replay->tick_count = tick_count;
+  replay->capacity = tick_count;
+
+  unsigned int low, high;
+  if (!read_u32(file, &low) || !read_u32(file, &high)) {
+    fprintf(stderr, "Replay %s is truncated\n", path);
+    replay_free(replay);
+    return false;
+  }
+  replay->checksum = low | (uint64_t)high << 32;
+
+  // reject garbage inputs now instead of feeding them to the sim
+  for (size_t i = 0; i < replay->tick_count; i++) {
+    if (replay->inputs[i] > INPUT_NONE) {
+      fprintf(stderr, "Replay %s has a bad input at tick %zu\n", path, i);
+      replay_free(replay);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool replay_load(Replay *replay, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    replay_init(replay, 0, 0);
+    fprintf(stderr, "Cannot open replay %s\n", path);
+    return false;
+  }
+  bool ok = read_replay(replay, file, path);
+  fclose(file);
+  return ok;
+}
+
+bool replay_parse(Replay *replay, const unsigned char *data, size_t size,
+                  const char *name) {
+  // fmemopen may refuse an empty buffer, and that's no replay anyway
+  FILE *file = size ? fmemopen((void *)data, size, "rb") : NULL;
+  if (!file) {
+    replay_init(replay, 0, 0);
+    fprintf(stderr, "%s is not a replay file\n", name);
+    return false;
+  }
+  bool ok = read_replay(replay, file, name);
+  fclose(file);
+  return ok;
+}
+
+void replay_free(Replay *replay) {
+  free(replay->inputs);
+  replay_init(replay, replay->seed, replay->tuning_digest);
+}
@@ -0,0 +1,44 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// a replay is the world seed plus one input byte per tick
+// playing it back through sim_step (with the same tuning, the digest says
+// which) gives the exact same game
+//
+// file layout (little endian):
+//   "DDRP" | u32 version | u32 seed | u64 tuning digest | u32 tick_count
+//   | u8 inputs[tick_count] | u64 checksum
+// the version changes whenever the sim plays the same inputs differently,
+// and only files of the current version load
+// the checksum is sim_zobrist of the world after the last tick, so playing
+// a replay back can tell whether it really ended up in the same game
+typedef struct {
+  unsigned int seed;
+  uint64_t tuning_digest; // tuning_digest of the tuning it was played with
+  unsigned char *inputs;
+  size_t tick_count;
+  size_t capacity;
+  uint64_t checksum; // 0 = none (not set)
+} Replay;
+
+void replay_init(Replay *replay, unsigned int seed, uint64_t tuning_digest);
+
+// append the input used for the next tick
+void replay_record(Replay *replay, int input);
+
+bool replay_save(const Replay *replay, const char *path);
+
+// loads into an uninitialized replay; prints the reason on failure
+bool replay_load(Replay *replay, const char *path);
+
+// the same from a file already in memory (name is what messages call it)
+bool replay_parse(Replay *replay, const unsigned char *data, size_t size,
+                  const char *name);
+
+void replay_free(Replay *replay);
+
+#endif
@@ -0,0 +1,22 @@
+#include "rng.h"
+
+unsigned int rng_seed(unsigned int seed) {
+  // scramble a little so nearby seeds give different sequences
+  seed ^= 0x9E3779B9u;
+  seed *= 0x85EBCA6Bu;
+  seed ^= seed >> 13;
+  return seed ? seed : 0x2545F491u;
+}
+
+unsigned int rng_next(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+int rng_range(unsigned int *state, int n) {
+  return (int)(rng_next(state) % (unsigned int)n);
+}
@@ -0,0 +1,16 @@
+#ifndef RNG_H
+#define RNG_H
+
+// small deterministic random number generator (xorshift32)
+// every world carries its own state, so a run can be replayed from its seed
+
+// make a valid state from any seed (xorshift must never be 0)
+unsigned int rng_seed(unsigned int seed);
+
+// next raw 32-bit value
+unsigned int rng_next(unsigned int *state);
+
+// random int in [0, n)
+int rng_range(unsigned int *state, int n);
+
+#endif
@@ -0,0 +1,289 @@
+#include "scenario.h"
+#include "sim.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// give up on a move after this many ticks without reaching a new tile
+// (walked into a rock, the edge, or tried to dig upwards)
+#define STALL_LIMIT 60
+
+#define MAX_SCRIPT_SIZE 16384
+
+static const struct {
+  const char *name;
+  const char *script;
+} builtins[] = {
+    {"dig-heavy",
+     "# zig-zag through all the dirt, digging nearly every step\n"
+     "right 9, down 1, left 19, down 1, right 19, down 1, left 19,\n"
+     "down 1, right 19, down 1, left 19, down 1, right 19, down 1,\n"
+     "left 19, down 1, right 19, down 1, left 19, down 1, right 19,\n"
+     "down 1, left 19, down 1, right 19\n"},
+    {"tunnel-run",
+     "# dig a rectangle once, then run laps in it (no more digging)\n"
+     "left 5, down 2, up 2, right 9, down 2, left 9,\n"
+     "mark, up 2, right 9, down 2, left 9, loop\n"},
+    {"enemy-swarm",
+     "# fill the world with enemies, then run laps so they chase\n"
+     "spawn pooka 0 14, spawn fygar 19 14, spawn pooka 0 8,\n"
+     "spawn fygar 19 8, spawn pooka 10 14, spawn fygar 5 11,\n"
+     "spawn pooka 15 11, spawn fygar 2 5, spawn pooka 17 5,\n"
+     "left 5, down 2, up 2, right 9, down 2, left 9,\n"
+     "mark, up 2, right 9, down 2, left 9, loop\n"},
+    {"rock-drop",
+     "# dig out the tile under the rock at (10,5), step away and wait\n"
+     "left 1, down 4, right 1, right 3, wait 120\n"},
+};
+
+#define BUILTIN_COUNT ((int)(sizeof builtins / sizeof builtins[0]))
+
+int scenario_builtin_count(void) { return BUILTIN_COUNT; }
+
+const char *scenario_builtin_name(int index) { return builtins[index].name; }
+
+static bool parse_dir(const char *word, int *dir) {
+  static const char *names[] = {"up", "down", "left", "right"};
+  for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+    if (strcmp(word, names[d]) == 0) {
+      *dir = d;
+      return true;
+    }
+  }
+  return false;
+}
+
+// one command, already trimmed; false if it makes no sense
+static bool parse_command(const char *cmd, ScenarioOp *op) {
+  char word[16], arg[16];
+  int n, col, row;
+
+  if (sscanf(cmd, "%15s", word) != 1) {
+    return false;
+  }
+
+  // "dig down 3" and "move down 3" are the same as "down 3"
+  if (strcmp(word, "dig") == 0 || strcmp(word, "move") == 0) {
+    cmd += strlen(word);
+    if (sscanf(cmd, "%15s", word) != 1) {
+      return false;
+    }
+  }
+
+  int dir;
+  if (parse_dir(word, &dir)) {
+    if (sscanf(cmd, "%*s %d", &n) != 1 || n <= 0) {
+      return false;
+    }
+    *op = (ScenarioOp){SCENARIO_MOVE, dir, n, 0};
+  } else if (strcmp(word, "wait") == 0) {
+    if (sscanf(cmd, "%*s %d", &n) != 1 || n < 0) {
+      return false;
+    }
+    *op = (ScenarioOp){SCENARIO_WAIT, n, 0, 0};
+  } else if (strcmp(word, "spawn") == 0) {
+    if (sscanf(cmd, "%*s %15s %d %d", arg, &col, &row) != 3 || col < 0 ||
+        col >= GRID_WIDTH || row < 0 || row >= GRID_HEIGHT) {
+      return false;
+    }
+    EnemyType type;
+    if (strcmp(arg, "pooka") == 0) {
+      type = ENEMY_POOKA;
+    } else if (strcmp(arg, "fygar") == 0) {
+      type = ENEMY_FYGAR;
+    } else {
+      return false;
+    }
+    *op = (ScenarioOp){SCENARIO_SPAWN, type, col, row};
+  } else if (strcmp(word, "mark") == 0) {
+    *op = (ScenarioOp){SCENARIO_MARK, 0, 0, 0};
+  } else if (strcmp(word, "loop") == 0) {
+    *op = (ScenarioOp){SCENARIO_LOOP, 0, 0, 0};
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool scenario_parse(Scenario *scenario, const char *text, char *error,
+                    size_t error_size) {
+  scenario->op_count = 0;
+  int command_number = 0;
+
+  bool in_comment = false;
+  while (*text) {
+    // cut out the next command (up to ',' or end of line)
+    // a '#' hides everything up to the end of its line
+    size_t len = strcspn(text, ",\n");
+    char cmd[128];
+    size_t copy = len < sizeof cmd - 1 ? len : sizeof cmd - 1;
+    memcpy(cmd, text, copy);
+    cmd[copy] = '\0';
+    text += len;
+    bool end_of_line = (*text != ',');
+    if (*text) {
+      text++; // skip the separator
+    }
+
+    if (in_comment) {
+      cmd[0] = '\0';
+    }
+    char *comment = strchr(cmd, '#');
+    if (comment) {
+      *comment = '\0';
+      in_comment = true;
+    }
+    if (end_of_line) {
+      in_comment = false;
+    }
+    char *start = cmd;
+    while (isspace((unsigned char)*start)) {
+      start++;
+    }
+    if (*start == '\0') {
+      continue;
+    }
+    command_number++;
+
+    if (scenario->op_count == MAX_SCENARIO_OPS) {
+      snprintf(error, error_size, "too many commands (max %d)",
+               MAX_SCENARIO_OPS);
+      return false;
+    }
+    if (!parse_command(start, &scenario->ops[scenario->op_count])) {
+      snprintf(error, error_size, "command %d: can't understand '%s'",
+               command_number, start);
+      return false;
+    }
+    scenario->op_count++;
+  }
+  return true;
+}
+
+bool scenario_load(Scenario *scenario, const char *name_or_path) {
+  const char *text = NULL;
+  for (int i = 0; i < BUILTIN_COUNT; i++) {
+    if (strcmp(name_or_path, builtins[i].name) == 0) {
+      text = builtins[i].script;
+    }
+  }
+
+  static char file_text[MAX_SCRIPT_SIZE];
+  if (!text) {
+    FILE *file = fopen(name_or_path, "r");
+    if (!file) {
+      fprintf(stderr, "No scenario called %s (and no such file)\n",
+              name_or_path);
+      return false;
+    }
+    size_t n = fread(file_text, 1, sizeof file_text - 1, file);
+    fclose(file);
+    file_text[n] = '\0';
+    text = file_text;
+  }
+
+  char error[256];
+  if (!scenario_parse(scenario, text, error, sizeof error)) {
+    fprintf(stderr, "Scenario %s: %s\n", name_or_path, error);
+    return false;
+  }
+  return true;
+}
+
+void scenario_start(ScenarioRun *run, const Scenario *scenario) {
+  run->scenario = scenario;
+  run->pc = 0;
+  run->mark = 0;
+  run->remaining = 0;
+  run->stalled = 0;
+  run->last_col = 0;
+  run->last_row = 0;
+  run->started = false;
+}
+
+bool scenario_done(const ScenarioRun *run) {
+  return run->pc >= run->scenario->op_count;
+}
+
+bool scenario_spawns(const Scenario *scenario) {
+  for (int i = 0; i < scenario->op_count; i++) {
+    if (scenario->ops[i].type == SCENARIO_SPAWN) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void next_op(ScenarioRun *run) {
+  run->pc++;
+  run->started = false;
+}
+
+int scenario_next_input(ScenarioRun *run, World *world) {
+  const Player *player = &world->player;
+
+  // instant ops (spawn, mark, loop) run in the same tick as the next
+  // real one; the step limit stops a script like "mark, loop" spinning
+  for (int steps = 0; steps <= run->scenario->op_count; steps++) {
+    if (scenario_done(run)) {
+      return INPUT_NONE;
+    }
+
+    const ScenarioOp *op = &run->scenario->ops[run->pc];
+    switch (op->type) {
+    case SCENARIO_MOVE:
+      if (!run->started) {
+        run->started = true;
+        run->remaining = op->b;
+        run->stalled = 0;
+        run->last_col = player->col;
+        run->last_row = player->row;
+      }
+      if (player->col != run->last_col || player->row != run->last_row) {
+        run->remaining--;
+        run->stalled = 0;
+        run->last_col = player->col;
+        run->last_row = player->row;
+      }
+      if (run->remaining == 0 || run->stalled > STALL_LIMIT) {
+        next_op(run);
+        continue;
+      }
+      run->stalled++;
+      // tap the key only when the player can actually move
+      return player->move_slowdown == 0 ? op->a : INPUT_NONE;
+
+    case SCENARIO_WAIT:
+      if (!run->started) {
+        run->started = true;
+        run->remaining = op->a;
+      }
+      if (run->remaining == 0) {
+        next_op(run);
+        continue;
+      }
+      run->remaining--;
+      return INPUT_NONE;
+
+    case SCENARIO_SPAWN:
+      sim_spawn(world, (EnemyType)op->a, op->b, op->c);
+      next_op(run);
+      continue;
+
+    case SCENARIO_MARK:
+      run->mark = run->pc + 1;
+      next_op(run);
+      continue;
+
+    case SCENARIO_LOOP:
+      run->pc = run->mark;
+      run->started = false;
+      continue;
+    }
+  }
+
+  // the script never produced a tick of input: treat it as finished
+  run->pc = run->scenario->op_count;
+  return INPUT_NONE;
+}
@@ -0,0 +1,76 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Scripted player input for reproducible soak / perf runs.
+//
+// A script is a list of commands separated by commas or new lines
+// ('#' starts a comment):
+//   [dig|move] up|down|left|right N   move N tiles (digging as needed)
+//   wait N                            press nothing for N ticks
+//   spawn pooka|fygar COL ROW         add an enemy
+//   mark                              loop target (default: the start)
+//   loop                              jump back to the last mark
+//
+// The script is turned into one input per tick, fed to sim_step exactly
+// like keyboard input. Note: spawn changes the world directly, so it is
+// not part of a recorded replay's input stream; runs of a scenario that
+// spawns can't be recorded (scenario_spawns).
+
+#define MAX_SCENARIO_OPS 256
+
+typedef enum {
+  SCENARIO_MOVE,  // a = Direction, b = tiles
+  SCENARIO_WAIT,  // a = ticks
+  SCENARIO_SPAWN, // a = EnemyType, b = col, c = row
+  SCENARIO_MARK,
+  SCENARIO_LOOP,
+} ScenarioOpType;
+
+typedef struct {
+  ScenarioOpType type;
+  int a, b, c;
+} ScenarioOp;
+
+typedef struct {
+  ScenarioOp ops[MAX_SCENARIO_OPS];
+  int op_count;
+} Scenario;
+
+// playback state for one scenario
+typedef struct {
+  const Scenario *scenario;
+  int pc;        // current op
+  int mark;      // where loop jumps back to
+  int remaining; // tiles / ticks left in the current op
+  int stalled;   // ticks without progress in a move
+  int last_col;
+  int last_row;
+  bool started;  // current op initialized
+} ScenarioRun;
+
+// compile script text; on error writes a message with the command number
+bool scenario_parse(Scenario *scenario, const char *text, char *error,
+                    size_t error_size);
+
+// load a built-in scenario by name, or else a script file
+bool scenario_load(Scenario *scenario, const char *name_or_path);
+
+// built-in scenarios: dig-heavy, tunnel-run, enemy-swarm, rock-drop
+int scenario_builtin_count(void);
+const char *scenario_builtin_name(int index);
+
+void scenario_start(ScenarioRun *run, const Scenario *scenario);
+
+// input for the next tick (may spawn enemies into the world)
+int scenario_next_input(ScenarioRun *run, World *world);
+
+bool scenario_done(const ScenarioRun *run);
+
+// does the script have spawn commands (replays of it wouldn't play back)
+bool scenario_spawns(const Scenario *scenario);
+
+#endif
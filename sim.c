@@ -0,0 +1,771 @@
+#include "enemy.h"
+#include "eventlog.h"
+#include "grid.h"
+#include "jobs.h"
+#include "metrics.h"
+#include "player.h"
+#include "rng.h"
+#include "sim.h"
+#include "tuning.h"
+#include "types.h"
+#include "zobrist.h"
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(ENEMY_BLOCK == 64, "an enemy block is one word of slot bits");
+
+static void run_spawner(World *world);
+
+static bool in_grid(int col, int row) {
+  return col >= 0 && col < GRID_WIDTH && row >= 0 && row < GRID_HEIGHT;
+}
+
+// scratch worlds (search bots trying moves) stay out of the event log
+static void emit(const World *world, EventType type, int col, int row,
+                 int value) {
+  if (!world->scratch) {
+    eventlog_emit(type, world->tick, col, row, value);
+  }
+}
+
+// the zobrist key from scratch; after that it's patched on every change
+static uint64_t position_key(const World *world) {
+  uint64_t key = 0;
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      key += zobrist_tile(col, row, world->grid[row][col]);
+    }
+  }
+  key += zobrist_player(world->player.col, world->player.row);
+  for (int i = 0; i < world->enemy_count; i++) {
+    const Enemy *enemy = &world->enemies[i];
+    if (enemy->is_alive) {
+      key += zobrist_enemy(enemy->type, enemy->col, enemy->row);
+    }
+  }
+  return key;
+}
+
+bool sim_init(World *world, unsigned int seed, const Tuning *tuning) {
+  world->rng = rng_seed(seed);
+  world->tick = 0;
+  world->tuning = tuning ? tuning : tuning_defaults();
+  tuning = world->tuning;
+
+  grid_init(world->grid);
+  world->kernels = kernels_for(GRID_WIDTH, GRID_HEIGHT);
+  perception_init(&world->perception, world->grid);
+  tunnel_init(&world->tunnels, world->grid);
+  planner_init(&world->planner, world->kernels);
+  escape_init(&world->escape, world->grid, tuning, world->kernels);
+  walkmask_init(&world->walk, world->grid, world->kernels);
+  player_init(&world->player, tuning->player_start_col,
+              tuning->player_start_row);
+
+  // enemy storage is allocated once per level, never during play
+  int blocks = (tuning->max_enemies + ENEMY_BLOCK - 1) / ENEMY_BLOCK;
+  if (blocks == 0) {
+    blocks = 1;
+  }
+  world->enemy_capacity = tuning->max_enemies;
+  world->enemies = aligned_alloc(64, blocks * ENEMY_BLOCK * sizeof(Enemy));
+  world->blocks = aligned_alloc(64, blocks * sizeof(EnemyBlock));
+  world->dead_slots = calloc(blocks, sizeof(uint64_t)); // one bit per slot
+  world->sleeping = calloc(blocks, sizeof(uint64_t));
+  metrics_add(METRIC_ALLOCATIONS, 4);
+  bool wheel_ok = wheel_init(&world->wheel, world->enemy_capacity, 0);
+  world->blind_sleepers = false;
+  world->enemy_count = 0;
+  world->enemies_alive = 0;
+  world->dead_hint = 0;
+  world->parallel = false;
+  world->scratch = false;
+  world->zobrist = position_key(world);
+  occupancy_clear(&world->occupancy);
+  occupancy_set_player(&world->occupancy, world->player.col,
+                       world->player.row);
+  if (!world->enemies || !world->blocks || !world->dead_slots ||
+      !world->sleeping || !wheel_ok) {
+    sim_free(world);
+    return false;
+  }
+  // touch every slot now, so the first big wave doesn't page fault its
+  // way into memory in the middle of a tick
+  memset(world->enemies, 0, blocks * ENEMY_BLOCK * sizeof(Enemy));
+  memset(world->blocks, 0, blocks * sizeof(EnemyBlock));
+
+  // the round's tick 0 waves are there from the start
+  spawner_init(&world->spawner);
+  run_spawner(world);
+  return true;
+}
+
+void sim_free(World *world) {
+  free(world->enemies);
+  free(world->blocks);
+  free(world->dead_slots);
+  free(world->sleeping);
+  wheel_free(&world->wheel);
+  world->enemies = NULL;
+  world->blocks = NULL;
+  world->dead_slots = NULL;
+  world->sleeping = NULL;
+  world->enemy_count = 0;
+  world->enemy_capacity = 0;
+}
+
+void sim_copy(World *dst, const World *src) {
+  Enemy *enemies = dst->enemies;
+  EnemyBlock *blocks = dst->blocks;
+  uint64_t *dead_slots = dst->dead_slots;
+  uint64_t *sleeping = dst->sleeping;
+  Wheel wheel = dst->wheel;
+  int capacity = dst->enemy_capacity;
+
+  *dst = *src;
+  dst->enemies = enemies;
+  dst->blocks = blocks;
+  dst->dead_slots = dead_slots;
+  dst->sleeping = sleeping;
+  dst->wheel = wheel;
+  dst->enemy_capacity = capacity;
+  dst->scratch = true;
+  memcpy(dst->enemies, src->enemies, src->enemy_count * sizeof(Enemy));
+  wheel_copy(&dst->wheel, &src->wheel);
+  // slot bits past src's enemies would be stale, clear them
+  int words = (capacity + 63) / 64;
+  int used = (src->enemy_count + 63) / 64;
+  memcpy(dst->dead_slots, src->dead_slots, used * sizeof(uint64_t));
+  memset(dst->dead_slots + used, 0, (words - used) * sizeof(uint64_t));
+  memcpy(dst->sleeping, src->sleeping, used * sizeof(uint64_t));
+  memset(dst->sleeping + used, 0, (words - used) * sizeof(uint64_t));
+}
+
+// slots of escaped enemies are handed out again, lowest index first
+static int take_dead_slot(World *world) {
+  int words = (world->enemy_count + 63) / 64;
+  for (int w = world->dead_hint; w < words; w++) {
+    uint64_t dead = world->dead_slots[w];
+    if (dead) {
+      world->dead_slots[w] = dead & (dead - 1);
+      world->dead_hint = w;
+      return w * 64 + __builtin_ctzll(dead);
+    }
+  }
+  world->dead_hint = words;
+  return -1;
+}
+
+// ===== cooldowns =====
+// Waiting out a move_slowdown is all a fleeing enemy does until it can
+// move again, and all any enemy does with enemy_perception off. Those
+// go to sleep in the wheel instead of being visited to count down, and
+// wake on the tick they can move.
+
+int sim_enemy_slowdown(const World *world, int index) {
+  if (world->sleeping[index / 64] & (1ull << (index % 64))) {
+    return (int)(world->wheel.wake[index] - world->tick);
+  }
+  return world->enemies[index].move_slowdown;
+}
+
+// enemies that need visiting this tick, a bit per slot of word w
+static uint64_t awake_mask(const World *world, int w) {
+  uint64_t awake = ~(world->sleeping[w] | world->dead_slots[w]);
+  int slots = world->enemy_count - w * 64;
+  return slots >= 64 ? awake : awake & ((1ull << slots) - 1);
+}
+
+// after the merge: an enemy that just moved waits move_slowdown ticks
+static void maybe_sleep(World *world, int index) {
+  const Enemy *enemy = &world->enemies[index];
+  bool fleeing = enemy->state == ENEMY_FLEEING;
+  if (enemy->move_slowdown == 0 ||
+      (!fleeing && world->tuning->enemy_perception)) {
+    return;
+  }
+  world->sleeping[index / 64] |= 1ull << (index % 64);
+  world->blind_sleepers |= !fleeing;
+  // counted down at the end of this tick and the next move_slowdown - 1
+  wheel_add(&world->wheel, index, world->tick + 1 + enemy->move_slowdown);
+}
+
+static void wake_enemy(void *arg, int index) {
+  World *world = arg;
+  world->sleeping[index / 64] &= ~(1ull << (index % 64));
+  world->enemies[index].move_slowdown = 0;
+}
+
+// perception came on (tuning reload) while enemies that should be looking
+// around were asleep: those get visited every tick again
+static void wake_blind_sleepers(World *world) {
+  wheel_clear(&world->wheel, world->tick);
+  for (int i = 0; i < world->enemy_count; i++) {
+    if (!(world->sleeping[i / 64] & (1ull << (i % 64)))) {
+      continue;
+    }
+    Enemy *enemy = &world->enemies[i];
+    unsigned long wake = world->wheel.wake[i];
+    if (enemy->state == ENEMY_FLEEING) {
+      wheel_add(&world->wheel, i, wake);
+    } else {
+      enemy->move_slowdown = (int)(wake - world->tick);
+      world->sleeping[i / 64] &= ~(1ull << (i % 64));
+    }
+  }
+  world->blind_sleepers = false;
+}
+
+static void release_slot(World *world, int index) {
+  world->dead_slots[index / 64] |= 1ull << (index % 64);
+  if (index / 64 < world->dead_hint) {
+    world->dead_hint = index / 64;
+  }
+}
+
+bool sim_spawn(World *world, EnemyType type, int col, int row) {
+  int index = take_dead_slot(world);
+  if (index < 0) {
+    if (world->enemy_count >= world->enemy_capacity) {
+      return false;
+    }
+    index = world->enemy_count++;
+  }
+  // each enemy gets its own random stream, drawn from the world's
+  unsigned int enemy_rng = rng_seed(rng_next(&world->rng));
+  enemy_init(&world->enemies[index], type, col, row, enemy_rng);
+  world->enemies_alive++;
+  occupancy_add_enemy(&world->occupancy, col, row);
+  world->zobrist += zobrist_enemy(type, col, row);
+  emit(world, EVENT_SPAWN, col, row, type);
+  return true;
+}
+
+// spawns whatever the waves have due; enemies that don't fit are dropped
+// (and counted, a wave bigger than max_enemies is a tuning mistake)
+static void run_spawner(World *world) {
+  int count = spawner_due(&world->spawner, world->tuning,
+                          world->enemies_alive);
+  int dropped = 0;
+  for (int i = 0; i < count; i++) {
+    const SpawnPoint *spawn = spawner_next_point(&world->spawner,
+                                                 world->tuning);
+    if (!sim_spawn(world, (EnemyType)spawn->type, spawn->col, spawn->row)) {
+      dropped++;
+    }
+  }
+  if (dropped > 0 && !world->scratch) {
+    metrics_add(METRIC_SPAWNS_DROPPED, dropped);
+  }
+}
+
+void sim_spawn_crowd(World *world, int count, unsigned int seed) {
+  unsigned int rng = rng_seed(seed ^ 0xC0FFEEu);
+  for (int i = 0; i < count; i++) {
+    int col = rng_range(&rng, GRID_WIDTH);
+    int row = 2 + rng_range(&rng, GRID_HEIGHT - 2);
+    if (!sim_spawn(world, (EnemyType)(i % 2), col, row)) {
+      break;
+    }
+  }
+}
+
+typedef struct {
+  World *world;
+  const EnemyContext *ctx;
+} EnemyPhase;
+
+// update the awake enemies of one block and note who moved
+// runs on any thread; only touches its own enemies and its own block
+static void update_enemy_block(void *arg, int block_index) {
+  EnemyPhase *phase = arg;
+  World *world = phase->world;
+  EnemyBlock *block = &world->blocks[block_index];
+  int first = block_index * ENEMY_BLOCK;
+
+  block->move_count = 0;
+  for (uint64_t awake = awake_mask(world, block_index); awake;
+       awake &= awake - 1) {
+    int i = first + __builtin_ctzll(awake);
+    Enemy *enemy = &world->enemies[i];
+    int from_col = enemy->col;
+    int from_row = enemy->row;
+    bool was_alive = enemy->is_alive;
+
+    enemy_update(enemy, phase->ctx);
+
+    if (enemy->col != from_col || enemy->row != from_row ||
+        enemy->is_alive != was_alive) {
+      block->moves[block->move_count++] = (EnemyMove){i, from_col, from_row};
+    }
+  }
+}
+
+// collision check + events for one enemy, always called in enemy order
+static bool check_collision(World *world, int index) {
+  if (!enemy_collides_with_player(&world->enemies[index], &world->player)) {
+    return false;
+  }
+  emit(world, EVENT_COLLISION, world->player.col, world->player.row,
+       index);
+  if (world->player.is_alive) {
+    emit(world, EVENT_DEATH, world->player.col, world->player.row, index);
+  }
+  world->player.is_alive = false;
+  return true;
+}
+
+// everything derived from the grid gets patched here when a tile is dug
+static void on_dig(World *world, int col, int row) {
+  world->zobrist += zobrist_tile(col, row, TILE_TUNNEL) -
+                    zobrist_tile(col, row, TILE_DIRT);
+  perception_dig(&world->perception, col, row);
+  tunnel_dig(&world->tunnels, col, row);
+  planner_dig(&world->planner);
+  escape_dig(&world->escape, col, row);
+  walkmask_set_tile(&world->walk, world->grid, col, row);
+}
+
+void sim_flee(World *world) {
+  for (int i = 0; i < world->enemy_count; i++) {
+    Enemy *enemy = &world->enemies[i];
+    if (enemy->is_alive) {
+      enemy->state = ENEMY_FLEEING;
+    }
+  }
+}
+
+// the last one standing (of more than one) makes a run for it
+static void flee_if_last(World *world) {
+  if (world->enemies_alive != 1 || world->enemy_count < 2) {
+    return;
+  }
+  for (int i = 0; i < world->enemy_count; i++) {
+    Enemy *enemy = &world->enemies[i];
+    if (enemy->is_alive) {
+      enemy->state = ENEMY_FLEEING;
+      return;
+    }
+  }
+}
+
+// the route field is only read by enemies that move this tick and are in
+// the player's tunnel system, so it only needs to reach that far
+static void extend_routes(World *world) {
+  int pc = world->player.col;
+  int pr = world->player.row;
+  int words = (world->enemy_count + 63) / 64;
+  for (int w = 0; w < words; w++) {
+    for (uint64_t awake = awake_mask(world, w); awake; awake &= awake - 1) {
+      const Enemy *enemy = &world->enemies[w * 64 + __builtin_ctzll(awake)];
+      if (enemy->is_alive && enemy->move_slowdown == 0 &&
+          tunnel_connected(&world->tunnels, enemy->col, enemy->row, pc,
+                           pr)) {
+        planner_extend(&world->planner, &world->tunnels, pc, pr, enemy->col,
+                       enemy->row);
+      }
+    }
+  }
+}
+
+bool sim_step(World *world, int input) {
+  bool hit = false;
+
+  // a move into a rock or the edge (or dirt above) can't happen, don't try
+  // (off the grid there's no mask, player_move sorts it out)
+  if (input != INPUT_NONE &&
+      (!in_grid(world->player.col, world->player.row) ||
+       world->walk.player[world->player.row][world->player.col] & 1 << input)) {
+    int dug_before = world->player.dirt_dug;
+    int from_col = world->player.col;
+    int from_row = world->player.row;
+    if (player_move(&world->player, (Direction)input, world->grid,
+                    world->tuning)) {
+      world->zobrist += zobrist_player(world->player.col, world->player.row) -
+                        zobrist_player(from_col, from_row);
+    }
+    if (world->player.dirt_dug != dug_before) {
+      // player_move only digs the tile it moves onto
+      on_dig(world, world->player.col, world->player.row);
+      if (!world->scratch) {
+        metrics_add(METRIC_TILES_DUG, world->player.dirt_dug - dug_before);
+      }
+      emit(world, EVENT_DIG, world->player.col, world->player.row,
+           world->player.dirt_dug);
+    }
+  }
+  player_update(&world->player);
+
+  // ===== enemy update: every enemy sees the same snapshot =====
+  if (world->blind_sleepers && world->tuning->enemy_perception) {
+    wake_blind_sleepers(world);
+  }
+  wheel_advance(&world->wheel, wake_enemy, world);
+  escape_retune(&world->escape, world->grid, world->tuning);
+  if (world->tuning->enemy_flee) {
+    flee_if_last(world);
+  }
+  perception_update(&world->perception, world->player.col,
+                    world->player.row);
+  if (world->tuning->enemy_pathing) {
+    extend_routes(world);
+  }
+  EnemyContext ctx = {world->grid,        world->player,
+                      &world->perception, &world->tunnels,
+                      &world->planner,    &world->escape,
+                      &world->walk,       world->tuning};
+  EnemyPhase phase = {world, &ctx};
+  int blocks = (world->enemy_count + ENEMY_BLOCK - 1) / ENEMY_BLOCK;
+
+  if (world->parallel && blocks > 1) {
+    jobs_parallel_for(blocks, update_enemy_block, &phase);
+  } else {
+    for (int b = 0; b < blocks; b++) {
+      update_enemy_block(&phase, b);
+    }
+  }
+
+  // ===== merge: occupancy first, then collisions in enemy order =====
+  Occupancy *occ = &world->occupancy;
+  for (int b = 0; b < blocks; b++) {
+    const EnemyBlock *block = &world->blocks[b];
+    for (int m = 0; m < block->move_count; m++) {
+      const EnemyMove *move = &block->moves[m];
+      const Enemy *enemy = &world->enemies[move->index];
+      if (!enemy->is_alive) {
+        // only escaping kills an enemy during the update
+        occupancy_remove_enemy(occ, move->from_col, move->from_row);
+        world->zobrist -=
+            zobrist_enemy(enemy->type, move->from_col, move->from_row);
+        world->enemies_alive--;
+        release_slot(world, move->index);
+        emit(world, EVENT_ESCAPE, move->from_col, move->from_row,
+             move->index);
+        continue;
+      }
+      occupancy_move_enemy(occ, move->from_col, move->from_row, enemy->col,
+                           enemy->row);
+      maybe_sleep(world, move->index);
+      world->zobrist +=
+          zobrist_enemy(enemy->type, enemy->col, enemy->row) -
+          zobrist_enemy(enemy->type, move->from_col, move->from_row);
+    }
+  }
+  occupancy_set_player(occ, world->player.col, world->player.row);
+
+  // nobody on the player's tile is by far the common case; otherwise the
+  // first enemy there (in enemy order, so threads never change the
+  // result) gets the hit
+  if (world->player.is_alive && occupancy_enemy_on_player(occ)) {
+    for (int i = 0; i < world->enemy_count && !hit; i++) {
+      hit = check_collision(world, i);
+    }
+  }
+
+  perception_end_tick(&world->perception);
+  world->tick++;
+  // what the waves bring for the next tick
+  spawner_end_tick(&world->spawner);
+  run_spawner(world);
+  if (!world->scratch) {
+    metrics_add(METRIC_TICKS, 1);
+    metrics_set(METRIC_ENEMIES_ALIVE, world->enemies_alive);
+  }
+  return hit;
+}
+
+bool sim_snapshot_init(WorldSnapshot *snapshot, const World *world) {
+  snapshot->enemy_capacity = world->enemy_capacity;
+  snapshot->enemies = malloc(world->enemy_capacity * sizeof(Enemy));
+  if (!snapshot->enemies) {
+    return false;
+  }
+  metrics_add(METRIC_ALLOCATIONS, 1);
+  sim_snapshot_take(snapshot, world);
+  return true;
+}
+
+void sim_snapshot_take(WorldSnapshot *snapshot, const World *world) {
+  memcpy(snapshot->grid, world->grid, sizeof snapshot->grid);
+  snapshot->player = world->player;
+  memcpy(snapshot->enemies, world->enemies,
+         world->enemy_count * sizeof(Enemy));
+  snapshot->enemy_count = world->enemy_count;
+  snapshot->tuning = world->tuning;
+  snapshot->tick = world->tick;
+}
+
+void sim_snapshot_free(WorldSnapshot *snapshot) {
+  free(snapshot->enemies);
+  snapshot->enemies = NULL;
+}
+
+// FNV-1a, fed one field at a time so struct padding never matters
+static uint64_t hash_int(uint64_t h, long long value) {
+  unsigned long long v = (unsigned long long)value;
+  for (int i = 0; i < 8; i++) {
+    h ^= (v >> (i * 8)) & 0xFF;
+    h *= 0x100000001B3ull;
+  }
+  return h;
+}
+
+uint64_t sim_hash(const World *world) {
+  uint64_t h = 0xCBF29CE484222325ull;
+
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      h = hash_int(h, world->grid[row][col]);
+    }
+  }
+
+  const Player *p = &world->player;
+  h = hash_int(h, p->col);
+  h = hash_int(h, p->row);
+  h = hash_int(h, p->facing);
+  h = hash_int(h, p->is_alive);
+  h = hash_int(h, p->dirt_dug);
+  h = hash_int(h, p->move_slowdown);
+
+  for (int i = 0; i < world->enemy_count; i++) {
+    const Enemy *e = &world->enemies[i];
+    h = hash_int(h, e->col);
+    h = hash_int(h, e->row);
+    h = hash_int(h, e->type);
+    h = hash_int(h, e->facing);
+    h = hash_int(h, e->is_alive);
+    h = hash_int(h, sim_enemy_slowdown(world, i));
+    h = hash_int(h, e->is_ghosting);
+    h = hash_int(h, e->state);
+    h = hash_int(h, e->alert);
+    h = hash_int(h, e->target_col);
+    h = hash_int(h, e->target_row);
+    h = hash_int(h, e->rng);
+  }
+
+  const Spawner *s = &world->spawner;
+  h = hash_int(h, s->round);
+  h = hash_int(h, (long long)s->round_tick);
+  h = hash_int(h, s->next_wave);
+  h = hash_int(h, s->next_point);
+  h = hash_int(h, s->pending);
+
+  h = hash_int(h, world->rng);
+  h = hash_int(h, (long long)world->tick);
+  return h;
+}
+
+uint64_t sim_zobrist(const World *world) {
+  return world->zobrist ^ zobrist_rng(world->rng);
+}
+
+// ===== keyframes =====
+
+typedef struct {
+  unsigned char *buf; // NULL = just count
+  size_t size;
+  size_t used;
+} StateWriter;
+
+static void put_u32(StateWriter *w, unsigned int value) {
+  if (w->buf && w->used + 4 <= w->size) {
+    for (int i = 0; i < 4; i++) {
+      w->buf[w->used + i] = (value >> (i * 8)) & 0xFF;
+    }
+  }
+  w->used += 4;
+}
+
+typedef struct {
+  const unsigned char *buf;
+  size_t size;
+  size_t used;
+  bool ok;
+} StateReader;
+
+static unsigned int get_u32(StateReader *r) {
+  if (r->used + 4 > r->size) {
+    r->ok = false;
+    return 0;
+  }
+  const unsigned char *b = r->buf + r->used;
+  r->used += 4;
+  return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+}
+
+static int get_int(StateReader *r) { return (int)get_u32(r); }
+
+size_t sim_save_state(const World *world, unsigned char *buf, size_t size) {
+  StateWriter w = {buf, size, 0};
+  put_u32(&w, (unsigned int)world->tick);
+  put_u32(&w, (unsigned int)((unsigned long long)world->tick >> 32));
+  put_u32(&w, world->rng);
+
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      put_u32(&w, world->grid[row][col]);
+    }
+  }
+
+  const Player *p = &world->player;
+  put_u32(&w, p->col);
+  put_u32(&w, p->row);
+  put_u32(&w, p->facing);
+  put_u32(&w, p->is_alive);
+  put_u32(&w, p->dirt_dug);
+  put_u32(&w, p->move_slowdown);
+
+  const Spawner *s = &world->spawner;
+  put_u32(&w, s->round);
+  put_u32(&w, (unsigned int)s->round_tick);
+  put_u32(&w, s->next_wave);
+  put_u32(&w, s->next_point);
+  put_u32(&w, s->pending);
+
+  put_u32(&w, world->enemy_count);
+  for (int i = 0; i < world->enemy_count; i++) {
+    const Enemy *e = &world->enemies[i];
+    put_u32(&w, e->col);
+    put_u32(&w, e->row);
+    put_u32(&w, e->type);
+    put_u32(&w, e->facing);
+    put_u32(&w, e->is_alive);
+    put_u32(&w, sim_enemy_slowdown(world, i));
+    put_u32(&w, e->is_ghosting);
+    put_u32(&w, e->state);
+    put_u32(&w, e->rng);
+    put_u32(&w, e->alert);
+    put_u32(&w, e->target_col);
+    put_u32(&w, e->target_row);
+  }
+  return w.used;
+}
+
+static bool valid_direction(unsigned int dir) { return dir <= DIR_RIGHT; }
+
+// the player from a state buffer; false if sim_step couldn't have made it
+static bool get_player(StateReader *r, Player *p) {
+  p->col = get_int(r);
+  p->row = get_int(r);
+  unsigned int facing = get_u32(r);
+  p->facing = (Direction)facing;
+  p->is_alive = get_u32(r) != 0;
+  p->dirt_dug = get_int(r);
+  p->move_slowdown = get_int(r);
+  return r->ok && in_grid(p->col, p->row) && valid_direction(facing) &&
+         p->dirt_dug >= 0 && p->move_slowdown >= 0;
+}
+
+static bool get_spawner(StateReader *r, Spawner *s) {
+  s->round = get_int(r);
+  s->round_tick = get_u32(r);
+  s->next_wave = get_int(r);
+  s->next_point = get_int(r);
+  s->pending = get_int(r);
+  return r->ok && s->round >= 1 && s->next_wave >= 0 && s->next_point >= 0 &&
+         s->pending >= 0;
+}
+
+static bool get_enemy(StateReader *r, Enemy *e) {
+  e->col = get_int(r);
+  e->row = get_int(r);
+  unsigned int type = get_u32(r);
+  e->type = (EnemyType)type;
+  unsigned int facing = get_u32(r);
+  e->facing = (Direction)facing;
+  e->is_alive = get_u32(r) != 0;
+  e->move_slowdown = get_int(r);
+  e->is_ghosting = get_u32(r) != 0;
+  unsigned int state = get_u32(r);
+  e->state = (EnemyState)state;
+  e->rng = get_u32(r);
+  e->alert = get_int(r);
+  e->target_col = get_int(r);
+  e->target_row = get_int(r);
+  return r->ok && in_grid(e->col, e->row) && type <= ENEMY_FYGAR &&
+         valid_direction(facing) && e->move_slowdown >= 0 &&
+         state <= ENEMY_ESCAPED && e->alert >= 0 &&
+         in_grid(e->target_col, e->target_row);
+}
+
+bool sim_load_state(World *world, const unsigned char *buf, size_t size) {
+  // decode and check all of it before touching the world, so a rejected
+  // buffer leaves the world as it was
+  StateReader r = {buf, size, 0, true};
+  unsigned long long tick = get_u32(&r);
+  tick |= (unsigned long long)get_u32(&r) << 32;
+  unsigned int rng = get_u32(&r);
+
+  TileType grid[GRID_HEIGHT][GRID_WIDTH];
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      unsigned int tile = get_u32(&r);
+      if (tile > TILE_ROCK) {
+        return false;
+      }
+      grid[row][col] = (TileType)tile;
+    }
+  }
+
+  Player player;
+  Spawner spawner;
+  if (!get_player(&r, &player) || !get_spawner(&r, &spawner)) {
+    return false;
+  }
+
+  int count = get_int(&r);
+  if (!r.ok || count < 0 || count > world->enemy_capacity) {
+    return false;
+  }
+  size_t enemies_at = r.used;
+  for (int i = 0; i < count; i++) {
+    Enemy enemy;
+    if (!get_enemy(&r, &enemy)) {
+      return false;
+    }
+  }
+  if (r.used != size) {
+    return false;
+  }
+
+  // all good: now for real, the enemies decoded again straight into place
+  world->tick = (unsigned long)tick;
+  world->rng = rng;
+  memcpy(world->grid, grid, sizeof grid);
+  world->player = player;
+  world->spawner = spawner;
+  world->enemy_count = count;
+  world->enemies_alive = 0;
+  r.used = enemies_at;
+  for (int i = 0; i < count; i++) {
+    get_enemy(&r, &world->enemies[i]);
+    world->enemies_alive += world->enemies[i].is_alive;
+  }
+  const Player *p = &world->player;
+
+  // everything else is derived from the state above
+  perception_init(&world->perception, world->grid);
+  tunnel_init(&world->tunnels, world->grid);
+  planner_init(&world->planner, world->kernels);
+  escape_init(&world->escape, world->grid, world->tuning, world->kernels);
+  walkmask_init(&world->walk, world->grid, world->kernels);
+  occupancy_clear(&world->occupancy);
+  int words = (world->enemy_capacity + 63) / 64;
+  memset(world->dead_slots, 0, words * sizeof(uint64_t));
+  world->dead_hint = 0;
+  // nobody asleep, they go back to sleep on their next move
+  memset(world->sleeping, 0, words * sizeof(uint64_t));
+  wheel_clear(&world->wheel, world->tick);
+  world->blind_sleepers = false;
+  for (int i = 0; i < count; i++) {
+    const Enemy *e = &world->enemies[i];
+    if (e->is_alive) {
+      occupancy_add_enemy(&world->occupancy, e->col, e->row);
+    } else {
+      release_slot(world, i);
+    }
+  }
+  occupancy_set_player(&world->occupancy, p->col, p->row);
+  world->zobrist = position_key(world);
+  return true;
+}
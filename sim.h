@@ -0,0 +1,144 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "enemy.h"
+#include "escape.h"
+#include "kernels.h"
+#include "occupancy.h"
+#include "perception.h"
+#include "planner.h"
+#include "spawner.h"
+#include "player.h"
+#include "tunnel.h"
+#include "tuning.h"
+#include "types.h"
+#include "walkmask.h"
+#include "wheel.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// input for one tick: a Direction (0..3) or no key pressed
+#define INPUT_NONE 4
+
+// enemies are updated in blocks of this many (a multiple of a cache line,
+// so two threads never write to the same line)
+#define ENEMY_BLOCK 64
+
+// an enemy that changed tile (or escaped) during the enemy update
+typedef struct {
+  int index;
+  int from_col;
+  int from_row;
+} EnemyMove;
+
+// per-block output of the enemy update, merged in block order afterwards
+typedef struct {
+  _Alignas(64) EnemyMove moves[ENEMY_BLOCK];
+  int move_count;
+} EnemyBlock;
+
+// everything the game logic needs, no SDL in here
+// so the same code runs in the window and headless (bench, replays)
+typedef struct {
+  TileType grid[GRID_HEIGHT][GRID_WIDTH];
+  Player player;
+  Enemy *enemies; // enemy_capacity slots, cache line aligned
+  int enemy_count; // slots in use, dead ones included
+  int enemy_capacity;
+  int enemies_alive;
+  uint64_t *dead_slots; // bit per slot free for the next spawn
+  int dead_hint;        // no dead slots in the words before this
+  uint64_t *sleeping;   // bit per slot only counting down its move_slowdown
+  Wheel wheel;          // tick each sleeping enemy can move again
+  bool blind_sleepers;  // non-fleeing ones asleep (enemy_perception off)
+  EnemyBlock *blocks; // one per ENEMY_BLOCK enemies
+  Spawner spawner;    // waves from the tuning
+  Occupancy occupancy; // who stands on which tile, updated on every move
+  Perception perception; // what enemies can see/hear, patched on every dig
+  TunnelIndex tunnels;   // connected tunnel systems, merged on every dig
+  Planner planner;       // tunnel routes to the player
+  EscapeMap escape;      // ticks to the exit, patched on every dig
+  WalkMasks walk;        // walkable neighbours per tile, patched on every dig
+  const GridKernels *kernels; // whole-grid passes for the level's size
+  uint64_t zobrist; // keys of the tiles, player and live enemies (zobrist.h)
+  bool parallel;       // update enemy blocks on the job threads
+  bool scratch;        // a sim_copy: no events or metrics from its ticks
+  unsigned int rng;
+  unsigned long tick;
+  const Tuning *tuning; // may be swapped between ticks (hot reload)
+} World;
+
+// copy of what the renderer needs, so a frame can be drawn from it while
+// the world itself is already running the next ticks
+typedef struct {
+  TileType grid[GRID_HEIGHT][GRID_WIDTH];
+  Player player;
+  Enemy *enemies; // enemy_capacity slots
+  int enemy_count;
+  int enemy_capacity;
+  const Tuning *tuning;
+  unsigned long tick;
+} WorldSnapshot;
+
+// set up the starting level; same seed + tuning = same game
+// tuning NULL = built-in defaults, room for tuning->max_enemies enemies
+// (allocated and touched here, spawning never allocates)
+// returns false if out of memory; free with sim_free
+bool sim_init(World *world, unsigned int seed, const Tuning *tuning);
+
+void sim_free(World *world);
+
+// make dst (from sim_init, room for src's enemies) the same world as src,
+// derived state and all, but quiet (world->scratch); for search bots
+// trying out moves
+void sim_copy(World *dst, const World *src);
+
+// an enemy's move_slowdown as if it counted down every tick: sleeping
+// enemies aren't visited until they can move, their field stands still
+int sim_enemy_slowdown(const World *world, int index);
+
+// add an enemy (into the slot of an escaped one if there is one);
+// false if the world is already full
+bool sim_spawn(World *world, EnemyType type, int col, int row);
+
+// add count pookas and fygars at random spots below the surface
+// (stress runs); positions come from seed, not the world rng
+void sim_spawn_crowd(World *world, int count, unsigned int seed);
+
+// every enemy still alive drops what it's doing and runs for the exit
+// (the last enemy of a level does this on its own, tuning: enemy_flee)
+void sim_flee(World *world);
+
+// advance the world by one tick
+// returns true if an enemy hit the player this tick
+// serial and parallel (world->parallel) give bit-identical results
+bool sim_step(World *world, int input);
+
+// snapshot sized for world; false if out of memory
+bool sim_snapshot_init(WorldSnapshot *snapshot, const World *world);
+
+void sim_snapshot_take(WorldSnapshot *snapshot, const World *world);
+
+void sim_snapshot_free(WorldSnapshot *snapshot);
+
+// hash of the whole world state (FNV-1a), handy to compare two runs
+uint64_t sim_hash(const World *world);
+
+// key of the position: grid, player and enemy tiles and the world rng,
+// kept up to date on every change, so reading it costs nothing
+// (move slowdowns, alerts and enemy rngs are left out; sim_hash has those)
+// for transposition tables and replay checksums
+uint64_t sim_zobrist(const World *world);
+
+// the world state as bytes (keyframes in indexed replays): everything
+// sim_hash covers, written field by field in little endian
+// returns the size needed; only writes if that fits in size
+size_t sim_save_state(const World *world, unsigned char *buf, size_t size);
+
+// put a saved state into a world from sim_init with the same tuning, and
+// rebuild everything derived from it (occupancy, tunnels, routes...)
+// false if the bytes are broken or the enemies don't fit
+bool sim_load_state(World *world, const unsigned char *buf, size_t size);
+
+#endif
@@ -0,0 +1,55 @@
+#include "spawner.h"
+
+void spawner_init(Spawner *spawner) {
+  spawner->round = 1;
+  spawner->round_tick = 0;
+  spawner->next_wave = 0;
+  spawner->next_point = 0;
+  spawner->pending = 0;
+}
+
+int spawner_wave_size(const Wave *wave, int round, const Tuning *tuning) {
+  if (round < wave->first_round) {
+    return 0;
+  }
+  long percent = 100 + (long)tuning->round_growth * (round - 1);
+  long size = wave->count * percent / 100;
+  return size > tuning->max_enemies ? tuning->max_enemies : (int)size;
+}
+
+int spawner_due(Spawner *spawner, const Tuning *tuning, int enemies_alive) {
+  // a reload can shorten the table under us
+  bool waves_done = spawner->next_wave >= tuning->wave_count;
+  if (waves_done && tuning->wave_count > 0 && spawner->pending == 0 &&
+      enemies_alive == 0) {
+    spawner->round++;
+    spawner->round_tick = 0;
+    spawner->next_wave = 0;
+  }
+
+  while (spawner->next_wave < tuning->wave_count &&
+         (unsigned long)tuning->waves[spawner->next_wave].tick <=
+             spawner->round_tick) {
+    const Wave *wave = &tuning->waves[spawner->next_wave++];
+    spawner->pending += spawner_wave_size(wave, spawner->round, tuning);
+  }
+
+  int count = spawner->pending;
+  if (count > tuning->max_spawns_per_tick) {
+    count = tuning->max_spawns_per_tick;
+  }
+  if (tuning->spawn_count == 0) {
+    count = 0; // nowhere to put them
+  }
+  spawner->pending -= count;
+  return count;
+}
+
+const SpawnPoint *spawner_next_point(Spawner *spawner, const Tuning *tuning) {
+  if (spawner->next_point >= tuning->spawn_count) {
+    spawner->next_point = 0;
+  }
+  return &tuning->spawns[spawner->next_point++];
+}
+
+void spawner_end_tick(Spawner *spawner) { spawner->round_tick++; }
@@ -0,0 +1,36 @@
+#ifndef SPAWNER_H
+#define SPAWNER_H
+
+#include "tuning.h"
+#include <stdbool.h>
+
+// Which enemies show up when, from the wave table in the tuning.
+//
+// A round runs the waves in tick order; each one is round_growth percent
+// bigger per round. Enemies come out of the spawn points in turn, at most
+// max_spawns_per_tick a tick so a big wave is spread over a few ticks
+// instead of landing in one. Once all waves are out and nobody is left
+// alive, the next round starts.
+
+typedef struct {
+  int round;                // 1 = first
+  unsigned long round_tick; // ticks since the round started
+  int next_wave;            // index into tuning->waves
+  int next_point;           // index into tuning->spawns
+  int pending;              // due but not out yet
+} Spawner;
+
+void spawner_init(Spawner *spawner);
+
+// enemies to spawn now, take their spots with spawner_next_point
+// call once per tick, enemies_alive before the new ones
+int spawner_due(Spawner *spawner, const Tuning *tuning, int enemies_alive);
+
+const SpawnPoint *spawner_next_point(Spawner *spawner, const Tuning *tuning);
+
+void spawner_end_tick(Spawner *spawner);
+
+// how many enemies a wave brings in a round (0 before its first round)
+int spawner_wave_size(const Wave *wave, int round, const Tuning *tuning);
+
+#endif
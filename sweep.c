@@ -0,0 +1,314 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "autopilot.h"
+#include "colstore.h"
+#include "jobs.h"
+#include "metrics.h"
+#include "sim.h"
+#include "sweep.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+bool sweep_add_axis(Sweep *sweep, const char *spec) {
+  if (sweep->axis_count == MAX_SWEEP_AXES) {
+    fprintf(stderr, "At most %d sweep parameters\n", MAX_SWEEP_AXES);
+    return false;
+  }
+  SweepAxis axis = {"", 0, 0, 1};
+  const char *equals = strchr(spec, '=');
+  size_t key_length = equals ? (size_t)(equals - spec) : 0;
+  int n = 0;
+  if (key_length > 0 && key_length < sizeof axis.key) {
+    memcpy(axis.key, spec, key_length);
+    axis.key[key_length] = '\0';
+    n = sscanf(equals + 1, "%d..%d:%d", &axis.first, &axis.last, &axis.step);
+  }
+  if (n == 1) {
+    axis.last = axis.first;
+  }
+  Tuning check = *sweep->base;
+  if (n < 1 || axis.step < 1 || axis.last < axis.first ||
+      !tuning_set(&check, axis.key, axis.first) ||
+      !tuning_set(&check, axis.key, axis.last)) {
+    fprintf(stderr,
+            "Bad sweep parameter %s (want key=first..last[:step], a "
+            "number from the tuning file)\n",
+            spec);
+    return false;
+  }
+  sweep->axes[sweep->axis_count++] = axis;
+  return true;
+}
+
+typedef struct {
+  Tuning tuning;
+  int values[MAX_SWEEP_AXES];
+  bool stopped; // clearly losing, no more games
+  int games;
+  int caught;
+  double survival_sum;
+  double survival_squares;
+  long long dirt_sum;
+  long long round_sum;
+} Point;
+
+typedef struct {
+  unsigned long survived; // ticks
+  int dirt_dug;
+  int round;
+  bool caught;
+  int caught_by; // EnemyType, -1 if nobody
+  bool ok;
+} GameResult;
+
+typedef struct {
+  const Sweep *sweep;
+  Point *points;
+  int *live; // points getting games this batch
+  unsigned int first_seed;
+  int seeds;
+  GameResult *results; // live point x seed in the batch
+} Batch;
+
+// one headless game on the job threads; nothing shared but the output slot
+static void play_game(void *arg, int index) {
+  Batch *batch = arg;
+  const Point *point = &batch->points[batch->live[index / batch->seeds]];
+  unsigned int seed = batch->first_seed + (unsigned int)(index % batch->seeds);
+  GameResult *result = &batch->results[index];
+
+  World world;
+  result->ok = sim_init(&world, seed, &point->tuning);
+  if (!result->ok) {
+    return;
+  }
+  Autopilot pilot;
+  autopilot_init(&pilot, seed);
+  while (world.tick < batch->sweep->ticks && world.player.is_alive) {
+    sim_step(&world, autopilot_input(&pilot, &world.player));
+  }
+  result->survived = world.tick;
+  result->dirt_dug = world.player.dirt_dug;
+  result->round = world.spawner.round;
+  result->caught = !world.player.is_alive;
+  // first enemy on the player, the one the collision check goes by
+  result->caught_by = -1;
+  for (int i = 0; i < world.enemy_count && result->caught; i++) {
+    const Enemy *enemy = &world.enemies[i];
+    if (enemy->is_alive && enemy->col == world.player.col &&
+        enemy->row == world.player.row) {
+      result->caught_by = enemy->type;
+      break;
+    }
+  }
+  sim_free(&world);
+}
+
+static double mean_survival(const Point *point) {
+  return point->survival_sum / point->games;
+}
+
+// two standard errors of the mean survival
+static double error_bar(const Point *point) {
+  double mean = mean_survival(point);
+  double variance = point->survival_squares / point->games - mean * mean;
+  return 2 * sqrt((variance > 0 ? variance : 0) / point->games);
+}
+
+// stop everything whose best case is worse than the best point's worst
+static int stop_losers(Point *points, int count) {
+  double best = -1;
+  for (int i = 0; i < count; i++) {
+    if (!points[i].stopped) {
+      double low = mean_survival(&points[i]) - error_bar(&points[i]);
+      best = low > best ? low : best;
+    }
+  }
+  int stopped = 0;
+  for (int i = 0; i < count; i++) {
+    Point *point = &points[i];
+    if (!point->stopped && mean_survival(point) + error_bar(point) < best) {
+      point->stopped = true;
+      stopped++;
+    }
+  }
+  return stopped;
+}
+
+static void write_csv(const Sweep *sweep, const Point *points, int count,
+                      FILE *out) {
+  for (int a = 0; a < sweep->axis_count; a++) {
+    fprintf(out, "%s,", sweep->axes[a].key);
+  }
+  fprintf(out, "games,stopped_early,caught_pct,survival_mean,"
+               "survival_stddev,dirt_dug_mean,round_mean\n");
+  for (int i = 0; i < count; i++) {
+    const Point *point = &points[i];
+    for (int a = 0; a < sweep->axis_count; a++) {
+      fprintf(out, "%d,", point->values[a]);
+    }
+    double mean = mean_survival(point);
+    double variance = point->survival_squares / point->games - mean * mean;
+    fprintf(out, "%d,%d,%.1f,%.1f,%.1f,%.1f,%.2f\n", point->games,
+            point->stopped, 100.0 * point->caught / point->games, mean,
+            sqrt(variance > 0 ? variance : 0),
+            (double)point->dirt_sum / point->games,
+            (double)point->round_sum / point->games);
+  }
+}
+
+// the swept values, then one column per thing about the game
+static bool open_episodes(const Sweep *sweep, ColumnWriter *writer,
+                          int *caught_by) {
+  ColumnSpec columns[MAX_SWEEP_AXES + 5];
+  int count = 0;
+  for (int a = 0; a < sweep->axis_count; a++) {
+    columns[count++] = (ColumnSpec){sweep->axes[a].key, COLUMN_INT};
+  }
+  columns[count++] = (ColumnSpec){"seed", COLUMN_INT};
+  columns[count++] = (ColumnSpec){"round", COLUMN_INT};
+  columns[count++] = (ColumnSpec){"ticks_survived", COLUMN_INT};
+  columns[count++] = (ColumnSpec){"dirt_dug", COLUMN_INT};
+  columns[count++] = (ColumnSpec){"caught_by", COLUMN_ENUM};
+  if (!colstore_writer_open(writer, sweep->episodes, columns, count)) {
+    return false;
+  }
+  // codes for nobody and each EnemyType, in that order
+  caught_by[0] = colstore_enum(writer, count - 1, "nobody");
+  caught_by[1 + ENEMY_POOKA] = colstore_enum(writer, count - 1, "pooka");
+  caught_by[1 + ENEMY_FYGAR] = colstore_enum(writer, count - 1, "fygar");
+  return true;
+}
+
+static void add_episode(ColumnWriter *writer, const Sweep *sweep,
+                        const Point *point, unsigned int seed,
+                        const GameResult *result, const int *caught_by) {
+  int row[MAX_SWEEP_AXES + 5];
+  int count = 0;
+  for (int a = 0; a < sweep->axis_count; a++) {
+    row[count++] = point->values[a];
+  }
+  row[count++] = (int)seed;
+  row[count++] = result->round;
+  row[count++] = (int)result->survived;
+  row[count++] = result->dirt_dug;
+  row[count++] = caught_by[1 + result->caught_by];
+  colstore_writer_add(writer, row);
+}
+
+int sweep_run(const Sweep *sweep, FILE *out) {
+  // every combination, first axis changing slowest
+  int count = 1;
+  for (int a = 0; a < sweep->axis_count; a++) {
+    const SweepAxis *axis = &sweep->axes[a];
+    count *= (axis->last - axis->first) / axis->step + 1;
+    if (count > MAX_SWEEP_POINTS) {
+      fprintf(stderr, "More than %d combinations to sweep\n",
+              MAX_SWEEP_POINTS);
+      return 1;
+    }
+  }
+  Point *points = calloc(count, sizeof *points);
+  int *live = malloc(count * sizeof *live);
+  GameResult *results = malloc(count * SWEEP_BATCH * sizeof *results);
+  metrics_add(METRIC_ALLOCATIONS, 3);
+  if (!points || !live || !results) {
+    fprintf(stderr, "Out of memory for %d combinations\n", count);
+    free(points);
+    free(live);
+    free(results);
+    return 1;
+  }
+
+  int status = 0;
+  for (int i = 0; i < count && status == 0; i++) {
+    Point *point = &points[i];
+    point->tuning = *sweep->base;
+    int rest = i;
+    for (int a = sweep->axis_count - 1; a >= 0; a--) {
+      const SweepAxis *axis = &sweep->axes[a];
+      int steps = (axis->last - axis->first) / axis->step + 1;
+      point->values[a] = axis->first + rest % steps * axis->step;
+      rest /= steps;
+      if (!tuning_set(&point->tuning, axis->key, point->values[a])) {
+        fprintf(stderr, "%s = %d is out of range\n", axis->key,
+                point->values[a]);
+        status = 1;
+      }
+    }
+  }
+
+  ColumnWriter episodes = {.file = NULL}; // open if file is set
+  int caught_by[3];
+  if (status == 0 && sweep->episodes &&
+      !open_episodes(sweep, &episodes, caught_by)) {
+    status = 1;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  int stopped = 0;
+  long long games = 0;
+  for (int played = 0; status == 0 && played < sweep->seeds;
+       played += SWEEP_BATCH) {
+    int live_count = 0;
+    for (int i = 0; i < count; i++) {
+      if (!points[i].stopped) {
+        live[live_count++] = i;
+      }
+    }
+    // the last batch may be short of seeds
+    int seeds = sweep->seeds - played < SWEEP_BATCH ? sweep->seeds - played
+                                                    : SWEEP_BATCH;
+    Batch batch = {sweep, points, live, sweep->first_seed + played, seeds,
+                   results};
+    jobs_parallel_for(live_count * seeds, play_game, &batch);
+
+    // add up in a fixed order, so threads never change the numbers
+    for (int l = 0; l < live_count && status == 0; l++) {
+      Point *point = &points[live[l]];
+      for (int s = 0; s < seeds; s++) {
+        const GameResult *result = &results[l * seeds + s];
+        if (!result->ok) {
+          fprintf(stderr, "Out of memory for a game\n");
+          status = 1;
+          break;
+        }
+        point->games++;
+        point->caught += result->caught;
+        point->survival_sum += result->survived;
+        point->survival_squares += (double)result->survived * result->survived;
+        point->dirt_sum += result->dirt_dug;
+        point->round_sum += result->round;
+        games++;
+        if (episodes.file) {
+          add_episode(&episodes, sweep, point, batch.first_seed + s, result,
+                      caught_by);
+        }
+      }
+    }
+    if (sweep->early_stop && played >= SWEEP_BATCH && status == 0) {
+      stopped += stop_losers(points, count);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  if (episodes.file && !colstore_writer_close(&episodes)) {
+    status = 1;
+  }
+
+  if (status == 0) {
+    write_csv(sweep, points, count, out);
+    double seconds =
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr,
+            "sweep: %d combinations, %lld games in %.1f s, %d stopped "
+            "early\n",
+            count, games, seconds, stopped);
+  }
+  free(points);
+  free(live);
+  free(results);
+  return status;
+}
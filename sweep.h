@@ -0,0 +1,50 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "tuning.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+// Parameter sweep for balance tuning: every combination of a few tuning
+// numbers (e.g. player_dig_slowdown 4..12 x enemy_random_chance 10..50),
+// each played headless by the autopilot on a number of seeds, the games
+// spread over the job threads. Writes one CSV row per combination with
+// how long the player survived, how much got dug and how often the player
+// was caught. With an episodes path every game also goes into a column
+// store (colstore.h): the swept values, seed, round, ticks survived, dirt
+// dug and what caught the player.
+//
+// Seeds are played in batches; after the second batch a combination whose
+// survival time is clearly below the best one's (the gap bigger than both
+// their error bars) stops getting games.
+
+#define MAX_SWEEP_AXES 4
+#define MAX_SWEEP_POINTS 4096
+#define SWEEP_BATCH 8 // seeds per combination per round
+
+typedef struct {
+  char key[48]; // tuning file key
+  int first;
+  int last;
+  int step;
+} SweepAxis;
+
+typedef struct {
+  const Tuning *base; // every combination starts from this
+  SweepAxis axes[MAX_SWEEP_AXES];
+  int axis_count;
+  int seeds;              // games per combination, at most
+  unsigned int first_seed;
+  unsigned long ticks;    // a game also ends here if nobody caught the player
+  bool early_stop;
+  const char *episodes; // column store of every game, or NULL
+} Sweep;
+
+// "key=first..last" or "key=first..last:step" (or just "key=value")
+// prints the reason on failure
+bool sweep_add_axis(Sweep *sweep, const char *spec);
+
+// play everything, CSV to out; returns 0, or 1 on bad values / no memory
+int sweep_run(const Sweep *sweep, FILE *out);
+
+#endif
@@ -0,0 +1,353 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+#include "sim.h"
+#include "timeline.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TIMELINE_MAGIC "DDTL"
+// bumped along with REPLAY_VERSION: same inputs, same game, or no load
+#define TIMELINE_VERSION 3
+#define HEADER_SIZE 24
+#define FOOTER_SIZE 20
+#define INDEX_ENTRY_SIZE 16
+
+// ===== writing =====
+
+static bool write_u32(FILE *file, unsigned int value) {
+  unsigned char bytes[4] = {value & 0xFF, (value >> 8) & 0xFF,
+                            (value >> 16) & 0xFF, (value >> 24) & 0xFF};
+  return fwrite(bytes, 1, 4, file) == 4;
+}
+
+static bool write_u64(FILE *file, unsigned long long value) {
+  return write_u32(file, (unsigned int)value) &&
+         write_u32(file, (unsigned int)(value >> 32));
+}
+
+bool timeline_writer_open(TimelineWriter *writer, const char *path,
+                          unsigned int seed, uint64_t tuning_digest,
+                          int block_ticks) {
+  memset(writer, 0, sizeof *writer);
+  writer->path = path;
+  writer->block_ticks = block_ticks > 0 ? block_ticks : TIMELINE_BLOCK_TICKS;
+  writer->input_count = -1;
+  writer->inputs = malloc(writer->block_ticks);
+  metrics_add(METRIC_ALLOCATIONS, 1);
+  writer->file = fopen(path, "wb");
+  if (!writer->file || !writer->inputs) {
+    fprintf(stderr, "Cannot write timeline %s\n", path);
+    if (writer->file) {
+      fclose(writer->file);
+    }
+    free(writer->inputs);
+    return false;
+  }
+
+  writer->failed = !(fwrite(TIMELINE_MAGIC, 1, 4, writer->file) == 4 &&
+                     write_u32(writer->file, TIMELINE_VERSION) &&
+                     write_u32(writer->file, seed) &&
+                     write_u32(writer->file, writer->block_ticks) &&
+                     write_u64(writer->file, tuning_digest));
+  writer->offset = HEADER_SIZE;
+  return true;
+}
+
+static void flush_block(TimelineWriter *writer) {
+  FILE *file = writer->file;
+  bool ok = write_u32(file, (unsigned int)writer->state_size) &&
+            fwrite(writer->state, 1, writer->state_size, file) ==
+                writer->state_size &&
+            write_u32(file, writer->input_count) &&
+            fwrite(writer->inputs, 1, writer->input_count, file) ==
+                (size_t)writer->input_count;
+  if (!ok) {
+    writer->failed = true;
+  }
+  writer->offset += 8 + writer->state_size + writer->input_count;
+}
+
+// keyframe for the block starting now
+static void start_block(TimelineWriter *writer, const World *world) {
+  if (writer->block_count == writer->index_capacity) {
+    size_t capacity = writer->index_capacity ? writer->index_capacity * 2 : 64;
+    unsigned long long *grown =
+        realloc(writer->index, capacity * 2 * sizeof *grown);
+    if (!grown) {
+      writer->failed = true;
+      return;
+    }
+    writer->index = grown;
+    writer->index_capacity = capacity;
+    metrics_add(METRIC_ALLOCATIONS, 1);
+  }
+
+  size_t size = sim_save_state(world, NULL, 0);
+  if (size > writer->state_capacity) {
+    unsigned char *grown = realloc(writer->state, size);
+    if (!grown) {
+      writer->failed = true;
+      return;
+    }
+    writer->state = grown;
+    writer->state_capacity = size;
+    metrics_add(METRIC_ALLOCATIONS, 1);
+  }
+  writer->state_size = sim_save_state(world, writer->state, size);
+
+  writer->index[writer->block_count * 2] = world->tick;
+  writer->index[writer->block_count * 2 + 1] = writer->offset;
+  writer->block_count++;
+  writer->input_count = 0;
+}
+
+void timeline_writer_record(TimelineWriter *writer, const World *world,
+                            int input) {
+  if (writer->failed) {
+    return;
+  }
+  if (writer->input_count == writer->block_ticks) {
+    flush_block(writer);
+    writer->input_count = -1;
+  }
+  if (writer->input_count < 0) {
+    start_block(writer, world);
+    if (writer->failed) {
+      return;
+    }
+  }
+  writer->inputs[writer->input_count++] = (unsigned char)input;
+  writer->tick_count++;
+}
+
+bool timeline_writer_close(TimelineWriter *writer) {
+  FILE *file = writer->file;
+  if (!writer->failed && writer->input_count > 0) {
+    flush_block(writer);
+  }
+
+  unsigned long long index_offset = writer->offset;
+  bool ok = !writer->failed &&
+            write_u32(file, (unsigned int)writer->block_count);
+  for (size_t i = 0; ok && i < writer->block_count; i++) {
+    ok = write_u64(file, writer->index[i * 2]) &&
+         write_u64(file, writer->index[i * 2 + 1]);
+  }
+  ok = ok && write_u64(file, index_offset) &&
+       write_u64(file, writer->tick_count) &&
+       fwrite(TIMELINE_MAGIC, 1, 4, file) == 4;
+
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "Failed writing timeline %s\n", writer->path);
+    ok = false;
+  }
+  free(writer->state);
+  free(writer->inputs);
+  free(writer->index);
+  writer->file = NULL;
+  writer->state = NULL;
+  writer->inputs = NULL;
+  writer->index = NULL;
+  return ok;
+}
+
+// ===== reading =====
+
+static unsigned int read_u32(const unsigned char *b) {
+  return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+}
+
+static unsigned long long read_u64(const unsigned char *b) {
+  return read_u32(b) | (unsigned long long)read_u32(b + 4) << 32;
+}
+
+static unsigned long long entry_tick(const Timeline *timeline, unsigned i) {
+  return read_u64(timeline->index + 4 + (size_t)i * INDEX_ENTRY_SIZE);
+}
+
+static const unsigned char *block_at(const Timeline *timeline, unsigned i) {
+  size_t offset =
+      read_u64(timeline->index + 4 + (size_t)i * INDEX_ENTRY_SIZE + 8);
+  return timeline->map + offset;
+}
+
+// a block's keyframe, and its inputs after it
+static const unsigned char *block_inputs(const unsigned char *block,
+                                         unsigned int *count) {
+  unsigned int state_size = read_u32(block);
+  *count = read_u32(block + 4 + state_size);
+  return block + 8 + state_size;
+}
+
+// every block has to fit in the file, follow on from the previous one and
+// hold only valid inputs, so reads later need no checks
+static bool check_blocks(const Timeline *timeline, size_t index_offset) {
+  unsigned long long tick = timeline->first_tick;
+  size_t next = HEADER_SIZE;
+  for (unsigned i = 0; i < timeline->block_count; i++) {
+    size_t offset = block_at(timeline, i) - timeline->map;
+    if (offset != next || entry_tick(timeline, i) != tick ||
+        offset + 4 > index_offset) {
+      return false;
+    }
+    size_t state_size = read_u32(timeline->map + offset);
+    if (offset + 8 + state_size > index_offset) {
+      return false;
+    }
+    unsigned int count;
+    const unsigned char *inputs =
+        block_inputs(timeline->map + offset, &count);
+    if (count == 0 || count > (unsigned)timeline->block_ticks ||
+        (size_t)(inputs - timeline->map) + count > index_offset ||
+        (count < (unsigned)timeline->block_ticks &&
+         i + 1 < timeline->block_count)) {
+      return false;
+    }
+    for (unsigned t = 0; t < count; t++) {
+      if (inputs[t] > INPUT_NONE) {
+        return false;
+      }
+    }
+    next = (size_t)(inputs - timeline->map) + count;
+    tick += count;
+  }
+  return next == index_offset &&
+         tick - timeline->first_tick == timeline->tick_count;
+}
+
+bool timeline_open(Timeline *timeline, const char *path) {
+  memset(timeline, 0, sizeof *timeline);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open timeline %s\n", path);
+    return false;
+  }
+  struct stat st;
+  // at least this big, so size - FOOTER_SIZE - 4 below can't wrap
+  if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE + 4 + FOOTER_SIZE) {
+    fprintf(stderr, "%s is not a timeline file\n", path);
+    close(fd);
+    return false;
+  }
+  size_t size = (size_t)st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping stays valid
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Cannot map timeline %s\n", path);
+    return false;
+  }
+  timeline->map = map;
+  timeline->map_size = size;
+
+  const unsigned char *m = timeline->map;
+  const unsigned char *footer = m + size - FOOTER_SIZE;
+  unsigned long long index_offset = read_u64(footer);
+  bool ok = memcmp(m, TIMELINE_MAGIC, 4) == 0 &&
+            read_u32(m + 4) == TIMELINE_VERSION &&
+            memcmp(footer + 16, TIMELINE_MAGIC, 4) == 0 &&
+            index_offset >= HEADER_SIZE &&
+            index_offset <= size - FOOTER_SIZE - 4;
+  if (ok) {
+    timeline->seed = read_u32(m + 8);
+    timeline->tuning_digest = read_u64(m + 16);
+    timeline->block_ticks = (int)read_u32(m + 12);
+    timeline->tick_count = read_u64(footer + 8);
+    timeline->index = m + index_offset;
+    timeline->block_count = read_u32(timeline->index);
+    // subtracted on the size side, nothing here can wrap
+    ok = timeline->block_ticks > 0 &&
+         (unsigned long long)timeline->block_count * INDEX_ENTRY_SIZE ==
+             size - FOOTER_SIZE - 4 - index_offset;
+  }
+  if (ok && timeline->block_count > 0) {
+    timeline->first_tick = (unsigned long)entry_tick(timeline, 0);
+  }
+  if (!ok || !check_blocks(timeline, (size_t)index_offset)) {
+    fprintf(stderr, "%s is not a timeline file (or is truncated)\n", path);
+    timeline_close(timeline);
+    return false;
+  }
+  return true;
+}
+
+void timeline_close(Timeline *timeline) {
+  if (timeline->map) {
+    munmap((void *)timeline->map, timeline->map_size);
+  }
+  timeline->map = NULL;
+  timeline->map_size = 0;
+  timeline->block_count = 0;
+}
+
+// last block starting at or before tick (tick must be in the recording)
+static unsigned find_block(const Timeline *timeline, unsigned long tick) {
+  unsigned lo = 0;
+  unsigned hi = timeline->block_count - 1;
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo + 1) / 2;
+    if (entry_tick(timeline, mid) <= tick) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+static bool in_recording(const Timeline *timeline, unsigned long tick) {
+  return timeline->block_count > 0 && tick >= timeline->first_tick &&
+         tick - timeline->first_tick < timeline->tick_count;
+}
+
+int timeline_input(const Timeline *timeline, unsigned long tick) {
+  if (!in_recording(timeline, tick)) {
+    return INPUT_NONE;
+  }
+  unsigned block = find_block(timeline, tick);
+  unsigned int count;
+  const unsigned char *inputs =
+      block_inputs(block_at(timeline, block), &count);
+  return inputs[tick - entry_tick(timeline, block)];
+}
+
+unsigned long timeline_keyframe_tick(const Timeline *timeline, unsigned i) {
+  return (unsigned long)entry_tick(timeline, i);
+}
+
+const unsigned char *timeline_keyframe(const Timeline *timeline, unsigned i,
+                                       size_t *size) {
+  const unsigned char *block = block_at(timeline, i);
+  *size = read_u32(block);
+  return block + 4;
+}
+
+bool timeline_seek(const Timeline *timeline, World *world,
+                   unsigned long tick) {
+  // the tick right after the last input is a valid place to be too
+  if (!in_recording(timeline, tick) &&
+      !(tick > 0 && in_recording(timeline, tick - 1))) {
+    return false;
+  }
+  unsigned block = find_block(timeline, tick);
+  size_t size;
+  const unsigned char *state = timeline_keyframe(timeline, block, &size);
+  if (!sim_load_state(world, state, size) ||
+      world->tick != entry_tick(timeline, block)) {
+    return false;
+  }
+
+  unsigned int count;
+  const unsigned char *inputs =
+      block_inputs(block_at(timeline, block), &count);
+  unsigned long first = world->tick;
+  while (world->tick < tick) {
+    sim_step(world, inputs[world->tick - first]);
+  }
+  return true;
+}
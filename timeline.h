@@ -0,0 +1,89 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Indexed replay for long runs: the inputs, cut into blocks of
+// block_ticks ticks, each block starting with a keyframe (the whole world
+// state, sim_save_state). A reader maps the file and jumps to any tick by
+// loading the keyframe before it and playing at most one block forward,
+// instead of playing the whole game from the start.
+//
+// file layout (little endian):
+//   "DDTL" | u32 version | u32 seed | u32 block_ticks | u64 tuning digest
+//   per block: u32 state_size | state | u32 input_count | u8 inputs[]
+//   index:     u32 block_count | per block: u64 tick | u64 file offset
+//   footer:    u64 index offset | u64 tick_count | "DDTL"
+// The index goes at the end, so a recording is written as it runs.
+//
+// Like a plain replay it only has the tuning's digest: play it back with
+// the tuning it was recorded with. Scenarios that spawn enemies can't be
+// recorded (their spawns aren't inputs).
+
+#define TIMELINE_BLOCK_TICKS 600 // 10 s of game time per keyframe
+
+typedef struct {
+  FILE *file;
+  const char *path;
+  int block_ticks;
+  unsigned long long offset;     // bytes written so far
+  unsigned long long tick_count; // inputs written so far
+  unsigned char *state;          // keyframe of the open block
+  size_t state_size;
+  size_t state_capacity;
+  unsigned char *inputs; // block_ticks bytes
+  int input_count;       // -1 = no block open yet
+  unsigned long long *index; // tick, offset pairs
+  size_t block_count;
+  size_t index_capacity;
+  bool failed;
+} TimelineWriter;
+
+// prints the reason on failure
+bool timeline_writer_open(TimelineWriter *writer, const char *path,
+                          unsigned int seed, uint64_t tuning_digest,
+                          int block_ticks);
+
+// before every sim_step: the world as it is and the input for the tick
+void timeline_writer_record(TimelineWriter *writer, const World *world,
+                            int input);
+
+// writes the last block and the index; false if anything failed
+bool timeline_writer_close(TimelineWriter *writer);
+
+typedef struct {
+  const unsigned char *map; // the whole file, read only
+  size_t map_size;
+  unsigned int seed;
+  uint64_t tuning_digest; // tuning_digest of the tuning it was recorded with
+  int block_ticks;
+  unsigned long first_tick; // tick of the first keyframe
+  unsigned long long tick_count;
+  const unsigned char *index;
+  unsigned int block_count;
+} Timeline;
+
+// maps the file and checks its structure; prints the reason on failure
+bool timeline_open(Timeline *timeline, const char *path);
+
+void timeline_close(Timeline *timeline);
+
+// input recorded for a tick, INPUT_NONE outside the recording
+int timeline_input(const Timeline *timeline, unsigned long tick);
+
+// keyframe of block i (0 <= i < block_count): the world at the start of
+// it, as sim_save_state bytes
+unsigned long timeline_keyframe_tick(const Timeline *timeline, unsigned i);
+const unsigned char *timeline_keyframe(const Timeline *timeline, unsigned i,
+                                       size_t *size);
+
+// put world (from sim_init with the recording's seed and tuning) at tick:
+// binary search for the keyframe at or before it, load that, sim forward
+// false if tick is outside the recording or the keyframe is broken
+bool timeline_seek(const Timeline *timeline, World *world,
+                   unsigned long tick);
+
+#endif
@@ -0,0 +1,423 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "enemy.h"
+#include "grid.h"
+#include "tuning.h"
+#include <ctype.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/inotify.h>
+#endif
+
+static const Tuning defaults = {
+    .player_dig_slowdown = 8,    // slower when digging (8 frames)
+    .player_tunnel_slowdown = 3, // faster in tunnels
+    .enemy_dirt_slowdown = 20,   // slow in dirt
+    .enemy_tunnel_slowdown = 10, // medium speed in tunnels
+    .enemy_random_chance = 30,
+    .enemy_perception = 1,
+    .enemy_hearing_radius = 4,
+    .enemy_alert_ticks = 180,
+    .enemy_pathing = 1,
+    .enemy_flee = 1,
+
+    .max_enemies = MAX_ENEMIES,
+    .player_start_col = 10,
+    .player_start_row = 2,
+    .exit_col = 0, // top-left, like the arcade
+    .exit_row = 0,
+    .spawns = {{ENEMY_POOKA, 19, 5},
+               {ENEMY_POOKA, 5, 10},
+               {ENEMY_FYGAR, 10, 8}},
+    .spawn_count = 3,
+    .waves = {{0, 3, 1}, {1800, 2, 1}, {3600, 4, 2}},
+    .wave_count = 3,
+    .round_growth = 25,
+    .max_spawns_per_tick = 32,
+
+    .tile_colors =
+        {
+            {0, 0, 0, 255},       // TILE_EMPTY: black
+            {139, 69, 19, 255},   // TILE_DIRT: light brown
+            {50, 25, 10, 255},    // TILE_TUNNEL: dark brown
+            {128, 128, 128, 255}, // TILE_ROCK: gray
+        },
+    .player = {255, 255, 255, 255},
+    .player_indicator = {0, 255, 255, 255},
+    .pooka = {255, 0, 0, 255},
+    .pooka_ghost = {100, 0, 0, 180},
+    .fygar = {0, 255, 0, 255},
+    .fygar_ghost = {0, 100, 0, 180},
+    .enemy_indicator = {255, 255, 0, 255},
+    .hud_bar = {139, 69, 139, 255},
+};
+
+const Tuning *tuning_defaults(void) { return &defaults; }
+
+// ===== file parsing =====
+
+typedef enum { FIELD_INT, FIELD_COLOR } FieldKind;
+
+static const struct {
+  const char *key;
+  FieldKind kind;
+  size_t offset;
+} fields[] = {
+    {"player_dig_slowdown", FIELD_INT, offsetof(Tuning, player_dig_slowdown)},
+    {"player_tunnel_slowdown", FIELD_INT,
+     offsetof(Tuning, player_tunnel_slowdown)},
+    {"enemy_dirt_slowdown", FIELD_INT, offsetof(Tuning, enemy_dirt_slowdown)},
+    {"enemy_tunnel_slowdown", FIELD_INT,
+     offsetof(Tuning, enemy_tunnel_slowdown)},
+    {"enemy_random_chance", FIELD_INT, offsetof(Tuning, enemy_random_chance)},
+    {"enemy_perception", FIELD_INT, offsetof(Tuning, enemy_perception)},
+    {"enemy_hearing_radius", FIELD_INT,
+     offsetof(Tuning, enemy_hearing_radius)},
+    {"enemy_alert_ticks", FIELD_INT, offsetof(Tuning, enemy_alert_ticks)},
+    {"enemy_pathing", FIELD_INT, offsetof(Tuning, enemy_pathing)},
+    {"enemy_flee", FIELD_INT, offsetof(Tuning, enemy_flee)},
+    {"max_enemies", FIELD_INT, offsetof(Tuning, max_enemies)},
+    {"player_start_col", FIELD_INT, offsetof(Tuning, player_start_col)},
+    {"player_start_row", FIELD_INT, offsetof(Tuning, player_start_row)},
+    {"round_growth", FIELD_INT, offsetof(Tuning, round_growth)},
+    {"max_spawns_per_tick", FIELD_INT,
+     offsetof(Tuning, max_spawns_per_tick)},
+    {"exit_col", FIELD_INT, offsetof(Tuning, exit_col)},
+    {"exit_row", FIELD_INT, offsetof(Tuning, exit_row)},
+    {"color.empty", FIELD_COLOR, offsetof(Tuning, tile_colors[TILE_EMPTY])},
+    {"color.dirt", FIELD_COLOR, offsetof(Tuning, tile_colors[TILE_DIRT])},
+    {"color.tunnel", FIELD_COLOR, offsetof(Tuning, tile_colors[TILE_TUNNEL])},
+    {"color.rock", FIELD_COLOR, offsetof(Tuning, tile_colors[TILE_ROCK])},
+    {"color.player", FIELD_COLOR, offsetof(Tuning, player)},
+    {"color.player_indicator", FIELD_COLOR,
+     offsetof(Tuning, player_indicator)},
+    {"color.pooka", FIELD_COLOR, offsetof(Tuning, pooka)},
+    {"color.pooka_ghost", FIELD_COLOR, offsetof(Tuning, pooka_ghost)},
+    {"color.fygar", FIELD_COLOR, offsetof(Tuning, fygar)},
+    {"color.fygar_ghost", FIELD_COLOR, offsetof(Tuning, fygar_ghost)},
+    {"color.enemy_indicator", FIELD_COLOR, offsetof(Tuning, enemy_indicator)},
+    {"color.hud_bar", FIELD_COLOR, offsetof(Tuning, hud_bar)},
+};
+
+#define FIELD_COUNT ((int)(sizeof fields / sizeof fields[0]))
+
+static char *trim(char *s) {
+  while (isspace((unsigned char)*s)) {
+    s++;
+  }
+  char *end = s + strlen(s);
+  while (end > s && isspace((unsigned char)end[-1])) {
+    *--end = '\0';
+  }
+  return s;
+}
+
+// the first spawn / wave line in a file replaces the default list
+typedef struct {
+  bool spawns_set;
+  bool waves_set;
+} ListsSet;
+
+// spawn points must be on the level and not inside a rock; the level is
+// built right here, tuning_load can run on several threads at once
+static bool spawn_on_level(int col, int row) {
+  if (col < 0 || col >= GRID_WIDTH || row < 0 || row >= GRID_HEIGHT) {
+    return false;
+  }
+  TileType level[GRID_HEIGHT][GRID_WIDTH];
+  grid_init(level);
+  return level[row][col] != TILE_ROCK;
+}
+
+static bool parse_line(Tuning *t, char *key, char *value, ListsSet *lists) {
+  if (strcmp(key, "wave") == 0) {
+    if (!lists->waves_set) {
+      t->wave_count = 0;
+      lists->waves_set = true;
+    }
+    Wave wave = {0, 0, 1};
+    int n = sscanf(value, "%d %d %d", &wave.tick, &wave.count,
+                   &wave.first_round);
+    if (n < 2 || t->wave_count == MAX_TUNING_WAVES || wave.tick < 0 ||
+        wave.count < 0 || wave.first_round < 1 ||
+        (t->wave_count > 0 && wave.tick < t->waves[t->wave_count - 1].tick)) {
+      return false;
+    }
+    t->waves[t->wave_count++] = wave;
+    return true;
+  }
+  if (strcmp(key, "spawn") == 0) {
+    if (!lists->spawns_set) {
+      t->spawn_count = 0;
+      lists->spawns_set = true;
+    }
+    char type[16];
+    int col, row;
+    if (sscanf(value, "%15s %d %d", type, &col, &row) != 3 ||
+        t->spawn_count == MAX_TUNING_SPAWNS || !spawn_on_level(col, row)) {
+      return false;
+    }
+    SpawnPoint *spawn = &t->spawns[t->spawn_count++];
+    if (strcmp(type, "pooka") == 0) {
+      spawn->type = ENEMY_POOKA;
+    } else if (strcmp(type, "fygar") == 0) {
+      spawn->type = ENEMY_FYGAR;
+    } else {
+      return false;
+    }
+    spawn->col = col;
+    spawn->row = row;
+    return true;
+  }
+
+  for (int i = 0; i < FIELD_COUNT; i++) {
+    if (strcmp(key, fields[i].key) != 0) {
+      continue;
+    }
+    void *field = (char *)t + fields[i].offset;
+    if (fields[i].kind == FIELD_INT) {
+      int v;
+      char extra;
+      if (sscanf(value, "%d %c", &v, &extra) != 1 || v < 0) {
+        return false;
+      }
+      *(int *)field = v;
+    } else {
+      Color c = {0, 0, 0, 255};
+      int n = sscanf(value, "%d %d %d %d", &c.r, &c.g, &c.b, &c.a);
+      if (n < 3) {
+        return false;
+      }
+      *(Color *)field = c;
+    }
+    return true;
+  }
+  return false; // unknown key
+}
+
+// what the parser can't check line by line
+static bool in_range(const Tuning *t) {
+  return t->enemy_random_chance <= 100 && t->enemy_perception <= 1 &&
+         t->enemy_pathing <= 1 && t->enemy_flee <= 1 && t->exit_col >= 0 &&
+         t->exit_col < GRID_WIDTH && t->exit_row >= 0 &&
+         t->exit_row < GRID_HEIGHT && t->player_start_col < GRID_WIDTH &&
+         t->player_start_row < GRID_HEIGHT && t->enemy_alert_ticks >= 1 &&
+         t->max_enemies >= 1 && t->round_growth >= 0 &&
+         t->max_spawns_per_tick >= 1 &&
+         !(t->wave_count > 0 && t->spawn_count == 0);
+}
+
+bool tuning_load(Tuning *tuning, const char *path) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "Cannot open tuning file %s\n", path);
+    return false;
+  }
+
+  // parse into a copy so a broken file never leaves half-applied values
+  Tuning t = defaults;
+  ListsSet lists = {false, false};
+  char line[256];
+  int line_number = 0;
+  bool ok = true;
+
+  while (ok && fgets(line, sizeof line, file)) {
+    line_number++;
+    char *comment = strchr(line, '#');
+    if (comment) {
+      *comment = '\0';
+    }
+    char *text = trim(line);
+    if (*text == '\0') {
+      continue;
+    }
+
+    char *equals = strchr(text, '=');
+    if (!equals) {
+      ok = false;
+    } else {
+      *equals = '\0';
+      ok = parse_line(&t, trim(text), trim(equals + 1), &lists);
+    }
+    if (!ok) {
+      fprintf(stderr, "%s:%d: bad tuning line\n", path, line_number);
+    }
+  }
+  fclose(file);
+
+  if (ok && !in_range(&t)) {
+    fprintf(stderr, "%s: values out of range\n", path);
+    ok = false;
+  }
+  if (ok) {
+    *tuning = t;
+  }
+  return ok;
+}
+
+// FNV-1a over the numbers
+static uint64_t digest_int(uint64_t hash, int value) {
+  for (int i = 0; i < 4; i++) {
+    hash ^= ((unsigned int)value >> (i * 8)) & 0xFF;
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+uint64_t tuning_digest(const Tuning *tuning) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (int i = 0; i < FIELD_COUNT; i++) {
+    if (fields[i].kind == FIELD_INT) {
+      hash = digest_int(hash, *(const int *)((const char *)tuning +
+                                             fields[i].offset));
+    }
+  }
+  hash = digest_int(hash, tuning->spawn_count);
+  for (int i = 0; i < tuning->spawn_count; i++) {
+    const SpawnPoint *spawn = &tuning->spawns[i];
+    hash = digest_int(hash, spawn->type);
+    hash = digest_int(hash, spawn->col);
+    hash = digest_int(hash, spawn->row);
+  }
+  hash = digest_int(hash, tuning->wave_count);
+  for (int i = 0; i < tuning->wave_count; i++) {
+    const Wave *wave = &tuning->waves[i];
+    hash = digest_int(hash, wave->tick);
+    hash = digest_int(hash, wave->count);
+    hash = digest_int(hash, wave->first_round);
+  }
+  return hash;
+}
+
+bool tuning_matches(const Tuning *tuning, uint64_t digest, const char *path) {
+  if (tuning_digest(tuning) == digest) {
+    return true;
+  }
+  fprintf(stderr,
+          "%s was recorded with another tuning, it would play a different "
+          "game (pass the --tuning file it was made with)\n",
+          path);
+  return false;
+}
+
+bool tuning_set(Tuning *tuning, const char *key, int value) {
+  for (int i = 0; i < FIELD_COUNT; i++) {
+    if (fields[i].kind != FIELD_INT || strcmp(key, fields[i].key) != 0) {
+      continue;
+    }
+    Tuning t = *tuning;
+    *(int *)((char *)&t + fields[i].offset) = value;
+    if (value < 0 || !in_range(&t)) {
+      return false;
+    }
+    *tuning = t;
+    return true;
+  }
+  return false;
+}
+
+// ===== hot reload =====
+
+static long long file_mtime(const char *path) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return -1;
+  }
+  return (long long)st.st_mtime;
+}
+
+void tuning_watch_start(TuningWatch *watch, const char *path) {
+  watch->path = path;
+  watch->active = 0;
+  watch->fd = -1;
+  watch->slots[0] = defaults;
+  watch->mtime = file_mtime(path);
+
+  if (watch->mtime >= 0 && tuning_load(&watch->slots[0], path)) {
+    printf("Loaded tuning from %s\n", path);
+  }
+
+#ifdef __linux__
+  // watch the directory, editors often save by writing a new file and
+  // renaming it over the old one
+  char dir[1024];
+  snprintf(dir, sizeof dir, "%s", path);
+  char *slash = strrchr(dir, '/');
+  if (slash) {
+    *slash = '\0';
+  } else {
+    snprintf(dir, sizeof dir, ".");
+  }
+
+  watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (watch->fd >= 0 &&
+      inotify_add_watch(watch->fd, dir,
+                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+    close(watch->fd);
+    watch->fd = -1;
+  }
+#endif
+}
+
+const Tuning *tuning_watch_get(const TuningWatch *watch) {
+  return &watch->slots[watch->active];
+}
+
+static bool file_changed(TuningWatch *watch) {
+#ifdef __linux__
+  if (watch->fd >= 0) {
+    const char *name = strrchr(watch->path, '/');
+    name = name ? name + 1 : watch->path;
+
+    bool changed = false;
+    _Alignas(struct inotify_event) char buf[4096];
+    ssize_t len;
+    while ((len = read(watch->fd, buf, sizeof buf)) > 0) {
+      for (char *p = buf; p < buf + len;) {
+        struct inotify_event *event = (struct inotify_event *)p;
+        if (event->len && strcmp(event->name, name) == 0) {
+          changed = true;
+        }
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    return changed;
+  }
+#endif
+  long long mtime = file_mtime(watch->path);
+  if (mtime == watch->mtime) {
+    return false;
+  }
+  watch->mtime = mtime;
+  return mtime >= 0;
+}
+
+bool tuning_watch_poll(TuningWatch *watch) {
+  if (!file_changed(watch)) {
+    return false;
+  }
+
+  int next = 1 - watch->active;
+  if (!tuning_load(&watch->slots[next], watch->path)) {
+    fprintf(stderr, "Keeping the old tuning\n");
+    return false;
+  }
+  watch->active = next;
+  printf("Reloaded tuning from %s\n", watch->path);
+  return true;
+}
+
+void tuning_watch_stop(TuningWatch *watch) {
+#ifdef __linux__
+  if (watch->fd >= 0) {
+    close(watch->fd);
+    watch->fd = -1;
+  }
+#endif
+}
@@ -0,0 +1,121 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Game feel / balance numbers, loaded from a data file (tuning.cfg) and
+// hot-reloaded while the game runs. The sim only ever sees a const
+// Tuning; a reload swaps in a new one between ticks.
+
+#define MAX_TUNING_SPAWNS 64
+#define MAX_TUNING_WAVES 32
+
+typedef struct {
+  int r, g, b, a;
+} Color;
+
+typedef struct {
+  int type; // EnemyType
+  int col;
+  int row;
+} SpawnPoint;
+
+// count enemies come out of the spawn points (in turn) tick ticks into a
+// round, from round first_round on
+typedef struct {
+  int tick;
+  int count;
+  int first_round;
+} Wave;
+
+typedef struct {
+  // movement slowdowns, in ticks per tile
+  int player_dig_slowdown;
+  int player_tunnel_slowdown;
+  int enemy_dirt_slowdown;
+  int enemy_tunnel_slowdown;
+
+  // percent chance an enemy tries a random direction instead of chasing
+  int enemy_random_chance;
+
+  // perception: 0 = enemies always know where the player is (classic),
+  // 1 = they wander until they see the player or hear digging
+  int enemy_perception;
+  int enemy_hearing_radius; // tiles (manhattan) from a dig
+  int enemy_alert_ticks;    // keep chasing this long after losing track
+
+  // 1 = chasing enemies follow the tunnels when that beats ghosting,
+  // 0 = always head straight for the player (classic)
+  int enemy_pathing;
+
+  // 1 = the last enemy left runs for the exit (classic), 0 = it never does
+  int enemy_flee;
+
+  // level start (only used when a level begins)
+  int max_enemies; // room reserved for enemies in a world
+  int player_start_col;
+  int player_start_row;
+  int exit_col; // where fleeing enemies leave the level
+  int exit_row;
+  SpawnPoint spawns[MAX_TUNING_SPAWNS]; // checked against the level on load
+  int spawn_count;
+  Wave waves[MAX_TUNING_WAVES]; // sorted by tick
+  int wave_count;
+  int round_growth;        // percent more enemies per wave each round
+  int max_spawns_per_tick; // bigger waves trickle in over a few ticks
+
+  // colors
+  Color tile_colors[4]; // indexed by TileType
+  Color player;
+  Color player_indicator;
+  Color pooka;
+  Color pooka_ghost;
+  Color fygar;
+  Color fygar_ghost;
+  Color enemy_indicator;
+  Color hud_bar;
+} Tuning;
+
+// built-in values (same as the shipped tuning.cfg)
+const Tuning *tuning_defaults(void);
+
+// parse a tuning file on top of the defaults
+// on error prints file:line and returns false (tuning is left untouched)
+bool tuning_load(Tuning *tuning, const char *path);
+
+// fingerprint of everything that changes how the sim plays (not the
+// colors), stored in recordings so they are played back with the tuning
+// they were made with
+uint64_t tuning_digest(const Tuning *tuning);
+
+// false (and says so) if the recording at path was made with another
+// tuning than this one
+bool tuning_matches(const Tuning *tuning, uint64_t digest, const char *path);
+
+// set one number by its tuning file key (parameter sweeps)
+// false if there's no such number or the value is out of range
+bool tuning_set(Tuning *tuning, const char *key, int value);
+
+// watches a tuning file (inotify on Linux, mtime elsewhere)
+typedef struct {
+  const char *path;
+  Tuning slots[2]; // double buffer: readers of the old one stay valid
+  int active;
+  int fd;          // inotify fd, -1 if not used
+  long long mtime; // fallback change detection
+} TuningWatch;
+
+// load the file (or defaults if it doesn't exist) and start watching
+void tuning_watch_start(TuningWatch *watch, const char *path);
+
+// current tuning
+const Tuning *tuning_watch_get(const TuningWatch *watch);
+
+// call between ticks; returns true if a new tuning was swapped in
+bool tuning_watch_poll(TuningWatch *watch);
+
+void tuning_watch_stop(TuningWatch *watch);
+
+#endif
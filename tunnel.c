@@ -0,0 +1,119 @@
+#include "tunnel.h"
+
+static bool in_grid(int col, int row) {
+  return col >= 0 && col < GRID_WIDTH && row >= 0 && row < GRID_HEIGHT;
+}
+
+static int tile_index(int col, int row) { return row * GRID_WIDTH + col; }
+
+// path halving: every other node on the way up skips a level
+static int find_root(TunnelIndex *tunnels, int tile) {
+  while (tunnels->parent[tile] != tile) {
+    tunnels->parent[tile] = tunnels->parent[tunnels->parent[tile]];
+    tile = tunnels->parent[tile];
+  }
+  return tile;
+}
+
+// read-only lookup for the queries: union by size keeps every tree at
+// most log2(tiles) deep, so walking up without halving stays short
+static int root_of(const TunnelIndex *tunnels, int tile) {
+  while (tunnels->parent[tile] != tile) {
+    tile = tunnels->parent[tile];
+  }
+  return tile;
+}
+
+// union by size, so trees stay shallow
+static void join(TunnelIndex *tunnels, int a, int b) {
+  a = find_root(tunnels, a);
+  b = find_root(tunnels, b);
+  if (a == b) {
+    return;
+  }
+  if (tunnels->size[a] < tunnels->size[b]) {
+    int swap = a;
+    a = b;
+    b = swap;
+  }
+  tunnels->parent[b] = a;
+  tunnels->size[a] += tunnels->size[b];
+  tunnels->component_count--;
+}
+
+static void open_tile(TunnelIndex *tunnels, int col, int row) {
+  int tile = tile_index(col, row);
+  if (tunnels->parent[tile] >= 0) {
+    return;
+  }
+  tunnels->parent[tile] = tile;
+  tunnels->size[tile] = 1;
+  tunnels->component_count++;
+
+  static const int dc[4] = {0, 0, -1, 1};
+  static const int dr[4] = {-1, 1, 0, 0};
+  for (int d = 0; d < 4; d++) {
+    if (tunnel_is_open(tunnels, col + dc[d], row + dr[d])) {
+      join(tunnels, tile, tile_index(col + dc[d], row + dr[d]));
+    }
+  }
+}
+
+// point every open tile straight at its root (once, after building)
+static void flatten(TunnelIndex *tunnels) {
+  for (int i = 0; i < TUNNEL_TILES; i++) {
+    if (tunnels->parent[i] >= 0) {
+      tunnels->parent[i] = find_root(tunnels, i);
+    }
+  }
+}
+
+void tunnel_init(TunnelIndex *tunnels,
+                 TileType grid[GRID_HEIGHT][GRID_WIDTH]) {
+  for (int i = 0; i < TUNNEL_TILES; i++) {
+    tunnels->parent[i] = -1;
+    tunnels->size[i] = 0;
+  }
+  tunnels->component_count = 0;
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      TileType tile = grid[row][col];
+      if (tile == TILE_TUNNEL || tile == TILE_EMPTY) {
+        open_tile(tunnels, col, row);
+      }
+    }
+  }
+  flatten(tunnels);
+}
+
+void tunnel_dig(TunnelIndex *tunnels, int col, int row) {
+  if (!in_grid(col, row) || tunnel_is_open(tunnels, col, row)) {
+    return;
+  }
+  open_tile(tunnels, col, row);
+}
+
+bool tunnel_is_open(const TunnelIndex *tunnels, int col, int row) {
+  return in_grid(col, row) && tunnels->parent[tile_index(col, row)] >= 0;
+}
+
+bool tunnel_connected(const TunnelIndex *tunnels, int col_a, int row_a,
+                      int col_b, int row_b) {
+  if (!tunnel_is_open(tunnels, col_a, row_a) ||
+      !tunnel_is_open(tunnels, col_b, row_b)) {
+    return false;
+  }
+  return root_of(tunnels, tile_index(col_a, row_a)) ==
+         root_of(tunnels, tile_index(col_b, row_b));
+}
+
+int tunnel_component_size(const TunnelIndex *tunnels, int col, int row) {
+  if (!tunnel_is_open(tunnels, col, row)) {
+    return 0;
+  }
+  return tunnels->size[root_of(tunnels, tile_index(col, row))];
+}
+
+int tunnel_component_count(const TunnelIndex *tunnels) {
+  return tunnels->component_count;
+}
@@ -0,0 +1,41 @@
+#ifndef TUNNEL_H
+#define TUNNEL_H
+
+#include "types.h"
+#include <stdbool.h>
+
+// Which open tiles (tunnel or empty) are connected to each other.
+//
+// A disjoint-set (union-find) over the tiles. Digging only ever opens a
+// tile, which can only merge tunnel systems, never split one, so each dig
+// is a handful of unions (near O(1), path halving inside the dig only).
+// Union by size keeps every tree at most log2(tiles) deep, so the queries
+// below just walk up to the root: they never write, and can be called from
+// any number of threads at once while nothing digs.
+
+#define TUNNEL_TILES (GRID_WIDTH * GRID_HEIGHT)
+
+typedef struct {
+  short parent[TUNNEL_TILES]; // -1 = not open; roots point at themselves
+  short size[TUNNEL_TILES];   // tiles in the system (valid for roots)
+  int component_count;        // number of separate tunnel systems
+} TunnelIndex;
+
+void tunnel_init(TunnelIndex *tunnels,
+                 TileType grid[GRID_HEIGHT][GRID_WIDTH]);
+
+// (col, row) just became tunnel
+void tunnel_dig(TunnelIndex *tunnels, int col, int row);
+
+bool tunnel_is_open(const TunnelIndex *tunnels, int col, int row);
+
+// both tiles open and in the same tunnel system
+bool tunnel_connected(const TunnelIndex *tunnels, int col_a, int row_a,
+                      int col_b, int row_b);
+
+// tiles in the tunnel system containing (col, row), 0 if it isn't open
+int tunnel_component_size(const TunnelIndex *tunnels, int col, int row);
+
+int tunnel_component_count(const TunnelIndex *tunnels);
+
+#endif
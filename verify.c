@@ -0,0 +1,1094 @@
+#include "enemy.h"
+#include "kernels.h"
+#include "player.h"
+#include "rng.h"
+#include "sim.h"
+#include "types.h"
+#include "verify.h"
+#include "wide.h"
+#include "zobrist.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ===== reference rules =====
+// Deliberately naive: no shared helpers with player.c / enemy.c, so a
+// bug introduced while optimizing those files shows up as a mismatch.
+
+static bool ref_in_bounds(int row, int col) {
+  return row >= 0 && row < GRID_HEIGHT && col >= 0 && col < GRID_WIDTH;
+}
+
+static void ref_step_dir(Direction dir, int *col, int *row) {
+  if (dir == DIR_UP)
+    (*row)--;
+  else if (dir == DIR_DOWN)
+    (*row)++;
+  else if (dir == DIR_LEFT)
+    (*col)--;
+  else
+    (*col)++;
+}
+
+static void ref_player_move(World *world, Direction dir) {
+  Player *player = &world->player;
+  if (player->move_slowdown > 0)
+    return;
+
+  int col = player->col;
+  int row = player->row;
+  ref_step_dir(dir, &col, &row);
+  if (!ref_in_bounds(row, col))
+    return;
+
+  TileType tile = world->grid[row][col];
+  if (tile == TILE_DIRT && dir == DIR_UP)
+    return;
+
+  bool dug = false;
+  if (tile == TILE_DIRT) {
+    world->grid[row][col] = TILE_TUNNEL;
+    tile = TILE_TUNNEL;
+    dug = true;
+    player->dirt_dug++;
+  }
+  if (tile != TILE_EMPTY && tile != TILE_TUNNEL)
+    return;
+
+  player->col = col;
+  player->row = row;
+  player->facing = dir;
+  player->move_slowdown = dug ? world->tuning->player_dig_slowdown
+                              : world->tuning->player_tunnel_slowdown;
+}
+
+static bool ref_enemy_try(const World *world, Enemy *enemy, Direction dir) {
+  int col = enemy->col;
+  int row = enemy->row;
+  ref_step_dir(dir, &col, &row);
+  if (!ref_in_bounds(row, col))
+    return false;
+
+  TileType tile = world->grid[row][col];
+  if (tile == TILE_ROCK)
+    return false;
+
+  enemy->col = col;
+  enemy->row = row;
+  enemy->facing = dir;
+  enemy->is_ghosting = (tile == TILE_DIRT);
+  enemy->move_slowdown = (tile == TILE_DIRT)
+                             ? world->tuning->enemy_dirt_slowdown
+                             : world->tuning->enemy_tunnel_slowdown;
+  return true;
+}
+
+static bool ref_open(const World *world, int col, int row) {
+  if (!ref_in_bounds(row, col))
+    return false;
+  TileType tile = world->grid[row][col];
+  return tile == TILE_TUNNEL || tile == TILE_EMPTY;
+}
+
+// straight line to the player with nothing but open tiles in between
+static bool ref_sees(const World *world, const Enemy *enemy) {
+  int col = enemy->col;
+  int row = enemy->row;
+  int pc = world->player.col;
+  int pr = world->player.row;
+  if (!ref_in_bounds(row, col))
+    return false;
+
+  if (row == pr) {
+    int lo = col < pc ? col : pc;
+    int hi = col < pc ? pc : col;
+    for (int c = lo + 1; c < hi; c++) {
+      if (!ref_open(world, c, row))
+        return false;
+    }
+    return true;
+  }
+  if (col == pc) {
+    int lo = row < pr ? row : pr;
+    int hi = row < pr ? pr : row;
+    for (int r = lo + 1; r < hi; r++) {
+      if (!ref_open(world, col, r))
+        return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+// tunnel route to the player: plain BFS from the player every time
+// returns false if there is none or ghosting straight there is quicker
+static bool ref_route(const World *world, const Enemy *enemy, Direction *dir) {
+  int pc = world->player.col;
+  int pr = world->player.row;
+  if (!ref_open(world, enemy->col, enemy->row) || !ref_open(world, pc, pr))
+    return false;
+
+  int dist[GRID_HEIGHT][GRID_WIDTH];
+  for (int row = 0; row < GRID_HEIGHT; row++)
+    for (int col = 0; col < GRID_WIDTH; col++)
+      dist[row][col] = -1;
+
+  int queue_col[GRID_WIDTH * GRID_HEIGHT];
+  int queue_row[GRID_WIDTH * GRID_HEIGHT];
+  int head = 0, tail = 0;
+  dist[pr][pc] = 0;
+  queue_col[tail] = pc;
+  queue_row[tail++] = pr;
+  while (head < tail) {
+    int col = queue_col[head];
+    int row = queue_row[head++];
+    for (Direction d = DIR_UP; d <= DIR_RIGHT; d++) {
+      int nc = col, nr = row;
+      ref_step_dir(d, &nc, &nr);
+      if (ref_open(world, nc, nr) && dist[nr][nc] < 0) {
+        dist[nr][nc] = dist[row][col] + 1;
+        queue_col[tail] = nc;
+        queue_row[tail++] = nr;
+      }
+    }
+  }
+
+  int steps = dist[enemy->row][enemy->col];
+  if (steps <= 0)
+    return false;
+  long tunnel = (long)steps * (world->tuning->enemy_tunnel_slowdown + 1);
+  long ghost = (long)(abs(pc - enemy->col) + abs(pr - enemy->row)) *
+               (world->tuning->enemy_dirt_slowdown + 1);
+  if (ghost < tunnel)
+    return false;
+
+  for (Direction d = DIR_UP; d <= DIR_RIGHT; d++) {
+    int nc = enemy->col, nr = enemy->row;
+    ref_step_dir(d, &nc, &nr);
+    if (ref_in_bounds(nr, nc) && dist[nr][nc] == steps - 1) {
+      *dir = d;
+      return true;
+    }
+  }
+  return false;
+}
+
+// ticks to step onto a tile for an enemy, -1 if it can't
+static int ref_step_cost(const World *world, int col, int row) {
+  if (!ref_in_bounds(row, col) || world->grid[row][col] == TILE_ROCK)
+    return -1;
+  if (world->grid[row][col] == TILE_DIRT)
+    return world->tuning->enemy_dirt_slowdown + 1;
+  return world->tuning->enemy_tunnel_slowdown + 1;
+}
+
+// way out for a fleeing enemy: plain Dijkstra from the exit every time,
+// picking the closest unfinished tile by scanning the whole grid
+static bool ref_escape_route(const World *world, const Enemy *enemy,
+                             Direction *dir) {
+  int dist[GRID_HEIGHT][GRID_WIDTH];
+  bool done[GRID_HEIGHT][GRID_WIDTH];
+  for (int row = 0; row < GRID_HEIGHT; row++)
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      dist[row][col] = -1;
+      done[row][col] = false;
+    }
+  int ec = world->tuning->exit_col;
+  int er = world->tuning->exit_row;
+  if (ref_step_cost(world, ec, er) < 0)
+    return false;
+  dist[er][ec] = 0;
+
+  for (;;) {
+    int best_col = -1, best_row = -1;
+    for (int row = 0; row < GRID_HEIGHT; row++)
+      for (int col = 0; col < GRID_WIDTH; col++)
+        if (!done[row][col] && dist[row][col] >= 0 &&
+            (best_col < 0 || dist[row][col] < dist[best_row][best_col])) {
+          best_col = col;
+          best_row = row;
+        }
+    if (best_col < 0)
+      break;
+    done[best_row][best_col] = true;
+    // a neighbor gets here by stepping onto this tile
+    int via = dist[best_row][best_col] +
+              ref_step_cost(world, best_col, best_row);
+    for (Direction d = DIR_UP; d <= DIR_RIGHT; d++) {
+      int nc = best_col, nr = best_row;
+      ref_step_dir(d, &nc, &nr);
+      if (ref_step_cost(world, nc, nr) > 0 &&
+          (dist[nr][nc] < 0 || via < dist[nr][nc]))
+        dist[nr][nc] = via;
+    }
+  }
+
+  if (!ref_in_bounds(enemy->row, enemy->col))
+    return false;
+  int here = dist[enemy->row][enemy->col];
+  if (here <= 0)
+    return false;
+  for (Direction d = DIR_UP; d <= DIR_RIGHT; d++) {
+    int nc = enemy->col, nr = enemy->row;
+    ref_step_dir(d, &nc, &nr);
+    int cost = ref_step_cost(world, nc, nr);
+    if (cost > 0 && dist[nr][nc] >= 0 && cost + dist[nr][nc] == here) {
+      *dir = d;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void ref_flee(World *world, Enemy *enemy) {
+  const Tuning *tuning = world->tuning;
+  if (enemy->col == tuning->exit_col && enemy->row == tuning->exit_row) {
+    enemy->is_alive = false;
+    enemy->state = ENEMY_ESCAPED;
+    world->enemies_alive--;
+    return;
+  }
+
+  Direction dir;
+  if (!ref_escape_route(world, enemy, &dir)) {
+    int dx = tuning->exit_col - enemy->col;
+    int dy = tuning->exit_row - enemy->row;
+    if (abs(dx) > abs(dy))
+      dir = (dx > 0) ? DIR_RIGHT : DIR_LEFT;
+    else
+      dir = (dy > 0) ? DIR_DOWN : DIR_UP;
+  }
+  ref_enemy_try(world, enemy, dir);
+}
+
+// the tile the player dug this tick, if any
+typedef struct {
+  bool dug;
+  int col;
+  int row;
+} RefNoise;
+
+static void ref_wander(const World *world, Enemy *enemy) {
+  int col = enemy->col;
+  int row = enemy->row;
+  ref_step_dir(enemy->facing, &col, &row);
+  if (rng_range(&enemy->rng, 8) != 0 && ref_open(world, col, row)) {
+    ref_enemy_try(world, enemy, enemy->facing);
+    return;
+  }
+
+  Direction start = rng_range(&enemy->rng, 4);
+  for (int i = 0; i < 4; i++) {
+    Direction dir = (start + i) % 4;
+    col = enemy->col;
+    row = enemy->row;
+    ref_step_dir(dir, &col, &row);
+    if (ref_open(world, col, row)) {
+      ref_enemy_try(world, enemy, dir);
+      return;
+    }
+  }
+  // boxed in by dirt, ghost the first way from start that isn't rock
+  for (int i = 0; i < 4; i++)
+    if (ref_enemy_try(world, enemy, (start + i) % 4))
+      return;
+}
+
+static void ref_enemy_update(World *world, Enemy *enemy,
+                             const RefNoise *noise) {
+  if (!enemy->is_alive)
+    return;
+
+  const Tuning *tuning = world->tuning;
+  if (enemy->state == ENEMY_FLEEING) {
+    if (enemy->move_slowdown > 0)
+      enemy->move_slowdown--;
+    else
+      ref_flee(world, enemy);
+    return;
+  }
+
+  int target_col = world->player.col;
+  int target_row = world->player.row;
+  bool chasing = true;
+  if (tuning->enemy_perception) {
+    bool heard = noise->dug && abs(enemy->col - noise->col) +
+                                       abs(enemy->row - noise->row) <=
+                                   tuning->enemy_hearing_radius;
+    if (ref_sees(world, enemy) || heard) {
+      enemy->alert = tuning->enemy_alert_ticks;
+      enemy->target_col = world->player.col;
+      enemy->target_row = world->player.row;
+    } else if (enemy->alert > 0) {
+      enemy->alert--;
+    }
+    chasing = enemy->alert > 0;
+    target_col = enemy->target_col;
+    target_row = enemy->target_row;
+  }
+  enemy->state = chasing ? ENEMY_CHASING : ENEMY_WANDERING;
+
+  if (enemy->move_slowdown > 0) {
+    enemy->move_slowdown--;
+    return;
+  }
+  if (!chasing) {
+    ref_wander(world, enemy);
+    return;
+  }
+
+  int dx = target_col - enemy->col;
+  int dy = target_row - enemy->row;
+  Direction preferred;
+  if (tuning->enemy_pathing && target_col == world->player.col &&
+      target_row == world->player.row && ref_route(world, enemy, &preferred))
+    ; // tunnel route
+  else if (abs(dx) > abs(dy))
+    preferred = (dx > 0) ? DIR_RIGHT : DIR_LEFT;
+  else
+    preferred = (dy > 0) ? DIR_DOWN : DIR_UP;
+
+  if (rng_range(&enemy->rng, 100) < world->tuning->enemy_random_chance) {
+    if (ref_enemy_try(world, enemy, rng_range(&enemy->rng, 4)))
+      return;
+  }
+  if (ref_enemy_try(world, enemy, preferred))
+    return;
+
+  // any direction except the preferred one that isn't rock or off the grid
+  Direction alts[3];
+  int alt_count = 0;
+  for (Direction d = DIR_UP; d <= DIR_RIGHT; d++) {
+    int col = enemy->col, row = enemy->row;
+    ref_step_dir(d, &col, &row);
+    if (d != preferred && ref_in_bounds(row, col) &&
+        world->grid[row][col] != TILE_ROCK)
+      alts[alt_count++] = d;
+  }
+  if (alt_count > 0)
+    ref_enemy_try(world, enemy, alts[rng_range(&enemy->rng, alt_count)]);
+}
+
+// new enemy into the first dead slot, or on the end if there's room
+static void ref_spawn(World *world, const SpawnPoint *spawn) {
+  int index = 0;
+  while (index < world->enemy_count && world->enemies[index].is_alive)
+    index++;
+  if (index == world->enemy_count) {
+    if (world->enemy_count == world->enemy_capacity)
+      return;
+    world->enemy_count++;
+  }
+  enemy_init(&world->enemies[index], (EnemyType)spawn->type, spawn->col,
+             spawn->row, rng_seed(rng_next(&world->rng)));
+  world->enemies_alive++;
+}
+
+// the wave table for the tick about to start
+static void ref_waves(World *world) {
+  const Tuning *tuning = world->tuning;
+  Spawner *s = &world->spawner;
+  s->round_tick++;
+
+  if (tuning->wave_count > 0 && s->next_wave >= tuning->wave_count &&
+      s->pending == 0 && world->enemies_alive == 0) {
+    s->round++;
+    s->round_tick = 0;
+    s->next_wave = 0;
+  }
+  while (s->next_wave < tuning->wave_count &&
+         (unsigned long)tuning->waves[s->next_wave].tick <= s->round_tick) {
+    const Wave *wave = &tuning->waves[s->next_wave++];
+    if (s->round < wave->first_round)
+      continue;
+    long percent = 100 + (long)tuning->round_growth * (s->round - 1);
+    long size = wave->count * percent / 100;
+    s->pending += size > tuning->max_enemies ? tuning->max_enemies : size;
+  }
+
+  for (int n = 0; n < tuning->max_spawns_per_tick && s->pending > 0 &&
+                  tuning->spawn_count > 0;
+       n++) {
+    s->pending--;
+    if (s->next_point >= tuning->spawn_count)
+      s->next_point = 0;
+    ref_spawn(world, &tuning->spawns[s->next_point++]);
+  }
+}
+
+void verify_ref_step(World *world, int input) {
+  int dug_before = world->player.dirt_dug;
+  if (input != INPUT_NONE)
+    ref_player_move(world, (Direction)input);
+  RefNoise noise = {world->player.dirt_dug != dug_before, world->player.col,
+                    world->player.row};
+
+  if (world->player.move_slowdown > 0)
+    world->player.move_slowdown--;
+
+  int alive = 0;
+  for (int i = 0; i < world->enemy_count; i++)
+    if (world->enemies[i].is_alive)
+      alive++;
+  if (world->tuning->enemy_flee && alive == 1 && world->enemy_count > 1)
+    for (int i = 0; i < world->enemy_count; i++)
+      if (world->enemies[i].is_alive)
+        world->enemies[i].state = ENEMY_FLEEING;
+
+  for (int i = 0; i < world->enemy_count; i++) {
+    Enemy *enemy = &world->enemies[i];
+    ref_enemy_update(world, enemy, &noise);
+    if (enemy->is_alive && world->player.is_alive &&
+        enemy->col == world->player.col && enemy->row == world->player.row)
+      world->player.is_alive = false;
+  }
+
+  world->tick++;
+  ref_waves(world);
+}
+
+// ===== comparison =====
+
+typedef struct {
+  char *buf;
+  size_t size;
+  size_t used;
+  int count;
+} DiffOut;
+
+#define MAX_DIFF_LINES 16
+
+static void diff_line(DiffOut *out, const char *fmt, ...) {
+  out->count++;
+  if (!out->buf || out->count > MAX_DIFF_LINES || out->used >= out->size)
+    return;
+
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(out->buf + out->used, out->size - out->used, fmt, args);
+  va_end(args);
+  if (n > 0)
+    out->used += (size_t)n;
+  if (out->used > out->size)
+    out->used = out->size;
+}
+
+#define CHECK_FIELD(out, label, a, b, field)                                   \
+  do {                                                                         \
+    if ((a)->field != (b)->field)                                              \
+      diff_line(out, "  %s." #field ": %ld vs %ld\n", label,                   \
+                (long)(a)->field, (long)(b)->field);                           \
+  } while (0)
+
+// free slot bits must be exactly the dead enemies
+static void check_pool(DiffOut *out, const World *world) {
+  for (int i = 0; i < world->enemy_count; i++) {
+    bool free_bit = world->dead_slots[i / 64] >> (i % 64) & 1;
+    if (free_bit == world->enemies[i].is_alive)
+      diff_line(out, "  dead_slots bit %d: %d, enemy alive %d\n", i, free_bit,
+                world->enemies[i].is_alive);
+    if (free_bit && i / 64 < world->dead_hint)
+      diff_line(out, "  dead_hint %d skips free slot %d\n", world->dead_hint,
+                i);
+  }
+}
+
+// sleeping enemies are alive, only waiting to move and in the wheel for a
+// tick still to come
+static void check_sleepers(DiffOut *out, const World *world) {
+  int sleeping = 0;
+  for (int i = 0; i < world->enemy_count; i++) {
+    if (!(world->sleeping[i / 64] >> (i % 64) & 1))
+      continue;
+    sleeping++;
+    const Enemy *enemy = &world->enemies[i];
+    if (!enemy->is_alive ||
+        (enemy->state != ENEMY_FLEEING && world->tuning->enemy_perception &&
+         !world->blind_sleepers))
+      diff_line(out, "  enemy[%d] asleep, alive %d, state %d\n", i,
+                enemy->is_alive, enemy->state);
+    if (world->wheel.wake[i] < world->tick)
+      diff_line(out, "  enemy[%d] should have woken at tick %lu\n", i,
+                world->wheel.wake[i]);
+  }
+  if (sleeping != world->wheel.count)
+    diff_line(out, "  %d enemies asleep, %d in the wheel\n", sleeping,
+              world->wheel.count);
+}
+
+// the open-tile masks must match the grid
+static void check_perception(DiffOut *out, const World *world) {
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    unsigned int open = 0;
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      if (ref_open(world, col, row))
+        open |= 1u << col;
+    }
+    if (world->perception.open_rows[row] != open)
+      diff_line(out, "  perception.open_rows[%d]: %08x, grid says %08x\n",
+                row, world->perception.open_rows[row], open);
+  }
+}
+
+// the walkable-neighbour masks must match the grid, for both rule sets
+static void check_walkmasks(DiffOut *out, const World *world) {
+  for (int row = 0; row < GRID_HEIGHT; row++)
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      unsigned int player = 0, enemy = 0;
+      for (Direction d = DIR_UP; d <= DIR_RIGHT; d++) {
+        int nc = col, nr = row;
+        ref_step_dir(d, &nc, &nr);
+        if (!ref_in_bounds(nr, nc) || world->grid[nr][nc] == TILE_ROCK)
+          continue;
+        enemy |= 1u << d;
+        if (!(world->grid[nr][nc] == TILE_DIRT && d == DIR_UP))
+          player |= 1u << d;
+      }
+      if (world->walk.player[row][col] != player ||
+          world->walk.enemy[row][col] != enemy)
+        diff_line(out, "  walk[%d][%d]: player %x enemy %x, grid says %x %x\n",
+                  row, col, world->walk.player[row][col],
+                  world->walk.enemy[row][col], player, enemy);
+    }
+}
+
+// the bitplanes must say exactly what the entities say
+// label the tunnel systems from the grid with a flood fill and hold the
+// union-find up against it
+static void check_tunnels(DiffOut *out, const World *world) {
+  static int label[GRID_HEIGHT][GRID_WIDTH];
+  static int stack[GRID_WIDTH * GRID_HEIGHT];
+  int first_col[GRID_WIDTH * GRID_HEIGHT];
+  int first_row[GRID_WIDTH * GRID_HEIGHT];
+  int labels = 0;
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      label[row][col] = -1;
+      if (tunnel_is_open(&world->tunnels, col, row) !=
+          ref_open(world, col, row))
+        diff_line(out, "  tunnels: (%d,%d) open %d, grid says %d\n", col,
+                  row, tunnel_is_open(&world->tunnels, col, row),
+                  ref_open(world, col, row));
+    }
+  }
+
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      if (!ref_open(world, col, row) || label[row][col] >= 0)
+        continue;
+      int size = 0;
+      int top = 0;
+      label[row][col] = labels;
+      stack[top++] = row * GRID_WIDTH + col;
+      while (top > 0) {
+        int tile = stack[--top];
+        int tc = tile % GRID_WIDTH;
+        int tr = tile / GRID_WIDTH;
+        size++;
+        if (!tunnel_connected(&world->tunnels, col, row, tc, tr))
+          diff_line(out, "  tunnels: (%d,%d) not connected to (%d,%d)\n", tc,
+                    tr, col, row);
+        for (int dir = DIR_UP; dir <= DIR_RIGHT; dir++) {
+          int nc = tc;
+          int nr = tr;
+          ref_step_dir((Direction)dir, &nc, &nr);
+          if (ref_in_bounds(nr, nc) && ref_open(world, nc, nr) &&
+              label[nr][nc] < 0) {
+            label[nr][nc] = labels;
+            stack[top++] = nr * GRID_WIDTH + nc;
+          }
+        }
+      }
+      if (tunnel_component_size(&world->tunnels, col, row) != size)
+        diff_line(out, "  tunnels: system at (%d,%d) size %d, grid says %d\n",
+                  col, row, tunnel_component_size(&world->tunnels, col, row),
+                  size);
+      first_col[labels] = col;
+      first_row[labels] = row;
+      labels++;
+    }
+  }
+
+  if (tunnel_component_count(&world->tunnels) != labels)
+    diff_line(out, "  tunnels: %d systems, grid says %d\n",
+              tunnel_component_count(&world->tunnels), labels);
+  for (int i = 0; i < labels; i++) {
+    for (int j = i + 1; j < labels; j++) {
+      if (tunnel_connected(&world->tunnels, first_col[i], first_row[i],
+                           first_col[j], first_row[j]))
+        diff_line(out, "  tunnels: (%d,%d) and (%d,%d) joined, grid says "
+                       "apart\n",
+                  first_col[i], first_row[i], first_col[j], first_row[j]);
+    }
+  }
+}
+
+static void check_occupancy(DiffOut *out, const World *world) {
+  Occupancy expected;
+  occupancy_clear(&expected);
+  occupancy_set_player(&expected, world->player.col, world->player.row);
+  for (int i = 0; i < world->enemy_count; i++) {
+    const Enemy *enemy = &world->enemies[i];
+    if (enemy->is_alive)
+      occupancy_add_enemy(&expected, enemy->col, enemy->row);
+  }
+
+  const Occupancy *occ = &world->occupancy;
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    if (occ->enemy_rows[row] != expected.enemy_rows[row])
+      diff_line(out, "  occupancy.enemy_rows[%d]: %08x, entities say %08x\n",
+                row, occ->enemy_rows[row], expected.enemy_rows[row]);
+    if (occ->player_rows[row] != expected.player_rows[row])
+      diff_line(out, "  occupancy.player_rows[%d]: %08x, entities say %08x\n",
+                row, occ->player_rows[row], expected.player_rows[row]);
+  }
+  for (int col = 0; col < GRID_WIDTH; col++) {
+    if (occ->enemy_cols[col] != expected.enemy_cols[col])
+      diff_line(out, "  occupancy.enemy_cols[%d]: %08x, entities say %08x\n",
+                col, occ->enemy_cols[col], expected.enemy_cols[col]);
+  }
+}
+
+// the incrementally kept key must be what summing all the keys gives
+static void check_zobrist(DiffOut *out, const World *world) {
+  uint64_t key = 0;
+  for (int row = 0; row < GRID_HEIGHT; row++)
+    for (int col = 0; col < GRID_WIDTH; col++)
+      key += zobrist_tile(col, row, world->grid[row][col]);
+  key += zobrist_player(world->player.col, world->player.row);
+  for (int i = 0; i < world->enemy_count; i++) {
+    const Enemy *enemy = &world->enemies[i];
+    if (enemy->is_alive)
+      key += zobrist_enemy(enemy->type, enemy->col, enemy->row);
+  }
+  if (world->zobrist != key)
+    diff_line(out, "  zobrist: %016llx, entities say %016llx\n",
+              (unsigned long long)world->zobrist, (unsigned long long)key);
+}
+
+bool verify_compare(const World *a, const World *b, char *diff,
+                    size_t diff_size) {
+  DiffOut out = {diff, diff_size, 0, 0};
+  if (diff && diff_size > 0)
+    diff[0] = '\0';
+
+  CHECK_FIELD(&out, "world", a, b, tick);
+  CHECK_FIELD(&out, "world", a, b, rng);
+
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      if (a->grid[row][col] != b->grid[row][col])
+        diff_line(&out, "  grid[%d][%d]: %d vs %d\n", row, col,
+                  a->grid[row][col], b->grid[row][col]);
+    }
+  }
+
+  CHECK_FIELD(&out, "player", &a->player, &b->player, col);
+  CHECK_FIELD(&out, "player", &a->player, &b->player, row);
+  CHECK_FIELD(&out, "player", &a->player, &b->player, facing);
+  CHECK_FIELD(&out, "player", &a->player, &b->player, is_alive);
+  CHECK_FIELD(&out, "player", &a->player, &b->player, dirt_dug);
+  CHECK_FIELD(&out, "player", &a->player, &b->player, move_slowdown);
+
+  CHECK_FIELD(&out, "world", a, b, enemy_count);
+  CHECK_FIELD(&out, "world", a, b, enemies_alive);
+  CHECK_FIELD(&out, "spawner", &a->spawner, &b->spawner, round);
+  CHECK_FIELD(&out, "spawner", &a->spawner, &b->spawner, round_tick);
+  CHECK_FIELD(&out, "spawner", &a->spawner, &b->spawner, next_wave);
+  CHECK_FIELD(&out, "spawner", &a->spawner, &b->spawner, next_point);
+  CHECK_FIELD(&out, "spawner", &a->spawner, &b->spawner, pending);
+  int count = a->enemy_count < b->enemy_count ? a->enemy_count : b->enemy_count;
+  for (int i = 0; i < count; i++) {
+    char label[32];
+    snprintf(label, sizeof label, "enemy[%d]", i);
+    const Enemy *ea = &a->enemies[i];
+    const Enemy *eb = &b->enemies[i];
+    CHECK_FIELD(&out, label, ea, eb, col);
+    CHECK_FIELD(&out, label, ea, eb, row);
+    CHECK_FIELD(&out, label, ea, eb, type);
+    CHECK_FIELD(&out, label, ea, eb, facing);
+    CHECK_FIELD(&out, label, ea, eb, is_alive);
+    // sleeping enemies' fields stand still, compare what they stand for
+    int slowdown_a = sim_enemy_slowdown(a, i);
+    int slowdown_b = sim_enemy_slowdown(b, i);
+    if (slowdown_a != slowdown_b)
+      diff_line(&out, "  %s.move_slowdown: %d vs %d\n", label, slowdown_a,
+                slowdown_b);
+    CHECK_FIELD(&out, label, ea, eb, is_ghosting);
+    CHECK_FIELD(&out, label, ea, eb, state);
+    CHECK_FIELD(&out, label, ea, eb, rng);
+    CHECK_FIELD(&out, label, ea, eb, alert);
+    CHECK_FIELD(&out, label, ea, eb, target_col);
+    CHECK_FIELD(&out, label, ea, eb, target_row);
+  }
+
+  check_occupancy(&out, a);
+  check_zobrist(&out, a);
+  check_pool(&out, a);
+  check_sleepers(&out, a);
+  check_perception(&out, a);
+  check_walkmasks(&out, a);
+  check_tunnels(&out, a);
+
+  if (out.count > MAX_DIFF_LINES)
+    diff_line(&out, "  ... %d more\n", out.count - MAX_DIFF_LINES);
+
+  return out.count == 0;
+}
+
+// ===== lockstep runs =====
+
+// the last quarter of every run has all enemies fleeing
+#define FLEE_TICK(tick_count) ((tick_count) - (tick_count) / 4)
+// and the second one has enemy_perception off (swapped in like a tuning
+// reload), so every enemy sleeps through its cooldowns there
+#define BLIND_TICK(tick_count) ((tick_count) / 4)
+#define SIGHT_TICK(tick_count) ((tick_count) / 2)
+
+// the tuning for tick t of the run: blind is tuning with perception off
+static const Tuning *tuning_at(size_t t, size_t tick_count,
+                               const Tuning *tuning, const Tuning *blind) {
+  return t >= BLIND_TICK(tick_count) && t < SIGHT_TICK(tick_count) ? blind
+                                                                    : tuning;
+}
+
+long verify_lockstep(unsigned int seed, const Tuning *tuning,
+                     const unsigned char *inputs, size_t tick_count,
+                     char *diff, size_t diff_size) {
+  World fast_world, ref_world;
+  World *fast = &fast_world;
+  World *ref = &ref_world;
+  if (!sim_init(fast, seed, tuning)) {
+    return VERIFY_ERROR;
+  }
+  if (!sim_init(ref, seed, tuning)) {
+    sim_free(fast);
+    return VERIFY_ERROR;
+  }
+
+  const Tuning *sighted = fast->tuning;
+  Tuning blind = *sighted;
+  blind.enemy_perception = 0;
+
+  long mismatch = -1;
+  if (!verify_compare(fast, ref, diff, diff_size)) {
+    mismatch = 0;
+  }
+
+  for (size_t t = 0; mismatch < 0 && t < tick_count; t++) {
+    int input = inputs[t] % (INPUT_NONE + 1);
+    fast->tuning = ref->tuning = tuning_at(t, tick_count, sighted, &blind);
+    if (t == FLEE_TICK(tick_count)) {
+      sim_flee(fast);
+      for (int i = 0; i < ref->enemy_count; i++)
+        if (ref->enemies[i].is_alive)
+          ref->enemies[i].state = ENEMY_FLEEING;
+    }
+    sim_step(fast, input);
+    verify_ref_step(ref, input);
+
+    if (!verify_compare(fast, ref, diff, diff_size)) {
+      mismatch = (long)t + 1; // world after tick t
+    }
+  }
+
+  sim_free(fast);
+  sim_free(ref);
+  return mismatch;
+}
+
+long verify_parallel(unsigned int seed, const Tuning *tuning,
+                     const unsigned char *inputs, size_t tick_count,
+                     int enemies, char *diff, size_t diff_size) {
+  Tuning crowd = *(tuning ? tuning : tuning_defaults());
+  crowd.max_enemies += enemies;
+
+  World serial, parallel;
+  if (!sim_init(&serial, seed, &crowd)) {
+    return VERIFY_ERROR;
+  }
+  if (!sim_init(&parallel, seed, &crowd)) {
+    sim_free(&serial);
+    return VERIFY_ERROR;
+  }
+  sim_spawn_crowd(&serial, enemies, seed);
+  sim_spawn_crowd(&parallel, enemies, seed);
+  parallel.parallel = true;
+  Tuning blind = crowd;
+  blind.enemy_perception = 0;
+
+  long mismatch = -1;
+  for (size_t t = 0; mismatch < 0 && t < tick_count; t++) {
+    int input = inputs[t] % (INPUT_NONE + 1);
+    serial.tuning = parallel.tuning = tuning_at(t, tick_count, &crowd, &blind);
+    if (t == FLEE_TICK(tick_count)) {
+      sim_flee(&serial);
+      sim_flee(&parallel);
+    }
+    sim_step(&serial, input);
+    sim_step(&parallel, input);
+    if (!verify_compare(&serial, &parallel, diff, diff_size)) {
+      mismatch = (long)t + 1;
+    }
+  }
+
+  sim_free(&serial);
+  sim_free(&parallel);
+  return mismatch;
+}
+
+// ===== wide backend =====
+
+#define CHECK_LANE(out, lane, label, field, a, b)                              \
+  do {                                                                         \
+    if ((long)(a) != (long)(b))                                                \
+      diff_line(out, "  lane %d %s." field ": %ld vs %ld\n", lane, label,      \
+                (long)(a), (long)(b));                                         \
+  } while (0)
+
+// lane l of the wide backend against the world sim_step made of its game
+static bool compare_lane(const WideWorld *wide, int l, const World *world,
+                         char *diff, size_t diff_size) {
+  DiffOut out = {diff, diff_size, 0, 0};
+  if (diff && diff_size)
+    diff[0] = '\0';
+
+  for (int row = 0; row < GRID_HEIGHT; row++)
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      int tile = wide->grid[row * GRID_WIDTH + col][l];
+      if (tile != (int)world->grid[row][col])
+        diff_line(&out, "  lane %d grid[%d][%d]: %d vs %d\n", l, row, col,
+                  tile, world->grid[row][col]);
+    }
+
+  const Player *player = &world->player;
+  CHECK_LANE(&out, l, "player", "col", wide->player_col[l], player->col);
+  CHECK_LANE(&out, l, "player", "row", wide->player_row[l], player->row);
+  CHECK_LANE(&out, l, "player", "facing", wide->player_facing[l],
+             player->facing);
+  CHECK_LANE(&out, l, "player", "move_slowdown", wide->player_slowdown[l],
+             player->move_slowdown);
+  CHECK_LANE(&out, l, "player", "is_alive", wide->player_alive[l] != 0,
+             player->is_alive);
+  CHECK_LANE(&out, l, "player", "dirt_dug", wide->dirt_dug[l],
+             player->dirt_dug);
+  CHECK_LANE(&out, l, "world", "rng", wide->rng[l], world->rng);
+  CHECK_LANE(&out, l, "world", "enemy_count", wide->enemy_count,
+             world->enemy_count);
+
+  int count = wide->enemy_count < world->enemy_count ? wide->enemy_count
+                                                     : world->enemy_count;
+  for (int i = 0; i < count; i++) {
+    char label[32];
+    snprintf(label, sizeof label, "enemy[%d]", i);
+    const WideEnemy *wa = &wide->enemies[i];
+    const Enemy *eb = &world->enemies[i];
+    CHECK_LANE(&out, l, label, "col", wa->col[l], eb->col);
+    CHECK_LANE(&out, l, label, "row", wa->row[l], eb->row);
+    CHECK_LANE(&out, l, label, "type", wa->type, eb->type);
+    CHECK_LANE(&out, l, label, "facing", wa->facing[l], eb->facing);
+    CHECK_LANE(&out, l, label, "move_slowdown", wa->move_slowdown[l],
+               sim_enemy_slowdown(world, i));
+    CHECK_LANE(&out, l, label, "is_ghosting", wa->is_ghosting[l] != 0,
+               eb->is_ghosting);
+    CHECK_LANE(&out, l, label, "rng", wa->rng[l], eb->rng);
+  }
+
+  if (out.count > MAX_DIFF_LINES)
+    diff_line(&out, "  ... %d more\n", out.count - MAX_DIFF_LINES);
+  return out.count == 0;
+}
+
+long verify_wide(unsigned int seed, const Tuning *tuning,
+                 const unsigned char *inputs, size_t tick_count, char *diff,
+                 size_t diff_size) {
+  Tuning blind = *(tuning ? tuning : tuning_defaults());
+  blind.enemy_perception = 0;
+  blind.enemy_pathing = 0;
+  blind.enemy_flee = 0;
+
+  unsigned int seeds[WIDE_LANES];
+  World *worlds = malloc(WIDE_LANES * sizeof *worlds);
+  WideWorld wide;
+  int ready = 0;
+  while (worlds && ready < WIDE_LANES) {
+    seeds[ready] = seed + (unsigned int)ready;
+    if (!sim_init(&worlds[ready], seeds[ready], &blind))
+      break;
+    ready++;
+  }
+  bool wide_ok = ready == WIDE_LANES && wide_init(&wide, seeds, &blind);
+
+  long mismatch = wide_ok ? -1 : VERIFY_ERROR;
+  for (int l = 0; wide_ok && mismatch == -1 && l < WIDE_LANES; l++)
+    if (!compare_lane(&wide, l, &worlds[l], diff, diff_size))
+      mismatch = 0;
+  // every lane plays its own stretch of the inputs
+  for (size_t t = 0; wide_ok && mismatch == -1 && t < tick_count; t++) {
+    int lane_inputs[WIDE_LANES];
+    unsigned int hits = 0;
+    for (int l = 0; l < WIDE_LANES; l++) {
+      size_t at = (t + l * tick_count / WIDE_LANES) % tick_count;
+      lane_inputs[l] = inputs[at] % (INPUT_NONE + 1);
+      hits |= (unsigned int)sim_step(&worlds[l], lane_inputs[l]) << l;
+    }
+    unsigned int wide_hits = wide_step(&wide, lane_inputs);
+    for (int l = 0; mismatch < 0 && l < WIDE_LANES; l++) {
+      if (!compare_lane(&wide, l, &worlds[l], diff, diff_size))
+        mismatch = (long)t + 1;
+      else if ((hits ^ wide_hits) >> l & 1) {
+        snprintf(diff, diff_size, "  lane %d hit: %d vs %d\n", l,
+                 wide_hits >> l & 1, hits >> l & 1);
+        mismatch = (long)t + 1;
+      }
+    }
+  }
+
+  if (wide_ok)
+    wide_free(&wide);
+  for (int l = 0; l < ready; l++)
+    sim_free(&worlds[l]);
+  free(worlds);
+  return mismatch;
+}
+
+// ===== grid kernels =====
+
+// one kernel table on a level of its size, everything it produces
+typedef struct {
+  uint8_t *player;
+  uint8_t *enemy;
+  int *dist;
+  int *steps; // bfs over the non-rock tiles
+  int head;
+  int tail;
+} KernelRun;
+
+static void run_kernels(const GridKernels *k, int width, int height,
+                        const TileType *tiles, int *cost, int start, int dug,
+                        const short *open, int *queue, bool *queued,
+                        KernelRun *run) {
+  int count = width * height;
+  k->walkmasks(width, height, tiles, run->player, run->enemy);
+  for (int i = 0; i < count; i++)
+    run->dist[i] = KERNEL_UNREACHABLE;
+  run->dist[start] = 0;
+  k->relax(width, height, cost, run->dist, start, queue, queued);
+  // a dig: one tile gets cheap, push the change out from there
+  int old_cost = cost[dug];
+  cost[dug] = 1;
+  if (run->dist[dug] != KERNEL_UNREACHABLE)
+    k->relax(width, height, cost, run->dist, dug, queue, queued);
+  cost[dug] = old_cost;
+
+  // the way the planner uses it: grow until dug is reached, then pick up
+  // from there until every reachable tile is in
+  for (int i = 0; i < count; i++)
+    run->steps[i] = -1;
+  run->steps[start] = 0;
+  queue[0] = start;
+  run->head = 0;
+  run->tail = 1;
+  k->bfs(width, height, open, run->steps, queue, &run->head, &run->tail, dug);
+  int rock = -1;
+  for (int i = 0; i < count && rock < 0; i++)
+    if (open[i] < 0)
+      rock = i;
+  if (rock >= 0)
+    k->bfs(width, height, open, run->steps, queue, &run->head, &run->tail,
+           rock);
+}
+
+bool verify_kernels(unsigned int seed, char *diff, size_t diff_size) {
+  DiffOut out = {diff, diff_size, 0, 0};
+  if (diff && diff_size)
+    diff[0] = '\0';
+  unsigned int rng = rng_seed(seed);
+
+  for (int s = 0; s < kernels_sized_count(); s++) {
+    const GridKernels *k = kernels_sized(s);
+    int width = k->width, height = k->height;
+    int count = width * height;
+    TileType *tiles = malloc(count * sizeof *tiles);
+    int *cost = malloc(count * sizeof *cost);
+    short *open = malloc(count * sizeof *open);
+    int *queue = malloc(count * sizeof *queue);
+    bool *queued = calloc(count, sizeof *queued);
+    KernelRun runs[2];
+    for (int r = 0; r < 2; r++) {
+      runs[r].player = malloc(count);
+      runs[r].enemy = malloc(count);
+      runs[r].dist = malloc(count * sizeof(int));
+      runs[r].steps = malloc(count * sizeof(int));
+    }
+    bool ok = tiles && cost && open && queue && queued;
+    for (int r = 0; r < 2; r++)
+      ok = ok && runs[r].player && runs[r].enemy && runs[r].dist &&
+           runs[r].steps;
+
+    if (ok) {
+      // a tenth rock, the rest dirt and tunnel
+      for (int i = 0; i < count; i++) {
+        int roll = rng_range(&rng, 10);
+        tiles[i] = roll == 0 ? TILE_ROCK : roll < 7 ? TILE_DIRT : TILE_TUNNEL;
+        cost[i] = tiles[i] == TILE_ROCK   ? KERNEL_UNREACHABLE
+                  : tiles[i] == TILE_DIRT ? 9
+                                          : 3;
+      }
+      int start = rng_range(&rng, count);
+      int dug = rng_range(&rng, count);
+      tiles[start] = TILE_TUNNEL;
+      cost[start] = 3;
+      for (int i = 0; i < count; i++)
+        open[i] = tiles[i] == TILE_ROCK ? -1 : 0;
+      run_kernels(k, width, height, tiles, cost, start, dug, open, queue,
+                  queued, &runs[0]);
+      run_kernels(kernels_generic(), width, height, tiles, cost, start, dug,
+                  open, queue, queued, &runs[1]);
+      if (runs[0].head != runs[1].head || runs[0].tail != runs[1].tail)
+        diff_line(&out, "  %s bfs queue: %d..%d, generic %d..%d\n", k->name,
+                  runs[0].head, runs[0].tail, runs[1].head, runs[1].tail);
+      for (int i = 0; i < count; i++) {
+        if (runs[0].player[i] != runs[1].player[i] ||
+            runs[0].enemy[i] != runs[1].enemy[i])
+          diff_line(&out, "  %s walkmasks[%d]: %x %x, generic %x %x\n",
+                    k->name, i, runs[0].player[i], runs[0].enemy[i],
+                    runs[1].player[i], runs[1].enemy[i]);
+        if (runs[0].dist[i] != runs[1].dist[i])
+          diff_line(&out, "  %s dist[%d]: %d, generic %d\n", k->name, i,
+                    runs[0].dist[i], runs[1].dist[i]);
+        if (runs[0].steps[i] != runs[1].steps[i])
+          diff_line(&out, "  %s bfs steps[%d]: %d, generic %d\n", k->name,
+                    i, runs[0].steps[i], runs[1].steps[i]);
+      }
+    } else {
+      diff_line(&out, "  %s: out of memory\n", k->name);
+    }
+
+    for (int r = 0; r < 2; r++) {
+      free(runs[r].player);
+      free(runs[r].enemy);
+      free(runs[r].dist);
+      free(runs[r].steps);
+    }
+    free(tiles);
+    free(cost);
+    free(open);
+    free(queue);
+    free(queued);
+  }
+
+  if (out.count > MAX_DIFF_LINES)
+    diff_line(&out, "  ... %d more\n", out.count - MAX_DIFF_LINES);
+  return out.count == 0;
+}
+
+long verify_bytes(const unsigned char *data, size_t size, char *diff,
+                  size_t diff_size) {
+  if (size < 4)
+    return -1;
+
+  unsigned int seed = data[0] | (data[1] << 8) | (data[2] << 16) |
+                      ((unsigned int)data[3] << 24);
+  return verify_lockstep(seed, NULL, data + 4, size - 4, diff, diff_size);
+}
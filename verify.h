@@ -0,0 +1,59 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Differential checker: a plain scalar copy of the game rules (the
+// "reference") runs next to the real sim_step in lockstep, and the two
+// worlds are compared after every tick. Any optimized path in the sim must
+// keep producing the same world as the reference.
+
+// reference version of sim_step, written the slow obvious way
+void verify_ref_step(World *world, int input);
+
+// compare two worlds field by field, and a's occupancy bitplanes and
+// zobrist key against its own entities (the reference doesn't keep any)
+// on mismatch, writes a readable description of the first differences
+bool verify_compare(const World *a, const World *b, char *diff,
+                    size_t diff_size);
+
+// what the long returning checks give back when they couldn't even set up
+// their worlds (out of memory); not a tick, and not a pass either
+#define VERIFY_ERROR -2
+
+// run sim and reference side by side for a seed and an input stream
+// (tuning NULL = defaults); for the last quarter every enemy is fleeing
+// returns the tick of the first mismatch, -1 if they always agree or
+// VERIFY_ERROR
+long verify_lockstep(unsigned int seed, const Tuning *tuning,
+                     const unsigned char *inputs, size_t tick_count,
+                     char *diff, size_t diff_size);
+
+// same inputs on a crowded world, enemy update serial vs on the worker
+// threads (start them with jobs_start first); must be bit-identical
+long verify_parallel(unsigned int seed, const Tuning *tuning,
+                     const unsigned char *inputs, size_t tick_count,
+                     int enemies, char *diff, size_t diff_size);
+
+// WIDE_LANES games (seeds seed, seed + 1, ...) on the wide backend against
+// as many sim_step worlds, every lane playing its own stretch of the
+// inputs; the tuning is made blind first (wide.h has no perception,
+// pathing or fleeing). Compared after every tick, like verify_lockstep
+long verify_wide(unsigned int seed, const Tuning *tuning,
+                 const unsigned char *inputs, size_t tick_count, char *diff,
+                 size_t diff_size);
+
+// every specialized grid kernel table against the generic one on a random
+// level of its size (walkable masks, distances before and after a dig,
+// breadth first steps grown in two goes); false and a diff if they disagree
+bool verify_kernels(unsigned int seed, char *diff, size_t diff_size);
+
+// treat any byte string as a game (first 4 bytes seed, rest inputs)
+// so arbitrary files can be thrown at the checker; fuzz.c feeds the
+// fuzzer's data through the replay format instead
+long verify_bytes(const unsigned char *data, size_t size, char *diff,
+                  size_t diff_size);
+
+#endif
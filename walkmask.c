@@ -0,0 +1,49 @@
+#include "player.h"
+#include "walkmask.h"
+
+// neighbour offsets in Direction order: up, down, left, right
+static const int step_col[4] = {0, 0, -1, 1};
+static const int step_row[4] = {-1, 1, 0, 0};
+
+static void update_tile(WalkMasks *masks,
+                        TileType grid[GRID_HEIGHT][GRID_WIDTH], int col,
+                        int row) {
+  TileType around[4];
+  for (int dir = DIR_UP; dir <= DIR_RIGHT; dir++) {
+    int c = col + step_col[dir];
+    int r = row + step_row[dir];
+    bool inside = c >= 0 && c < GRID_WIDTH && r >= 0 && r < GRID_HEIGHT;
+    around[dir] = inside ? grid[r][c] : TILE_ROCK;
+  }
+  walkmask_rules(around[DIR_UP], around[DIR_DOWN], around[DIR_LEFT],
+                 around[DIR_RIGHT], &masks->player[row][col],
+                 &masks->enemy[row][col]);
+}
+
+void walkmask_init(WalkMasks *masks, TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                   const GridKernels *kernels) {
+  kernels->walkmasks(GRID_WIDTH, GRID_HEIGHT, &grid[0][0], &masks->player[0][0],
+                     &masks->enemy[0][0]);
+}
+
+void walkmask_set_tile(WalkMasks *masks,
+                       TileType grid[GRID_HEIGHT][GRID_WIDTH], int col,
+                       int row) {
+  // the tile's own mask is about its neighbours, only theirs change
+  for (int dir = DIR_UP; dir <= DIR_RIGHT; dir++) {
+    int c = col + step_col[dir];
+    int r = row + step_row[dir];
+    if (c >= 0 && c < GRID_WIDTH && r >= 0 && r < GRID_HEIGHT) {
+      update_tile(masks, grid, c, r);
+    }
+  }
+}
+
+int walkmask_count(unsigned int mask) { return __builtin_popcount(mask); }
+
+int walkmask_nth(unsigned int mask, int n) {
+  while (n-- > 0) {
+    mask &= mask - 1;
+  }
+  return __builtin_ctz(mask);
+}
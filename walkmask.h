@@ -0,0 +1,47 @@
+#ifndef WALKMASK_H
+#define WALKMASK_H
+
+#include "kernels.h"
+#include "player.h"
+#include "types.h"
+#include <stdint.h>
+
+// Which neighbours of each tile can be moved onto, 4 bits per tile (bit
+// 1 << Direction), so choosing a direction is a pick from a mask instead
+// of trying directions until one works. One set for the player's rules
+// (no rocks, dirt gets dug but not upwards) and one for the enemies'
+// (anything but rocks, dirt by ghosting). Off the grid is never walkable.
+// Patched for the changed tile and its neighbours whenever a tile changes.
+
+typedef struct {
+  uint8_t player[GRID_HEIGHT][GRID_WIDTH];
+  uint8_t enemy[GRID_HEIGHT][GRID_WIDTH];
+} WalkMasks;
+
+// the rules: both masks of a tile from its neighbours (TILE_ROCK for the
+// ones off the grid)
+static inline void walkmask_rules(TileType up, TileType down, TileType left,
+                                  TileType right, uint8_t *player,
+                                  uint8_t *enemy) {
+  uint8_t mask = (up != TILE_ROCK) << DIR_UP |
+                 (down != TILE_ROCK) << DIR_DOWN |
+                 (left != TILE_ROCK) << DIR_LEFT |
+                 (right != TILE_ROCK) << DIR_RIGHT;
+  *enemy = mask;
+  *player = mask & ~((up == TILE_DIRT) << DIR_UP);
+}
+
+// the whole grid, through the level's kernels
+void walkmask_init(WalkMasks *masks, TileType grid[GRID_HEIGHT][GRID_WIDTH],
+                   const GridKernels *kernels);
+
+// grid[row][col] changed
+void walkmask_set_tile(WalkMasks *masks,
+                       TileType grid[GRID_HEIGHT][GRID_WIDTH], int col,
+                       int row);
+
+// number of directions in mask, and the nth of them (0 <= n < count)
+int walkmask_count(unsigned int mask);
+int walkmask_nth(unsigned int mask, int n);
+
+#endif
@@ -0,0 +1,103 @@
+#include "metrics.h"
+#include "wheel.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LEVEL_BITS 8 // log2(WHEEL_SLOTS)
+
+bool wheel_init(Wheel *wheel, int capacity, unsigned long now) {
+  wheel->capacity = capacity;
+  wheel->next = malloc((capacity > 0 ? capacity : 1) * sizeof *wheel->next);
+  wheel->wake = malloc((capacity > 0 ? capacity : 1) * sizeof *wheel->wake);
+  metrics_add(METRIC_ALLOCATIONS, 2);
+  if (!wheel->next || !wheel->wake) {
+    wheel_free(wheel);
+    return false;
+  }
+  wheel_clear(wheel, now);
+  return true;
+}
+
+void wheel_free(Wheel *wheel) {
+  free(wheel->next);
+  free(wheel->wake);
+  wheel->next = NULL;
+  wheel->wake = NULL;
+  wheel->capacity = 0;
+}
+
+void wheel_clear(Wheel *wheel, unsigned long now) {
+  memset(wheel->head, -1, sizeof wheel->head);
+  wheel->count = 0;
+  wheel->now = now;
+}
+
+void wheel_copy(Wheel *dst, const Wheel *src) {
+  int *next = dst->next;
+  unsigned long *wake = dst->wake;
+  int capacity = dst->capacity;
+  int ids = capacity < src->capacity ? capacity : src->capacity;
+  *dst = *src;
+  dst->next = next;
+  dst->wake = wake;
+  dst->capacity = capacity;
+  memcpy(dst->next, src->next, ids * sizeof *next);
+  memcpy(dst->wake, src->wake, ids * sizeof *wake);
+}
+
+// the lowest level whose slots reach tick from now; anything further out
+// than the top level reaches waits in its last slot and gets put back
+static void insert(Wheel *wheel, int id) {
+  unsigned long tick = wheel->wake[id];
+  unsigned long delta = tick - wheel->now;
+  int level = 0;
+  while (level < WHEEL_LEVELS - 1 &&
+         delta >= 1ul << (LEVEL_BITS * (level + 1))) {
+    level++;
+  }
+  unsigned long reach = 1ul << (LEVEL_BITS * (level + 1));
+  if (delta >= reach) {
+    tick = wheel->now + reach - 1;
+  }
+  int slot = (tick >> (LEVEL_BITS * level)) & (WHEEL_SLOTS - 1);
+  wheel->next[id] = wheel->head[level][slot];
+  wheel->head[level][slot] = id;
+}
+
+void wheel_add(Wheel *wheel, int id, unsigned long tick) {
+  wheel->wake[id] = tick;
+  wheel->count++;
+  insert(wheel, id);
+}
+
+// a higher level slot whose turn came, spread over the levels below
+static void cascade(Wheel *wheel, int level) {
+  int slot = (wheel->now >> (LEVEL_BITS * level)) & (WHEEL_SLOTS - 1);
+  int id = wheel->head[level][slot];
+  wheel->head[level][slot] = -1;
+  while (id >= 0) {
+    int next = wheel->next[id];
+    insert(wheel, id);
+    id = next;
+  }
+}
+
+void wheel_advance(Wheel *wheel, void (*wake)(void *arg, int id), void *arg) {
+  // top level first, what comes down from it may land in level 1's slot
+  for (int level = WHEEL_LEVELS - 1; level > 0; level--) {
+    unsigned long below = (1ul << (LEVEL_BITS * level)) - 1;
+    if ((wheel->now & below) == 0) {
+      cascade(wheel, level);
+    }
+  }
+  int slot = wheel->now & (WHEEL_SLOTS - 1);
+  int id = wheel->head[0][slot];
+  wheel->head[0][slot] = -1;
+  while (id >= 0) {
+    int next = wheel->next[id];
+    wheel->count--;
+    wake(arg, id);
+    id = next;
+  }
+  wheel->now++;
+}
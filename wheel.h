@@ -0,0 +1,47 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stdbool.h>
+
+// Hierarchical timing wheel: ids (enemy slots) scheduled to wake at some
+// tick, found again without looking at anybody else. Three levels of
+// 256 slots: level 0 holds what wakes in the next 256 ticks, one slot per
+// tick; level 1 one slot per 256 ticks, level 2 per 65536. Every 256
+// ticks the next level 1 slot is spread over level 0 (and every 65536 a
+// level 2 slot over levels 0 and 1), so adding and waking are O(1) and a
+// tick costs nothing for ids that sleep on.
+//
+// An id is in the wheel at most once. Lists are linked through per id
+// arrays, allocated once for capacity ids.
+
+#define WHEEL_LEVELS 3
+#define WHEEL_SLOTS 256
+
+typedef struct {
+  int head[WHEEL_LEVELS][WHEEL_SLOTS]; // first id in the slot, -1 = none
+  int *next;           // per id: next in its slot
+  unsigned long *wake; // per id: tick it wakes at
+  int capacity;
+  int count;           // ids in the wheel
+  unsigned long now;   // next tick wheel_advance wakes
+} Wheel;
+
+// false if out of memory; free with wheel_free
+bool wheel_init(Wheel *wheel, int capacity, unsigned long now);
+
+void wheel_free(Wheel *wheel);
+
+// empty, next tick to wake is now
+void wheel_clear(Wheel *wheel, unsigned long now);
+
+// dst (from wheel_init, room for src's ids) the same as src
+void wheel_copy(Wheel *dst, const Wheel *src);
+
+// id (not in the wheel yet) wakes at tick (>= now)
+void wheel_add(Wheel *wheel, int id, unsigned long tick);
+
+// calls wake(arg, id) for every id due at now, in no particular order,
+// takes them out of the wheel and moves on to the next tick
+void wheel_advance(Wheel *wheel, void (*wake)(void *arg, int id), void *arg);
+
+#endif
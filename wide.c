@@ -0,0 +1,264 @@
+#include "grid.h"
+#include "metrics.h"
+#include "player.h"
+#include "rng.h"
+#include "sim.h"
+#include "walkmask.h"
+#include "wide.h"
+#include <stdlib.h>
+#include <string.h>
+
+// lane masks are 0 or -1 per lane, like the vector compares give them
+static inline WideInt select_lanes(WideInt mask, WideInt a, WideInt b) {
+  return (a & mask) | (b & ~mask);
+}
+
+static inline WideInt splat(int value) {
+  WideInt v;
+  for (int l = 0; l < WIDE_LANES; l++) {
+    v[l] = value;
+  }
+  return v;
+}
+
+// each lane's own tile: the one gather, scalar loads are as quick as
+// anything the vector units have for it
+static inline WideInt gather_tiles(const WideWorld *wide, WideInt tile) {
+  WideInt out;
+  for (int l = 0; l < WIDE_LANES; l++) {
+    out[l] = wide->grid[tile[l]][l];
+  }
+  return out;
+}
+
+static inline WideInt gather_walk(const WideWorld *wide, WideInt tile) {
+  WideInt out;
+  for (int l = 0; l < WIDE_LANES; l++) {
+    out[l] = wide->enemy_walk[tile[l]];
+  }
+  return out;
+}
+
+// rng_next in every lane where mask is set
+static inline WideUint next_lanes(WideUint *state, WideInt mask) {
+  WideUint x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = (WideUint)select_lanes(mask, (WideInt)x, (WideInt)*state);
+  return x;
+}
+
+// one step in dir: -1/0/+1 per lane
+static inline WideInt step_col(WideInt dir) {
+  return (dir == DIR_LEFT) - (dir == DIR_RIGHT);
+}
+
+static inline WideInt step_row(WideInt dir) {
+  return (dir == DIR_UP) - (dir == DIR_DOWN);
+}
+
+bool wide_supports(const Tuning *tuning) {
+  return !tuning->enemy_perception && !tuning->enemy_pathing &&
+         !tuning->enemy_flee;
+}
+
+// spawns whatever the waves have due; nobody dies with these rules, so
+// enemies alive is the slot count and the same in every lane
+static void run_spawner(WideWorld *wide) {
+  int count = spawner_due(&wide->spawner, wide->tuning, wide->enemy_count);
+  for (int i = 0; i < count; i++) {
+    const SpawnPoint *spawn =
+        spawner_next_point(&wide->spawner, wide->tuning);
+    if (wide->enemy_count == wide->enemy_capacity) {
+      continue;
+    }
+    WideEnemy *enemy = &wide->enemies[wide->enemy_count++];
+    enemy->col = splat(spawn->col);
+    enemy->row = splat(spawn->row);
+    enemy->facing = splat(DIR_LEFT);
+    enemy->move_slowdown = splat(0);
+    enemy->is_ghosting = splat(0);
+    enemy->type = spawn->type;
+    for (int l = 0; l < WIDE_LANES; l++) {
+      unsigned int rng = wide->rng[l];
+      enemy->rng[l] = rng_seed(rng_next(&rng));
+      wide->rng[l] = rng;
+    }
+  }
+}
+
+bool wide_init(WideWorld *wide, const unsigned int seeds[WIDE_LANES],
+               const Tuning *tuning) {
+  wide->tuning = tuning ? tuning : tuning_defaults();
+  tuning = wide->tuning;
+  if (!wide_supports(tuning)) {
+    return false;
+  }
+
+  TileType level[GRID_HEIGHT][GRID_WIDTH];
+  WalkMasks walk;
+  grid_init(level);
+  walkmask_init(&walk, level, kernels_for(GRID_WIDTH, GRID_HEIGHT));
+  for (int row = 0; row < GRID_HEIGHT; row++) {
+    for (int col = 0; col < GRID_WIDTH; col++) {
+      int tile = row * GRID_WIDTH + col;
+      memset(wide->grid[tile], level[row][col], WIDE_LANES);
+      wide->enemy_walk[tile] = walk.enemy[row][col];
+    }
+  }
+
+  wide->player_col = splat(tuning->player_start_col);
+  wide->player_row = splat(tuning->player_start_row);
+  wide->player_facing = splat(DIR_RIGHT);
+  wide->player_slowdown = splat(0);
+  wide->player_alive = splat(-1);
+  wide->dirt_dug = splat(0);
+  for (int l = 0; l < WIDE_LANES; l++) {
+    wide->rng[l] = rng_seed(seeds[l]);
+  }
+  wide->tick = 0;
+
+  // vectors want their alignment, and the size a multiple of it
+  wide->enemy_capacity = tuning->max_enemies;
+  wide->enemy_count = 0;
+  size_t slots = wide->enemy_capacity > 0 ? wide->enemy_capacity : 1;
+  wide->enemies =
+      aligned_alloc(_Alignof(WideEnemy), slots * sizeof(WideEnemy));
+  metrics_add(METRIC_ALLOCATIONS, 1);
+  if (!wide->enemies) {
+    return false;
+  }
+
+  // the tick 0 waves are there from the start, same as sim_init
+  spawner_init(&wide->spawner);
+  run_spawner(wide);
+  return true;
+}
+
+void wide_free(WideWorld *wide) {
+  free(wide->enemies);
+  wide->enemies = NULL;
+  wide->enemy_count = 0;
+  wide->enemy_capacity = 0;
+}
+
+// player_move, gated like sim_step, then player_update
+static void step_player(WideWorld *wide, const int inputs[WIDE_LANES]) {
+  const Tuning *tuning = wide->tuning;
+  WideInt input;
+  for (int l = 0; l < WIDE_LANES; l++) {
+    input[l] = inputs[l];
+  }
+  WideInt tries = (input != INPUT_NONE) & (wide->player_slowdown == 0);
+  WideInt col = wide->player_col + step_col(input);
+  WideInt row = wide->player_row + step_row(input);
+  WideInt inside = (col >= 0) & (col < GRID_WIDTH) & (row >= 0) &
+                   (row < GRID_HEIGHT);
+  WideInt tile = select_lanes(inside, row * GRID_WIDTH + col, splat(0));
+  WideInt type = gather_tiles(wide, tile);
+  WideInt dirt = type == TILE_DIRT;
+  WideInt moves = tries & inside & (type != TILE_ROCK) &
+                  ~(dirt & (input == DIR_UP));
+  WideInt digs = moves & dirt;
+
+  for (int l = 0; l < WIDE_LANES; l++) {
+    if (digs[l]) {
+      wide->grid[tile[l]][l] = TILE_TUNNEL;
+    }
+  }
+  wide->dirt_dug -= digs;
+  wide->player_col = select_lanes(moves, col, wide->player_col);
+  wide->player_row = select_lanes(moves, row, wide->player_row);
+  wide->player_facing = select_lanes(moves, input, wide->player_facing);
+  WideInt slowdown = select_lanes(digs, splat(tuning->player_dig_slowdown),
+                                  splat(tuning->player_tunnel_slowdown));
+  wide->player_slowdown =
+      select_lanes(moves, slowdown, wide->player_slowdown);
+  wide->player_slowdown += wide->player_slowdown > 0;
+}
+
+// enemy_update for a chaser that can't see (always after the player):
+// count down, or roll for a random step, else the preferred way, else a
+// random walkable other way
+static void step_enemy(WideWorld *wide, WideEnemy *enemy) {
+  const Tuning *tuning = wide->tuning;
+  WideInt waiting = enemy->move_slowdown > 0;
+  enemy->move_slowdown += waiting;
+  WideInt deciding = ~waiting;
+
+  WideInt dx = wide->player_col - enemy->col;
+  WideInt dy = wide->player_row - enemy->row;
+  WideInt across =
+      select_lanes(dx < 0, -dx, dx) > select_lanes(dy < 0, -dy, dy);
+  WideInt preferred = select_lanes(
+      across, select_lanes(dx > 0, splat(DIR_RIGHT), splat(DIR_LEFT)),
+      select_lanes(dy > 0, splat(DIR_DOWN), splat(DIR_UP)));
+  WideInt here = enemy->row * GRID_WIDTH + enemy->col;
+  WideInt walk = gather_walk(wide, here);
+
+  WideUint roll = next_lanes(&enemy->rng, deciding);
+  WideInt random = deciding & ((WideInt)(roll % 100u) <
+                               tuning->enemy_random_chance);
+  WideInt dir = (WideInt)(next_lanes(&enemy->rng, random) & 3u);
+  WideInt moves = random & (((walk >> dir) & 1) != 0);
+
+  WideInt straight = deciding & ~moves & (((walk >> preferred) & 1) != 0);
+  dir = select_lanes(straight, preferred, dir);
+  moves |= straight;
+
+  // the walkable others, and the choice-th of them
+  WideInt others = walk & ~(1 << preferred);
+  WideInt count = splat(0);
+  for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+    count += (others >> d) & 1;
+  }
+  WideInt around = deciding & ~moves & (count > 0);
+  WideUint draw = next_lanes(&enemy->rng, around);
+  WideInt choice = select_lanes(count == 3, (WideInt)(draw % 3u),
+                                select_lanes(count == 2, (WideInt)(draw & 1u),
+                                             splat(0)));
+  WideInt seen = splat(0);
+  for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+    WideInt bit = (others >> d) & 1;
+    dir = select_lanes(around & (bit != 0) & (seen == choice), splat(d), dir);
+    seen += bit;
+  }
+  moves |= around;
+
+  WideInt col = enemy->col + step_col(dir);
+  WideInt row = enemy->row + step_row(dir);
+  WideInt dirt = gather_tiles(wide, select_lanes(moves, row * GRID_WIDTH + col,
+                                                 here)) == TILE_DIRT;
+  enemy->col = select_lanes(moves, col, enemy->col);
+  enemy->row = select_lanes(moves, row, enemy->row);
+  enemy->facing = select_lanes(moves, dir, enemy->facing);
+  enemy->is_ghosting = select_lanes(moves, dirt, enemy->is_ghosting);
+  WideInt slowdown = select_lanes(dirt, splat(tuning->enemy_dirt_slowdown),
+                                  splat(tuning->enemy_tunnel_slowdown));
+  enemy->move_slowdown = select_lanes(moves, slowdown, enemy->move_slowdown);
+}
+
+unsigned int wide_step(WideWorld *wide, const int inputs[WIDE_LANES]) {
+  step_player(wide, inputs);
+
+  WideInt caught = splat(0);
+  for (int i = 0; i < wide->enemy_count; i++) {
+    WideEnemy *enemy = &wide->enemies[i];
+    step_enemy(wide, enemy);
+    caught |= (enemy->col == wide->player_col) &
+              (enemy->row == wide->player_row);
+  }
+  caught &= wide->player_alive;
+  wide->player_alive &= ~caught;
+
+  wide->tick++;
+  spawner_end_tick(&wide->spawner);
+  run_spawner(wide);
+
+  unsigned int hits = 0;
+  for (int l = 0; l < WIDE_LANES; l++) {
+    hits |= (caught[l] != 0) << l;
+  }
+  return hits;
+}
@@ -0,0 +1,84 @@
+#ifndef WIDE_H
+#define WIDE_H
+
+#include "spawner.h"
+#include "tuning.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Wide backend: WIDE_LANES small worlds stepped in lockstep, laid out
+// structure-of-worlds so every field holds that value for all the worlds
+// side by side (one vector), and a tick runs the same instructions for
+// all of them; what's a branch in sim_step is a lane mask here. Meant for
+// running lots of games (training, sweeps), where games per second count
+// and one game's latency doesn't.
+//
+// Only the blind rules: no perception, pathing or fleeing (wide_supports),
+// so enemies always chase the player, never die and every lane spawns the
+// same enemies on the same ticks. Within those rules a lane plays exactly
+// the game sim_step plays for its seed and inputs (verify_wide checks).
+//
+// GCC vector extensions, so no intrinsics. The lane count follows the
+// widest vectors the build targets: 4 on plain x86-64, 8 with -mavx2, 16
+// with AVX-512 (-march=native picks). Vectors wider than the target has
+// get split and spilled, slower than 4 lanes done natively.
+
+#if defined(__AVX512F__)
+#define WIDE_LANES 16
+#elif defined(__AVX2__)
+#define WIDE_LANES 8
+#else
+#define WIDE_LANES 4
+#endif
+
+typedef int32_t WideInt __attribute__((vector_size(WIDE_LANES * 4)));
+typedef uint32_t WideUint __attribute__((vector_size(WIDE_LANES * 4)));
+
+// one enemy slot in every lane; slots fill up in the same order
+// everywhere, so the type is per slot
+typedef struct {
+  WideInt col;
+  WideInt row;
+  WideInt facing;        // Direction
+  WideInt move_slowdown;
+  WideInt is_ghosting;   // 0 or -1
+  WideUint rng;          // own random stream
+  int type;              // EnemyType
+} WideEnemy;
+
+typedef struct {
+  int8_t grid[GRID_HEIGHT * GRID_WIDTH][WIDE_LANES]; // TileType per lane
+  // enemy walkable-neighbour masks (walkmask.h); only rocks block
+  // enemies and those never change, so these are the same for every lane
+  uint8_t enemy_walk[GRID_HEIGHT * GRID_WIDTH];
+  WideInt player_col;
+  WideInt player_row;
+  WideInt player_facing;
+  WideInt player_slowdown;
+  WideInt player_alive;  // 0 or -1
+  WideInt dirt_dug;
+  WideUint rng;          // the world's stream
+  WideEnemy *enemies;    // enemy_capacity slots, allocated once
+  int enemy_count;       // the same in every lane
+  int enemy_capacity;
+  Spawner spawner;
+  const Tuning *tuning;
+  unsigned long tick;
+} WideWorld;
+
+// can the wide backend play by these rules
+bool wide_supports(const Tuning *tuning);
+
+// lane l plays seeds[l], like sim_init; false if out of memory or the
+// rules aren't supported. Free with wide_free
+bool wide_init(WideWorld *wide, const unsigned int seeds[WIDE_LANES],
+               const Tuning *tuning);
+
+void wide_free(WideWorld *wide);
+
+// one tick for every lane, inputs[l] like sim_step's input
+// returns a bit per lane whose player got hit this tick
+unsigned int wide_step(WideWorld *wide, const int inputs[WIDE_LANES]);
+
+#endif
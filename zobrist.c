@@ -0,0 +1,30 @@
+#include "zobrist.h"
+
+enum { KEY_TILE, KEY_PLAYER, KEY_ENEMY, KEY_RNG };
+
+// splitmix64 finalizer: every input bit flips about half the output bits
+static uint64_t key(unsigned int kind, uint64_t index) {
+  uint64_t z = ((uint64_t)kind << 48 ^ index) + 0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// any col and row give a key, off the grid too (no table to overrun)
+static uint64_t tile_index(int col, int row) {
+  return (uint64_t)(uint16_t)row << 16 | (uint16_t)col;
+}
+
+uint64_t zobrist_tile(int col, int row, TileType tile) {
+  return key(KEY_TILE, tile_index(col, row) << 8 | (unsigned)tile);
+}
+
+uint64_t zobrist_player(int col, int row) {
+  return key(KEY_PLAYER, tile_index(col, row));
+}
+
+uint64_t zobrist_enemy(int type, int col, int row) {
+  return key(KEY_ENEMY, tile_index(col, row) << 8 | (unsigned)type);
+}
+
+uint64_t zobrist_rng(unsigned int rng) { return key(KEY_RNG, rng); }
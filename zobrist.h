@@ -0,0 +1,22 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "types.h"
+#include <stdint.h>
+
+// Zobrist keys: a random 64 bit number for every (thing, tile) pair. A
+// position's key is the sum of the keys of everything in it, so a change
+// is one subtraction and one addition instead of hashing the whole world.
+// Summed rather than xored, so two enemies on one tile don't cancel out.
+//
+// The keys are a hash of the pair instead of a table: nothing to set up,
+// safe from any thread, and every build agrees on them.
+
+uint64_t zobrist_tile(int col, int row, TileType tile);
+uint64_t zobrist_player(int col, int row);
+uint64_t zobrist_enemy(int type, int col, int row);
+
+// the world rng, folded in when the key is read
+uint64_t zobrist_rng(unsigned int rng);
+
+#endif